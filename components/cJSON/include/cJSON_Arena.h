@@ -0,0 +1,70 @@
+/**
+ * @file      cJSON_Arena.h
+ * @brief     Arena allocator used by cJSON, reset when all the items are released
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CJSON_ARENA_H__
+#define __CJSON_ARENA_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Statistics of the arena
+ */
+typedef struct {
+    size_t   size;       /**< Size of the arena */
+    size_t   used;       /**< Number of bytes currently used in the arena */
+    size_t   high_water; /**< Maximum number of bytes used in the arena since the last call to cjson_arena_stats_reset */
+    size_t   live;       /**< Number of allocations not released in the arena */
+    uint32_t resets;     /**< Number of times the arena has been reset */
+    uint32_t fallbacks;  /**< Number of allocations of a scope done in the heap because the arena was full */
+} cjson_arena_stats_t;
+
+/**
+ * @brief Start a scope where the cJSON allocations of the calling thread are done in the arena, only one scope is open at a time
+ * @note The items allocated in the scope must be released with cJSON_Delete or cJSON_free before the end of the scope, never with free().
+ * The allocations of the other threads are done in the heap.
+ */
+void cjson_arena_begin(void);
+
+/**
+ * @brief End the scope of the arena
+ * @return 0 if the function succeeds, -EBUSY if some allocations of the scope are not released
+ */
+int cjson_arena_end(void);
+
+/**
+ * @brief Get statistics of the arena
+ * @param stats Statistics
+ */
+void cjson_arena_stats(cjson_arena_stats_t *stats);
+
+/**
+ * @brief Reset high water mark and counters of the arena
+ */
+void cjson_arena_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CJSON_ARENA_H__ */
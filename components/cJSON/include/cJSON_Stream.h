@@ -0,0 +1,188 @@
+/**
+ * @file      cJSON_Stream.h
+ * @brief     Streaming JSON parser, values are extracted using callbacks with fixed RAM usage
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CJSON_STREAM_H__
+#define __CJSON_STREAM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cJSON.h"
+
+/**
+ * @brief Events of the streaming parser
+ */
+typedef enum {
+    CJSON_STREAM_EVENT_OBJECT_START = 0, /**< Beginning of an object */
+    CJSON_STREAM_EVENT_OBJECT_END,       /**< End of an object */
+    CJSON_STREAM_EVENT_ARRAY_START,      /**< Beginning of an array */
+    CJSON_STREAM_EVENT_ARRAY_END,        /**< End of an array */
+    CJSON_STREAM_EVENT_STRING,           /**< Fragment of a string, decoded */
+    CJSON_STREAM_EVENT_NUMBER,           /**< Number, as it appears in the document */
+    CJSON_STREAM_EVENT_TRUE,             /**< True */
+    CJSON_STREAM_EVENT_FALSE,            /**< False */
+    CJSON_STREAM_EVENT_NULL              /**< Null */
+} cjson_stream_event_t;
+
+/**
+ * @brief Value reported by the streaming parser
+ */
+typedef struct {
+    cjson_stream_event_t event;  /**< Event */
+    const char          *path;   /**< Path of the value, object members are separated with '.' and array elements are indexed with [N] */
+    const char          *key;    /**< Key of the value in its parent object, NULL for array elements and for the root value */
+    const char          *data;   /**< Data of strings and numbers, not NUL terminated */
+    size_t               length; /**< Length of the data */
+    bool                 last;   /**< Last fragment of a string, always true for other events */
+} cjson_stream_value_t;
+
+/**
+ * @brief Callback invoked for each value
+ * @param value Value, only valid during the callback
+ * @param user_data User data
+ */
+typedef void (*cjson_stream_cb_t)(const cjson_stream_value_t *value, void *user_data);
+
+/**
+ * @brief Container opened by the streaming parser
+ */
+typedef struct {
+    uint16_t path_length; /**< Length of the path of the container */
+    int16_t  key_offset;  /**< Offset of the key of the container in the path, -1 if it has no key */
+    uint32_t index;       /**< Index of the current element of an array */
+    bool     array;       /**< Container is an array */
+} cjson_stream_level_t;
+
+/**
+ * @brief Streaming parser context, the parser does not allocate memory
+ */
+typedef struct {
+    cjson_stream_cb_t    callback;                                      /**< Callback invoked for each value */
+    void                 *user_data;                                    /**< User data of the callback */
+    uint8_t              state;                                         /**< State of the parser */
+    uint8_t              escape_state;                                  /**< State to return to after an escape sequence */
+    int                  error;                                         /**< Error, sticky */
+    size_t               depth;                                         /**< Number of opened containers */
+    cjson_stream_level_t levels[CONFIG_CJSON_STREAM_MAX_DEPTH];         /**< Opened containers */
+    char                 path[CONFIG_CJSON_STREAM_PATH_SIZE];           /**< Path of the current value */
+    size_t               path_length;                                   /**< Length of the path of the current value */
+    int16_t              key_offset;                                    /**< Offset of the key of the current value in the path, -1 if it has no key */
+    char                 literal[CONFIG_CJSON_STREAM_LITERAL_SIZE + 1]; /**< Number or literal being parsed */
+    size_t               literal_length;                                /**< Length of the number or literal */
+    uint32_t             unicode;                                       /**< Unicode escape sequence being parsed */
+    uint8_t              unicode_count;                                 /**< Number of hexadecimal digits of the unicode escape sequence */
+    uint32_t             surrogate;                                     /**< High surrogate waiting for the low surrogate, 0 if none */
+} cjson_stream_t;
+
+/**
+ * @brief Field extracted from a document
+ */
+typedef struct {
+    const char *path;      /**< Path of the field */
+    char       *buffer;    /**< Buffer where the value is saved as a NUL terminated string */
+    size_t      size;      /**< Size of the buffer */
+    size_t      length;    /**< Length of the value */
+    bool        found;     /**< Field has been found */
+    bool        truncated; /**< Value has been truncated because the buffer is too small */
+    bool        partial;   /**< Value is being received, the next fragment is appended */
+} cjson_stream_field_t;
+
+/**
+ * @brief Fields extracted from a document, to be used as user data of cjson_stream_extract_cb
+ */
+typedef struct {
+    cjson_stream_field_t *fields; /**< Fields */
+    size_t                count;  /**< Number of fields */
+} cjson_stream_fields_t;
+
+/**
+ * @brief Builder of a DOM tree from a part of a document, to be used as user data of cjson_stream_dom_cb
+ */
+typedef struct {
+    const char *path;                                /**< Path of the value to be built */
+    cJSON      *root;                                /**< Root of the DOM tree, NULL until the value is found */
+    cJSON      *stack[CONFIG_CJSON_STREAM_MAX_DEPTH]; /**< Containers being built */
+    size_t      depth;                               /**< Number of containers being built */
+    char       *string;                              /**< String being built */
+    size_t      string_length;                       /**< Length of the string being built */
+    bool        error;                               /**< Allocation failure */
+} cjson_stream_dom_t;
+
+/**
+ * @brief Initialize streaming parser
+ * @param stream Streaming parser context
+ * @param callback Callback invoked for each value
+ * @param user_data User data of the callback
+ */
+void cjson_stream_init(cjson_stream_t *stream, cjson_stream_cb_t callback, void *user_data);
+
+/**
+ * @brief Feed the parser with a chunk of the document, the chunk can be released when the function returns
+ * @param stream Streaming parser context
+ * @param data Chunk of the document
+ * @param length Length of the chunk
+ * @return 0 if the function succeeds, -EINVAL if the document is invalid, -ENOMEM if the depth, path or literal limits are reached
+ */
+int cjson_stream_feed(cjson_stream_t *stream, const char *data, size_t length);
+
+/**
+ * @brief Indicate the end of the document
+ * @param stream Streaming parser context
+ * @return 0 if the document is complete and valid, error code otherwise
+ */
+int cjson_stream_finish(cjson_stream_t *stream);
+
+/**
+ * @brief Callback saving the fields matching the wanted paths, user data is a cjson_stream_fields_t
+ * @param value Value
+ * @param user_data Fields to be extracted
+ */
+void cjson_stream_extract_cb(const cjson_stream_value_t *value, void *user_data);
+
+/**
+ * @brief Initialize DOM tree builder
+ * @param dom DOM tree builder
+ * @param path Path of the value to be built
+ */
+void cjson_stream_dom_init(cjson_stream_dom_t *dom, const char *path);
+
+/**
+ * @brief Callback building a DOM tree of the value matching the wanted path, user data is a cjson_stream_dom_t
+ * @param value Value
+ * @param user_data DOM tree builder
+ */
+void cjson_stream_dom_cb(const cjson_stream_value_t *value, void *user_data);
+
+/**
+ * @brief Release DOM tree builder, the DOM tree is returned to the caller which is responsible to release it
+ * @param dom DOM tree builder
+ * @return DOM tree, NULL if the value has not been found or if the tree is incomplete
+ */
+cJSON *cjson_stream_dom_release(cjson_stream_dom_t *dom);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CJSON_STREAM_H__ */
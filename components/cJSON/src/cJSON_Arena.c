@@ -0,0 +1,194 @@
+/**
+ * @file      cJSON_Arena.c
+ * @brief     Arena allocator used by cJSON, reset when all the items are released
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include "cJSON.h"
+#include "cJSON_Arena.h"
+
+/**
+ * @brief Alignment of the allocations
+ */
+#define CJSON_ARENA_ALIGNMENT (8)
+
+/**
+ * @brief Arena and its lock
+ * @note Allocations are done by bumping the offset, releasing an allocation only decrements the number of live allocations.
+ * The offset goes back to the beginning of the arena in O(1) when the last allocation is released, which is the case when a request is completed.
+ */
+static uint8_t __aligned(CJSON_ARENA_ALIGNMENT) cjson_arena[CONFIG_CJSON_ARENA_SIZE];
+static size_t                                   cjson_arena_offset     = 0;
+static size_t                                   cjson_arena_live       = 0;
+static size_t                                   cjson_arena_high_water = 0;
+static uint32_t                                 cjson_arena_resets     = 0;
+static uint32_t                                 cjson_arena_fallbacks  = 0;
+static struct k_spinlock                        cjson_arena_lock;
+
+/**
+ * @brief Thread owning the arena, only its allocations are done in the arena, and the lock of the scope
+ * @note Allocations of the other threads, and of the owner thread outside of the scope, are done in the heap
+ */
+static k_tid_t cjson_arena_owner = NULL;
+static K_MUTEX_DEFINE(cjson_arena_scope_mutex);
+
+/**
+ * @brief Check if a pointer belongs to the arena
+ * @param ptr Pointer
+ * @return true if the pointer belongs to the arena, false otherwise
+ */
+static inline bool
+cjson_arena_contains(void *ptr) {
+
+    return ((uint8_t *)ptr >= cjson_arena) && ((uint8_t *)ptr < &cjson_arena[CONFIG_CJSON_ARENA_SIZE]);
+}
+
+/**
+ * @brief Allocate memory, used as cJSON malloc hook
+ * @param size Size of the allocation
+ * @return Pointer to the allocated memory, NULL if the allocation failed
+ */
+static void *
+cjson_arena_malloc(size_t size) {
+
+    void            *ptr  = NULL;
+    size_t           want = ROUND_UP(size, CJSON_ARENA_ALIGNMENT);
+    k_spinlock_key_t key  = k_spin_lock(&cjson_arena_lock);
+
+    /* Allocate in the arena if the calling thread owns it and if it is not full */
+    if (k_current_get() == cjson_arena_owner) {
+        if (want <= CONFIG_CJSON_ARENA_SIZE - cjson_arena_offset) {
+            ptr = &cjson_arena[cjson_arena_offset];
+            cjson_arena_offset += want;
+            cjson_arena_high_water = MAX(cjson_arena_high_water, cjson_arena_offset);
+            cjson_arena_live++;
+        } else {
+            cjson_arena_fallbacks++;
+        }
+    }
+    k_spin_unlock(&cjson_arena_lock, key);
+
+    /* Fallback to the heap */
+    if (NULL == ptr) {
+        ptr = malloc(size);
+    }
+
+    return ptr;
+}
+
+/**
+ * @brief Release memory, used as cJSON free hook
+ * @param ptr Pointer to the memory to be released
+ */
+static void
+cjson_arena_free(void *ptr) {
+
+    if (NULL == ptr) {
+        return;
+    }
+
+    /* Release memory allocated in the heap */
+    if (true != cjson_arena_contains(ptr)) {
+        free(ptr);
+        return;
+    }
+
+    /* Reset the arena when the last allocation is released */
+    k_spinlock_key_t key = k_spin_lock(&cjson_arena_lock);
+    if (0 == --cjson_arena_live) {
+        cjson_arena_offset = 0;
+        cjson_arena_resets++;
+    }
+    k_spin_unlock(&cjson_arena_lock, key);
+}
+
+void
+cjson_arena_begin(void) {
+
+    /* One scope at a time */
+    k_mutex_lock(&cjson_arena_scope_mutex, K_FOREVER);
+
+    k_spinlock_key_t key = k_spin_lock(&cjson_arena_lock);
+    cjson_arena_owner    = k_current_get();
+    k_spin_unlock(&cjson_arena_lock, key);
+}
+
+int
+cjson_arena_end(void) {
+
+    int              ret = 0;
+    k_spinlock_key_t key = k_spin_lock(&cjson_arena_lock);
+
+    /* The arena is reset when the last allocation is released, it must be empty at the end of the scope */
+    cjson_arena_owner = NULL;
+    if (0 != cjson_arena_live) {
+        ret = -EBUSY;
+    }
+    k_spin_unlock(&cjson_arena_lock, key);
+
+    k_mutex_unlock(&cjson_arena_scope_mutex);
+
+    return ret;
+}
+
+void
+cjson_arena_stats(cjson_arena_stats_t *stats) {
+
+    k_spinlock_key_t key = k_spin_lock(&cjson_arena_lock);
+
+    stats->size       = CONFIG_CJSON_ARENA_SIZE;
+    stats->used       = cjson_arena_offset;
+    stats->high_water = cjson_arena_high_water;
+    stats->live       = cjson_arena_live;
+    stats->resets     = cjson_arena_resets;
+    stats->fallbacks  = cjson_arena_fallbacks;
+    k_spin_unlock(&cjson_arena_lock, key);
+}
+
+void
+cjson_arena_stats_reset(void) {
+
+    k_spinlock_key_t key = k_spin_lock(&cjson_arena_lock);
+
+    cjson_arena_high_water = cjson_arena_offset;
+    cjson_arena_resets     = 0;
+    cjson_arena_fallbacks  = 0;
+    k_spin_unlock(&cjson_arena_lock, key);
+}
+
+/**
+ * @brief Install the arena hooks, before any cJSON item is allocated
+ * @note Outside of a scope the hooks only forward to malloc and free, so that memory returned by cJSON can still be released with free()
+ * @return 0
+ */
+static int
+cjson_arena_init(void) {
+
+    cJSON_Hooks hooks = { .malloc_fn = cjson_arena_malloc, .free_fn = cjson_arena_free };
+
+    cJSON_InitHooks(&hooks);
+
+    return 0;
+}
+
+SYS_INIT(cjson_arena_init, POST_KERNEL, 0);
@@ -0,0 +1,808 @@
+/**
+ * @file      cJSON_Stream.c
+ * @brief     Streaming JSON parser, values are extracted using callbacks with fixed RAM usage
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON_Stream.h"
+
+/**
+ * @brief States of the parser
+ */
+#define CJSON_STREAM_STATE_VALUE        (0)  /**< Expecting a value */
+#define CJSON_STREAM_STATE_VALUE_OR_END (1)  /**< Expecting the first value of an array or its end */
+#define CJSON_STREAM_STATE_KEY_OR_END   (2)  /**< Expecting the first key of an object or its end */
+#define CJSON_STREAM_STATE_KEY_START    (3)  /**< Expecting a key */
+#define CJSON_STREAM_STATE_KEY          (4)  /**< Parsing a key */
+#define CJSON_STREAM_STATE_COLON        (5)  /**< Expecting a colon */
+#define CJSON_STREAM_STATE_STRING       (6)  /**< Parsing a string */
+#define CJSON_STREAM_STATE_ESCAPE       (7)  /**< Parsing an escape sequence */
+#define CJSON_STREAM_STATE_UNICODE      (8)  /**< Parsing an unicode escape sequence */
+#define CJSON_STREAM_STATE_LITERAL      (9)  /**< Parsing a number or a literal */
+#define CJSON_STREAM_STATE_AFTER_VALUE  (10) /**< Expecting a comma or the end of the container */
+#define CJSON_STREAM_STATE_DONE         (11) /**< Document is complete */
+#define CJSON_STREAM_STATE_SURROGATE    (12) /**< Expecting the escape sequence of the low surrogate of an unicode character */
+
+/**
+ * @brief Check if a character is a white space
+ * @param c Character
+ * @return true if the character is a white space, false otherwise
+ */
+static inline bool
+cjson_stream_is_space(char c) {
+
+    return (' ' == c) || ('\t' == c) || ('\n' == c) || ('\r' == c);
+}
+
+/**
+ * @brief Check if a character is part of a number or a literal
+ * @param c Character
+ * @return true if the character is part of a number or a literal, false otherwise
+ */
+static inline bool
+cjson_stream_is_literal(char c) {
+
+    return ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z')) || ('-' == c) || ('+' == c) || ('.' == c) || ('E' == c);
+}
+
+/**
+ * @brief Check if a number follows the JSON grammar, hexadecimal, leading zeros, nan and inf are rejected
+ * @param number Number, NUL terminated
+ * @return true if the number is valid, false otherwise
+ */
+static bool
+cjson_stream_is_number(const char *number) {
+
+    const char *c = number;
+
+    /* Optional minus sign, then zero or a non-zero digit followed by digits */
+    if ('-' == *c) {
+        c++;
+    }
+    if ('0' == *c) {
+        c++;
+    } else if ((*c >= '1') && (*c <= '9')) {
+        while ((*c >= '0') && (*c <= '9')) {
+            c++;
+        }
+    } else {
+        return false;
+    }
+
+    /* Optional fraction */
+    if ('.' == *c) {
+        c++;
+        if ((*c < '0') || (*c > '9')) {
+            return false;
+        }
+        while ((*c >= '0') && (*c <= '9')) {
+            c++;
+        }
+    }
+
+    /* Optional exponent */
+    if (('e' == *c) || ('E' == *c)) {
+        c++;
+        if (('+' == *c) || ('-' == *c)) {
+            c++;
+        }
+        if ((*c < '0') || (*c > '9')) {
+            return false;
+        }
+        while ((*c >= '0') && (*c <= '9')) {
+            c++;
+        }
+    }
+
+    return '\0' == *c;
+}
+
+/**
+ * @brief Invoke the callback
+ * @param stream Streaming parser context
+ * @param event Event
+ * @param data Data of strings and numbers
+ * @param length Length of the data
+ * @param last Last fragment of a string
+ */
+static void
+cjson_stream_emit(cjson_stream_t *stream, cjson_stream_event_t event, const char *data, size_t length, bool last) {
+
+    cjson_stream_value_t value = { .event  = event,
+                                   .path   = stream->path,
+                                   .key    = (stream->key_offset >= 0) ? &stream->path[stream->key_offset] : NULL,
+                                   .data   = data,
+                                   .length = length,
+                                   .last   = last };
+
+    stream->callback(&value, stream->user_data);
+}
+
+/**
+ * @brief Set the path of the current value to the path of the container
+ * @param stream Streaming parser context
+ */
+static void
+cjson_stream_path_restore(cjson_stream_t *stream) {
+
+    cjson_stream_level_t *level = &stream->levels[stream->depth - 1];
+
+    stream->path_length               = level->path_length;
+    stream->key_offset                = level->key_offset;
+    stream->path[stream->path_length] = '\0';
+}
+
+/**
+ * @brief Append data to the path of the current value
+ * @param stream Streaming parser context
+ * @param data Data
+ * @param length Length of the data
+ * @return 0 if the function succeeds, -ENOMEM if the path is too long
+ */
+static int
+cjson_stream_path_append(cjson_stream_t *stream, const char *data, size_t length) {
+
+    if (stream->path_length + length >= CONFIG_CJSON_STREAM_PATH_SIZE) {
+        return -ENOMEM;
+    }
+    memcpy(&stream->path[stream->path_length], data, length);
+    stream->path_length += length;
+    stream->path[stream->path_length] = '\0';
+
+    return 0;
+}
+
+/**
+ * @brief Prepare the path of an array element
+ * @param stream Streaming parser context
+ * @return 0 if the function succeeds, -ENOMEM if the path is too long
+ */
+static int
+cjson_stream_path_element(cjson_stream_t *stream) {
+
+    char index[12];
+    int  length;
+
+    if ((0 == stream->depth) || (true != stream->levels[stream->depth - 1].array)) {
+        return 0;
+    }
+    cjson_stream_path_restore(stream);
+    stream->key_offset = -1;
+    length             = snprintf(index, sizeof(index), "[%u]", (unsigned int)stream->levels[stream->depth - 1].index);
+
+    return cjson_stream_path_append(stream, index, (size_t)length);
+}
+
+/**
+ * @brief Indicate the end of a value
+ * @param stream Streaming parser context
+ */
+static void
+cjson_stream_value_end(cjson_stream_t *stream) {
+
+    stream->state = (0 == stream->depth) ? CJSON_STREAM_STATE_DONE : CJSON_STREAM_STATE_AFTER_VALUE;
+}
+
+/**
+ * @brief Open a container
+ * @param stream Streaming parser context
+ * @param array Container is an array
+ * @return 0 if the function succeeds, -ENOMEM if the maximum depth is reached
+ */
+static int
+cjson_stream_open(cjson_stream_t *stream, bool array) {
+
+    if (stream->depth >= CONFIG_CJSON_STREAM_MAX_DEPTH) {
+        return -ENOMEM;
+    }
+    cjson_stream_emit(stream, (true == array) ? CJSON_STREAM_EVENT_ARRAY_START : CJSON_STREAM_EVENT_OBJECT_START, NULL, 0, true);
+    stream->levels[stream->depth].path_length = (uint16_t)stream->path_length;
+    stream->levels[stream->depth].key_offset  = stream->key_offset;
+    stream->levels[stream->depth].index       = 0;
+    stream->levels[stream->depth].array       = array;
+    stream->depth++;
+    stream->state = (true == array) ? CJSON_STREAM_STATE_VALUE_OR_END : CJSON_STREAM_STATE_KEY_OR_END;
+
+    return 0;
+}
+
+/**
+ * @brief Close a container
+ * @param stream Streaming parser context
+ * @param array Container is an array
+ * @return 0 if the function succeeds, -EINVAL if the container does not match
+ */
+static int
+cjson_stream_close(cjson_stream_t *stream, bool array) {
+
+    if ((0 == stream->depth) || (array != stream->levels[stream->depth - 1].array)) {
+        return -EINVAL;
+    }
+    cjson_stream_path_restore(stream);
+    stream->depth--;
+    cjson_stream_emit(stream, (true == array) ? CJSON_STREAM_EVENT_ARRAY_END : CJSON_STREAM_EVENT_OBJECT_END, NULL, 0, true);
+    cjson_stream_value_end(stream);
+
+    return 0;
+}
+
+/**
+ * @brief Start parsing a key
+ * @param stream Streaming parser context
+ * @return 0 if the function succeeds, -ENOMEM if the path is too long
+ */
+static int
+cjson_stream_key_start(cjson_stream_t *stream) {
+
+    int ret = 0;
+
+    cjson_stream_path_restore(stream);
+    if (0 != stream->path_length) {
+        ret = cjson_stream_path_append(stream, ".", 1);
+    }
+    stream->key_offset = (int16_t)stream->path_length;
+    stream->state      = CJSON_STREAM_STATE_KEY;
+
+    return ret;
+}
+
+/**
+ * @brief Finish parsing a number or a literal
+ * @param stream Streaming parser context
+ * @return 0 if the function succeeds, -EINVAL if the literal is invalid
+ */
+static int
+cjson_stream_literal_end(cjson_stream_t *stream) {
+
+    stream->literal[stream->literal_length] = '\0';
+    if (0 == strcmp(stream->literal, "true")) {
+        cjson_stream_emit(stream, CJSON_STREAM_EVENT_TRUE, NULL, 0, true);
+    } else if (0 == strcmp(stream->literal, "false")) {
+        cjson_stream_emit(stream, CJSON_STREAM_EVENT_FALSE, NULL, 0, true);
+    } else if (0 == strcmp(stream->literal, "null")) {
+        cjson_stream_emit(stream, CJSON_STREAM_EVENT_NULL, NULL, 0, true);
+    } else {
+        if (true != cjson_stream_is_number(stream->literal)) {
+            return -EINVAL;
+        }
+        cjson_stream_emit(stream, CJSON_STREAM_EVENT_NUMBER, stream->literal, stream->literal_length, true);
+    }
+    cjson_stream_value_end(stream);
+
+    return 0;
+}
+
+/**
+ * @brief Output a decoded character of a key or of a string
+ * @param stream Streaming parser context
+ * @param data Decoded character, UTF-8 encoded
+ * @param length Length of the decoded character
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cjson_stream_decoded(cjson_stream_t *stream, const char *data, size_t length) {
+
+    if (CJSON_STREAM_STATE_KEY == stream->escape_state) {
+        return cjson_stream_path_append(stream, data, length);
+    }
+    cjson_stream_emit(stream, CJSON_STREAM_EVENT_STRING, data, length, false);
+
+    return 0;
+}
+
+/**
+ * @brief Output a decoded unicode character of a key or of a string
+ * @param stream Streaming parser context
+ * @param unicode Code point
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cjson_stream_unicode(cjson_stream_t *stream, uint32_t unicode) {
+
+    char utf8[4];
+
+    if (unicode < 0x80) {
+        utf8[0] = (char)unicode;
+        return cjson_stream_decoded(stream, utf8, 1);
+    } else if (unicode < 0x800) {
+        utf8[0] = (char)(0xc0 | (unicode >> 6));
+        utf8[1] = (char)(0x80 | (unicode & 0x3f));
+        return cjson_stream_decoded(stream, utf8, 2);
+    } else if (unicode < 0x10000) {
+        utf8[0] = (char)(0xe0 | (unicode >> 12));
+        utf8[1] = (char)(0x80 | ((unicode >> 6) & 0x3f));
+        utf8[2] = (char)(0x80 | (unicode & 0x3f));
+        return cjson_stream_decoded(stream, utf8, 3);
+    }
+    utf8[0] = (char)(0xf0 | (unicode >> 18));
+    utf8[1] = (char)(0x80 | ((unicode >> 12) & 0x3f));
+    utf8[2] = (char)(0x80 | ((unicode >> 6) & 0x3f));
+    utf8[3] = (char)(0x80 | (unicode & 0x3f));
+
+    return cjson_stream_decoded(stream, utf8, 4);
+}
+
+/**
+ * @brief Output the pending high surrogate as U+FFFD, it is not followed by a low surrogate
+ * @param stream Streaming parser context
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cjson_stream_surrogate_flush(cjson_stream_t *stream) {
+
+    if (0 == stream->surrogate) {
+        return 0;
+    }
+    stream->surrogate = 0;
+
+    return cjson_stream_unicode(stream, 0xfffd);
+}
+
+/**
+ * @brief Parse a character of an escape sequence
+ * @param stream Streaming parser context
+ * @param c Character
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cjson_stream_escape(cjson_stream_t *stream, char c) {
+
+    static const char escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+    int               ret;
+
+    if (CJSON_STREAM_STATE_ESCAPE == stream->state) {
+        if ('u' == c) {
+            stream->unicode       = 0;
+            stream->unicode_count = 0;
+            stream->state         = CJSON_STREAM_STATE_UNICODE;
+            return 0;
+        }
+        if (0 != (ret = cjson_stream_surrogate_flush(stream))) {
+            return ret;
+        }
+        for (size_t index = 0; index < sizeof(escapes) - 1; index += 2) {
+            if (c == escapes[index]) {
+                stream->state = stream->escape_state;
+                return cjson_stream_decoded(stream, &escapes[index + 1], 1);
+            }
+        }
+        return -EINVAL;
+    }
+
+    /* Unicode escape sequence */
+    if ((c >= '0') && (c <= '9')) {
+        stream->unicode = (stream->unicode << 4) | (uint32_t)(c - '0');
+    } else if (((c | 0x20) >= 'a') && ((c | 0x20) <= 'f')) {
+        stream->unicode = (stream->unicode << 4) | (uint32_t)((c | 0x20) - 'a' + 10);
+    } else {
+        return -EINVAL;
+    }
+    if (++stream->unicode_count < 4) {
+        return 0;
+    }
+    stream->state = stream->escape_state;
+
+    /* Combine the low surrogate with the pending high surrogate */
+    if ((0 != stream->surrogate) && (stream->unicode >= 0xdc00) && (stream->unicode <= 0xdfff)) {
+        stream->unicode   = 0x10000 + ((stream->surrogate - 0xd800) << 10) + (stream->unicode - 0xdc00);
+        stream->surrogate = 0;
+        return cjson_stream_unicode(stream, stream->unicode);
+    }
+    if (0 != (ret = cjson_stream_surrogate_flush(stream))) {
+        return ret;
+    }
+
+    /* A high surrogate is expected to be followed by the escape sequence of the low surrogate */
+    if ((stream->unicode >= 0xd800) && (stream->unicode <= 0xdbff)) {
+        stream->surrogate = stream->unicode;
+        stream->state     = CJSON_STREAM_STATE_SURROGATE;
+        return 0;
+    }
+
+    /* Lone low surrogates are replaced by U+FFFD */
+    if ((stream->unicode >= 0xdc00) && (stream->unicode <= 0xdfff)) {
+        stream->unicode = 0xfffd;
+    }
+
+    return cjson_stream_unicode(stream, stream->unicode);
+}
+
+/**
+ * @brief Parse the beginning of a value
+ * @param stream Streaming parser context
+ * @param c Character
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cjson_stream_value(cjson_stream_t *stream, char c) {
+
+    int ret;
+
+    if (0 != (ret = cjson_stream_path_element(stream))) {
+        return ret;
+    }
+    if ('{' == c) {
+        return cjson_stream_open(stream, false);
+    } else if ('[' == c) {
+        return cjson_stream_open(stream, true);
+    } else if ('"' == c) {
+        stream->state = CJSON_STREAM_STATE_STRING;
+        return 0;
+    } else if (('-' == c) || ((c >= '0') && (c <= '9')) || ('t' == c) || ('f' == c) || ('n' == c)) {
+        stream->literal[0]     = c;
+        stream->literal_length = 1;
+        stream->state          = CJSON_STREAM_STATE_LITERAL;
+        return 0;
+    }
+
+    return -EINVAL;
+}
+
+void
+cjson_stream_init(cjson_stream_t *stream, cjson_stream_cb_t callback, void *user_data) {
+
+    assert(NULL != stream);
+    assert(NULL != callback);
+
+    memset(stream, 0, sizeof(cjson_stream_t));
+    stream->callback   = callback;
+    stream->user_data  = user_data;
+    stream->state      = CJSON_STREAM_STATE_VALUE;
+    stream->key_offset = -1;
+}
+
+int
+cjson_stream_feed(cjson_stream_t *stream, const char *data, size_t length) {
+
+    assert(NULL != stream);
+    size_t index = 0;
+    size_t begin;
+    char   c;
+    int    ret = 0;
+
+    /* Errors are sticky */
+    if (0 != stream->error) {
+        return stream->error;
+    }
+
+    while ((0 == ret) && (index < length)) {
+        c = data[index];
+        switch (stream->state) {
+            case CJSON_STREAM_STATE_VALUE:
+                if (true != cjson_stream_is_space(c)) {
+                    ret = cjson_stream_value(stream, c);
+                }
+                index++;
+                break;
+            case CJSON_STREAM_STATE_VALUE_OR_END:
+                if (']' == c) {
+                    ret = cjson_stream_close(stream, true);
+                } else if (true != cjson_stream_is_space(c)) {
+                    ret = cjson_stream_value(stream, c);
+                }
+                index++;
+                break;
+            case CJSON_STREAM_STATE_KEY_OR_END:
+            case CJSON_STREAM_STATE_KEY_START:
+                if (('}' == c) && (CJSON_STREAM_STATE_KEY_OR_END == stream->state)) {
+                    ret = cjson_stream_close(stream, false);
+                } else if ('"' == c) {
+                    ret = cjson_stream_key_start(stream);
+                } else if (true != cjson_stream_is_space(c)) {
+                    ret = -EINVAL;
+                }
+                index++;
+                break;
+            case CJSON_STREAM_STATE_KEY:
+                if ('"' == c) {
+                    stream->state = CJSON_STREAM_STATE_COLON;
+                } else if ('\\' == c) {
+                    stream->escape_state = CJSON_STREAM_STATE_KEY;
+                    stream->state        = CJSON_STREAM_STATE_ESCAPE;
+                } else if ((unsigned char)c < 0x20) {
+                    ret = -EINVAL;
+                } else {
+                    ret = cjson_stream_path_append(stream, &c, 1);
+                }
+                index++;
+                break;
+            case CJSON_STREAM_STATE_COLON:
+                if (':' == c) {
+                    stream->state = CJSON_STREAM_STATE_VALUE;
+                } else if (true != cjson_stream_is_space(c)) {
+                    ret = -EINVAL;
+                }
+                index++;
+                break;
+            case CJSON_STREAM_STATE_STRING:
+                /* Emit the longest run of characters without escape sequence directly from the chunk */
+                begin = index;
+                while ((index < length) && ('"' != data[index]) && ('\\' != data[index]) && ((unsigned char)data[index] >= 0x20)) {
+                    index++;
+                }
+                if (index >= length) {
+                    if (index > begin) {
+                        cjson_stream_emit(stream, CJSON_STREAM_EVENT_STRING, &data[begin], index - begin, false);
+                    }
+                } else if ('"' == data[index]) {
+                    cjson_stream_emit(stream, CJSON_STREAM_EVENT_STRING, &data[begin], index - begin, true);
+                    cjson_stream_value_end(stream);
+                    index++;
+                } else if ('\\' == data[index]) {
+                    if (index > begin) {
+                        cjson_stream_emit(stream, CJSON_STREAM_EVENT_STRING, &data[begin], index - begin, false);
+                    }
+                    stream->escape_state = CJSON_STREAM_STATE_STRING;
+                    stream->state        = CJSON_STREAM_STATE_ESCAPE;
+                    index++;
+                } else {
+                    ret = -EINVAL;
+                }
+                break;
+            case CJSON_STREAM_STATE_ESCAPE:
+            case CJSON_STREAM_STATE_UNICODE:
+                ret = cjson_stream_escape(stream, c);
+                index++;
+                break;
+            case CJSON_STREAM_STATE_SURROGATE:
+                if ('\\' == c) {
+                    stream->state = CJSON_STREAM_STATE_ESCAPE;
+                    index++;
+                } else {
+                    /* The character following the high surrogate is parsed again in the key or in the string */
+                    stream->state = stream->escape_state;
+                    ret           = cjson_stream_surrogate_flush(stream);
+                }
+                break;
+            case CJSON_STREAM_STATE_LITERAL:
+                if (true == cjson_stream_is_literal(c)) {
+                    if (stream->literal_length >= CONFIG_CJSON_STREAM_LITERAL_SIZE) {
+                        ret = -ENOMEM;
+                    } else {
+                        stream->literal[stream->literal_length++] = c;
+                    }
+                    index++;
+                } else {
+                    /* The character following the literal is parsed again in the next state */
+                    ret = cjson_stream_literal_end(stream);
+                }
+                break;
+            case CJSON_STREAM_STATE_AFTER_VALUE:
+                if (',' == c) {
+                    if (true == stream->levels[stream->depth - 1].array) {
+                        stream->levels[stream->depth - 1].index++;
+                        stream->state = CJSON_STREAM_STATE_VALUE;
+                    } else {
+                        stream->state = CJSON_STREAM_STATE_KEY_START;
+                    }
+                } else if (('}' == c) || (']' == c)) {
+                    ret = cjson_stream_close(stream, (']' == c));
+                } else if (true != cjson_stream_is_space(c)) {
+                    ret = -EINVAL;
+                }
+                index++;
+                break;
+            case CJSON_STREAM_STATE_DONE:
+            default:
+                if (true != cjson_stream_is_space(c)) {
+                    ret = -EINVAL;
+                }
+                index++;
+                break;
+        }
+    }
+    stream->error = ret;
+
+    return ret;
+}
+
+int
+cjson_stream_finish(cjson_stream_t *stream) {
+
+    assert(NULL != stream);
+
+    /* A number at the root of the document is only terminated by the end of the document */
+    if ((0 == stream->error) && (CJSON_STREAM_STATE_LITERAL == stream->state)) {
+        stream->error = cjson_stream_literal_end(stream);
+    }
+    if (0 != stream->error) {
+        return stream->error;
+    }
+
+    return (CJSON_STREAM_STATE_DONE == stream->state) ? 0 : -ENODATA;
+}
+
+void
+cjson_stream_extract_cb(const cjson_stream_value_t *value, void *user_data) {
+
+    assert(NULL != value);
+    assert(NULL != user_data);
+    cjson_stream_fields_t *fields = (cjson_stream_fields_t *)user_data;
+    cjson_stream_field_t  *field;
+    const char            *data;
+    size_t                 length;
+
+    /* Containers are not extracted */
+    if ((CJSON_STREAM_EVENT_OBJECT_START == value->event) || (CJSON_STREAM_EVENT_OBJECT_END == value->event)
+        || (CJSON_STREAM_EVENT_ARRAY_START == value->event) || (CJSON_STREAM_EVENT_ARRAY_END == value->event)) {
+        return;
+    }
+
+    for (size_t index = 0; index < fields->count; index++) {
+        field = &fields->fields[index];
+        if (0 != strcmp(field->path, value->path)) {
+            continue;
+        }
+
+        /* Retrieve data, literals are saved as they appear in the document */
+        if (CJSON_STREAM_EVENT_TRUE == value->event) {
+            data = "true";
+        } else if (CJSON_STREAM_EVENT_FALSE == value->event) {
+            data = "false";
+        } else if (CJSON_STREAM_EVENT_NULL == value->event) {
+            data = "null";
+        } else {
+            data = value->data;
+        }
+        length = (NULL != value->data) ? value->length : strlen(data);
+
+        /* Append data to the buffer, the first fragment of a value resets the field so that a duplicate key replaces the previous value */
+        if (true != field->partial) {
+            field->found     = true;
+            field->length    = 0;
+            field->truncated = false;
+        }
+        field->partial = (true != value->last);
+        if (0 == field->size) {
+            /* Not even the NUL terminator can be saved */
+            field->truncated = true;
+            continue;
+        }
+        if (field->length + length >= field->size) {
+            length           = (field->size > field->length + 1) ? (field->size - field->length - 1) : 0;
+            field->truncated = true;
+        }
+        memcpy(&field->buffer[field->length], data, length);
+        field->length += length;
+        field->buffer[field->length] = '\0';
+    }
+}
+
+void
+cjson_stream_dom_init(cjson_stream_dom_t *dom, const char *path) {
+
+    assert(NULL != dom);
+    assert(NULL != path);
+
+    memset(dom, 0, sizeof(cjson_stream_dom_t));
+    dom->path = path;
+}
+
+/**
+ * @brief Append an item to the DOM tree
+ * @param dom DOM tree builder
+ * @param value Value
+ * @param item Item to be appended
+ */
+static void
+cjson_stream_dom_append(cjson_stream_dom_t *dom, const cjson_stream_value_t *value, cJSON *item) {
+
+    cJSON *parent;
+
+    if (NULL == item) {
+        dom->error = true;
+        return;
+    }
+    if (0 == dom->depth) {
+        dom->root = item;
+        return;
+    }
+    parent = dom->stack[dom->depth - 1];
+    if (true == cJSON_IsArray(parent)) {
+        cJSON_AddItemToArray(parent, item);
+    } else if (NULL != cJSON_GetObjectItemCaseSensitive(parent, value->key)) {
+        /* Duplicate key, the last value replaces the previous one */
+        cJSON_ReplaceItemInObjectCaseSensitive(parent, value->key, item);
+    } else {
+        cJSON_AddItemToObject(parent, value->key, item);
+    }
+}
+
+void
+cjson_stream_dom_cb(const cjson_stream_value_t *value, void *user_data) {
+
+    assert(NULL != value);
+    assert(NULL != user_data);
+    cjson_stream_dom_t *dom = (cjson_stream_dom_t *)user_data;
+    cJSON              *item;
+    char               *string;
+
+    /* Only the value matching the path is built, once */
+    if ((true == dom->error) || ((0 == dom->depth) && ((NULL != dom->root) || (0 != strcmp(dom->path, value->path))))) {
+        return;
+    }
+
+    switch (value->event) {
+        case CJSON_STREAM_EVENT_OBJECT_START:
+        case CJSON_STREAM_EVENT_ARRAY_START:
+            item = (CJSON_STREAM_EVENT_OBJECT_START == value->event) ? cJSON_CreateObject() : cJSON_CreateArray();
+            cjson_stream_dom_append(dom, value, item);
+            if (true != dom->error) {
+                dom->stack[dom->depth++] = item;
+            }
+            break;
+        case CJSON_STREAM_EVENT_OBJECT_END:
+        case CJSON_STREAM_EVENT_ARRAY_END:
+            dom->depth--;
+            break;
+        case CJSON_STREAM_EVENT_STRING:
+            /* Concatenate fragments of the string */
+            if (NULL == (string = (char *)realloc(dom->string, dom->string_length + value->length + 1))) {
+                dom->error = true;
+                break;
+            }
+            memcpy(&string[dom->string_length], value->data, value->length);
+            dom->string = string;
+            dom->string_length += value->length;
+            dom->string[dom->string_length] = '\0';
+            if (true == value->last) {
+                cjson_stream_dom_append(dom, value, cJSON_CreateString(dom->string));
+                free(dom->string);
+                dom->string        = NULL;
+                dom->string_length = 0;
+            }
+            break;
+        case CJSON_STREAM_EVENT_NUMBER:
+            cjson_stream_dom_append(dom, value, cJSON_CreateNumber(strtod(value->data, NULL)));
+            break;
+        case CJSON_STREAM_EVENT_TRUE:
+        case CJSON_STREAM_EVENT_FALSE:
+            cjson_stream_dom_append(dom, value, cJSON_CreateBool(CJSON_STREAM_EVENT_TRUE == value->event));
+            break;
+        case CJSON_STREAM_EVENT_NULL:
+        default:
+            cjson_stream_dom_append(dom, value, cJSON_CreateNull());
+            break;
+    }
+}
+
+cJSON *
+cjson_stream_dom_release(cjson_stream_dom_t *dom) {
+
+    assert(NULL != dom);
+    cJSON *root = dom->root;
+
+    /* Release partial string */
+    if (NULL != dom->string) {
+        free(dom->string);
+        dom->string = NULL;
+    }
+
+    /* The DOM tree is only returned if it is complete */
+    if ((true == dom->error) || (0 != dom->depth)) {
+        cJSON_Delete(root);
+        root = NULL;
+    }
+    dom->root = NULL;
+
+    return root;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file      example-auth-cache.h
+ * @brief     Cache of the authentication token, the token is reused after a warm reboot
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_AUTH_CACHE_H__
+#define __EXAMPLE_AUTH_CACHE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-http.h"
+
+/**
+ * @brief Initialize the authentication token cache, the token saved before the reboot is loaded if it is still valid
+ * @note This function must be called before the mender client is activated
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_auth_cache_init(void);
+
+/**
+ * @brief Invalidate the authentication token saved in the cache
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_auth_cache_invalidate(void);
+
+/**
+ * @brief Perform HTTP request, the authentication request is answered with the cached token if it is valid
+ * @note This function is called by the wrapper of mender_http_perform, parameters are the same
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_auth_cache_http_perform(char                *jwt,
+                                             char                *path,
+                                             mender_http_method_t method,
+                                             char                *payload,
+                                             char                *signature,
+                                             mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *),
+                                             void *params,
+                                             int  *status);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_AUTH_CACHE_H__ */
@@ -0,0 +1,99 @@
+/**
+ * @file      example-crypto.h
+ * @brief     Crypto backend offloading AES and SHA-256 to the hardware when it is available
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_CRYPTO_H__
+#define __EXAMPLE_CRYPTO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <mbedtls/sha256.h>
+
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_HASH
+#include <zephyr/crypto/crypto.h>
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_HASH */
+
+#include "mender-common.h"
+
+/**
+ * @brief SHA-256 digest size
+ */
+#define EXAMPLE_CRYPTO_SHA256_SIZE (32)
+
+/**
+ * @brief SHA-256 context
+ */
+typedef struct {
+    mbedtls_sha256_context sw; /**< Software context, used if the hardware is not available */
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_HASH
+    struct hash_ctx hash; /**< Hardware hash session */
+    bool            hw;   /**< Hardware hash session is used */
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_HASH */
+} example_crypto_sha256_t;
+
+/**
+ * @brief Initialize the crypto backends
+ * @note The known answer tests are executed using the hardware backends, the software implementation is used if they fail
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_crypto_init(void);
+
+/**
+ * @brief Get name of the backends used for AES and SHA-256
+ * @param aes Name of the AES backend
+ * @param sha256 Name of the SHA-256 backend
+ */
+void example_crypto_backends(const char **aes, const char **sha256);
+
+/**
+ * @brief Start computing SHA-256 digest
+ * @param ctx SHA-256 context
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_crypto_sha256_start(example_crypto_sha256_t *ctx);
+
+/**
+ * @brief Update SHA-256 digest
+ * @param ctx SHA-256 context
+ * @param data Data
+ * @param length Length of the data
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_crypto_sha256_update(example_crypto_sha256_t *ctx, const uint8_t *data, size_t length);
+
+/**
+ * @brief Finish computing SHA-256 digest
+ * @param ctx SHA-256 context
+ * @param digest SHA-256 digest
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_crypto_sha256_finish(example_crypto_sha256_t *ctx, uint8_t digest[EXAMPLE_CRYPTO_SHA256_SIZE]);
+
+/**
+ * @brief Release SHA-256 context
+ * @param ctx SHA-256 context
+ */
+void example_crypto_sha256_free(example_crypto_sha256_t *ctx);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_CRYPTO_H__ */
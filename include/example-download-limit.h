@@ -0,0 +1,59 @@
+/**
+ * @file      example-download-limit.h
+ * @brief     Bandwidth and CPU limits of the download of the artifacts
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_DOWNLOAD_LIMIT_H__
+#define __EXAMPLE_DOWNLOAD_LIMIT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-client.h"
+
+/**
+ * @brief Apply the limits defined in the device configuration
+ * @note The keys are "download-rate-kbps" (0 for no limit), "download-priority" (-1 to keep the priority of the mender client thread) and
+ * "download-cpu-percent" (100 for no limit), missing keys keep their current value
+ * @param configuration Device configuration
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_download_limit_configure(mender_keystore_t *configuration);
+
+/**
+ * @brief Begin the download, the priority of the calling thread is changed and the limits are reset
+ * @note This function is called by the mender client thread when the downloading deployment status is reported
+ */
+void example_download_limit_begin(void);
+
+/**
+ * @brief Account a chunk of the artifact, the calling thread sleeps if the rate or the CPU budget are exceeded
+ * @param length Length of the chunk
+ */
+void example_download_limit_chunk(size_t length);
+
+/**
+ * @brief End the download, the priority of the calling thread is restored
+ */
+void example_download_limit_end(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_DOWNLOAD_LIMIT_H__ */
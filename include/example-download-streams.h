@@ -0,0 +1,55 @@
+/**
+ * @file      example-download-streams.h
+ * @brief     Download of the artifacts using parallel range requests
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_DOWNLOAD_STREAMS_H__
+#define __EXAMPLE_DOWNLOAD_STREAMS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-http.h"
+
+/**
+ * @brief Check if the request is the download of an artifact handled with parallel streams
+ * @param jwt Token, NULL for the download of the artifact
+ * @param path Path of the request, the download of the artifact uses the full URL of the artifact
+ * @param method Method
+ * @return true if the request is handled with parallel streams, false otherwise
+ */
+bool example_download_streams_match(char *jwt, char *path, mender_http_method_t method);
+
+/**
+ * @brief Download the artifact using parallel range requests, the data are given to the callback in order
+ * @param url URL of the artifact
+ * @param callback Callback invoked on the events of the request
+ * @param params Callback parameters
+ * @param status Status code of the response, 200 if the artifact is downloaded
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_download_streams_perform(char *url,
+                                              mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *),
+                                              void *params,
+                                              int  *status);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_DOWNLOAD_STREAMS_H__ */
@@ -0,0 +1,50 @@
+/**
+ * @file      example-flash.h
+ * @brief     Mender flash platform implementation, the checksum of the image is computed while it is written
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_FLASH_H__
+#define __EXAMPLE_FLASH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-common.h"
+
+#ifdef CONFIG_EXAMPLE_FLASH_PRE_ERASE
+
+/**
+ * @brief Initialize the pre-erase of the update slot
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_flash_init(void);
+
+/**
+ * @brief Start erasing the update slot in the background
+ * @note This function is called when a deployment is announced and when the image is confirmed, it does nothing if an upgrade is pending
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_flash_pre_erase_start(void);
+
+#endif /* CONFIG_EXAMPLE_FLASH_PRE_ERASE */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_FLASH_H__ */
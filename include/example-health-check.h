@@ -0,0 +1,75 @@
+/**
+ * @file      example-health-check.h
+ * @brief     Health check pipeline used to confirm or rollback the image
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_HEALTH_CHECK_H__
+#define __EXAMPLE_HEALTH_CHECK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-common.h"
+
+/**
+ * @brief Health check step
+ */
+typedef struct {
+    char *name;                /**< Name of the step */
+    mender_err_t (*run)(void); /**< Function of the step, returns MENDER_OK if the check passed */
+    int32_t timeout;           /**< Timeout of the step in milliseconds, the check is considered failed if it is reached */
+} example_health_check_step_t;
+
+/**
+ * @brief Health check callbacks
+ */
+typedef struct {
+    mender_err_t (*done)(mender_err_t status); /**< Invoked when the pipeline is done, status is MENDER_OK if all the checks passed */
+} example_health_check_callbacks_t;
+
+/**
+ * @brief Initialize health check pipeline
+ * @param callbacks Health check callbacks
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_health_check_init(example_health_check_callbacks_t *callbacks);
+
+/**
+ * @brief Register a health check step, steps are executed in the order of registration
+ * @param step Health check step, must remain valid until the pipeline is done
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_health_check_register(example_health_check_step_t *step);
+
+/**
+ * @brief Start execution of the health check pipeline in the background
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_health_check_run(void);
+
+/**
+ * @brief Wait for the health check pipeline to be done
+ * @return MENDER_OK if all the checks passed or if the pipeline has not been started, error code otherwise
+ */
+mender_err_t example_health_check_wait(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_HEALTH_CHECK_H__ */
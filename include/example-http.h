@@ -0,0 +1,54 @@
+/**
+ * @file      example-http.h
+ * @brief     HTTP requests of the mender-mcu-client intercepted by the application
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_HTTP_H__
+#define __EXAMPLE_HTTP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-http.h"
+
+/**
+ * @brief Perform HTTP request, function of the mender-mcu-client wrapped at link time
+ * @param jwt Token, NULL if not authenticated yet
+ * @param path Path of the request, or full URL of the artifact
+ * @param method Method
+ * @param payload Payload, NULL if no payload
+ * @param signature Signature of the payload, NULL if no signature
+ * @param callback Callback invoked on the events of the request
+ * @param params Callback parameters
+ * @param status Status code of the response
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t __real_mender_http_perform(char                *jwt,
+                                        char                *path,
+                                        mender_http_method_t method,
+                                        char                *payload,
+                                        char                *signature,
+                                        mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *),
+                                        void *params,
+                                        int  *status);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_HTTP_H__ */
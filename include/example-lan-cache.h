@@ -0,0 +1,57 @@
+/**
+ * @file      example-lan-cache.h
+ * @brief     Download of the artifacts from a cache of the local network
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_LAN_CACHE_H__
+#define __EXAMPLE_LAN_CACHE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-http.h"
+
+/**
+ * @brief Check if the request is the download of an artifact that can be served by the cache of the local network
+ * @param jwt Token, NULL for the download of the artifact
+ * @param path Path of the request, the download of the artifact uses the full URL of the artifact
+ * @param method Method
+ * @return true if the artifact can be downloaded from the cache, false otherwise
+ */
+bool example_lan_cache_match(char *jwt, char *path, mender_http_method_t method);
+
+/**
+ * @brief Download the artifact from the cache of the local network
+ * @param url URL of the artifact on the server
+ * @param callback Callback invoked on the events of the request
+ * @param params Callback parameters
+ * @param status Status code of the response, 200 if the artifact is downloaded
+ * @param ret Result of the download if it has been served by the cache
+ * @return true if the download has been served by the cache, even partially, false if the artifact must be downloaded from the server
+ */
+bool example_lan_cache_perform(char *url,
+                               mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *),
+                               void         *params,
+                               int          *status,
+                               mender_err_t *ret);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_LAN_CACHE_H__ */
@@ -0,0 +1,148 @@
+/**
+ * @file      example-llext.h
+ * @brief     LLEXT modules manager, modules are installed on a dedicated work queue
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_LLEXT_H__
+#define __EXAMPLE_LLEXT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <zephyr/kernel.h>
+#include <zephyr/llext/symbol.h>
+
+#include "mender-common.h"
+
+/**
+ * @brief Entry of the symbol index
+ */
+typedef struct {
+    uint32_t    hash;  /**< Hash of the name of the symbol */
+    const char *name;  /**< Name of the symbol, NULL if the entry is free */
+    const void *addr;  /**< Address of the symbol */
+    void       *owner; /**< Owner of the export table of the symbol */
+} example_llext_index_entry_t;
+
+/**
+ * @brief Symbol index, hash table with open addressing built from the export tables of the modules
+ */
+typedef struct {
+    example_llext_index_entry_t *entries; /**< Entries */
+    size_t                       size;    /**< Number of entries, must be a power of two */
+    size_t                       count;   /**< Number of symbols in the index */
+} example_llext_index_t;
+
+/**
+ * @brief Clear the symbol index
+ * @param index Symbol index
+ */
+void example_llext_index_clear(example_llext_index_t *index);
+
+/**
+ * @brief Add the symbols of an export table to the symbol index
+ * @param index Symbol index
+ * @param table Export table
+ * @param owner Owner of the export table, saved in the entries of its symbols
+ * @return 0 if the function succeeds, -ENOSPC if the index is full, -EEXIST if a symbol is already in the index
+ */
+int example_llext_index_add(example_llext_index_t *index, const struct llext_symtable *table, void *owner);
+
+/**
+ * @brief Find a symbol in the symbol index
+ * @param index Symbol index
+ * @param name Name of the symbol
+ * @return Address of the symbol, NULL if it is not found
+ */
+const void *example_llext_index_find(const example_llext_index_t *index, const char *name);
+
+/**
+ * @brief Initialize the module manager and the work queue used to install the LLEXT modules
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_llext_init(void);
+
+/**
+ * @brief Load a LLEXT module and add its exported symbols to the index, a resident module with the same name is replaced
+ * @note The other resident modules are not unloaded. The module being replaced remains available if the new module can't be loaded or
+ * if one of its exported symbols is already exported by another module. Addresses of the symbols of the replaced module must be resolved again,
+ * the module being replaced is unloaded once the references of its symbols are released, the caller must not hold one of them.
+ * @param name Name of the module
+ * @param data Module data, allocated with malloc, released by the function
+ * @param size Module size
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_llext_load(const char *name, void *data, size_t size);
+
+/**
+ * @brief Unload a resident LLEXT module and remove its exported symbols from the index
+ * @note The module is unloaded once the references of its symbols are released, the caller must not hold one of them
+ * @param name Name of the module
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_llext_unload(const char *name);
+
+/**
+ * @brief Find a symbol exported by the resident LLEXT modules using the symbol index, and take a reference of the module exporting it
+ * @param name Name of the symbol
+ * @param ref Reference of the module exporting the symbol, the module is not unloaded until it is released with example_llext_release
+ * @return Address of the symbol, NULL if it is not found, no reference is taken in this case
+ */
+const void *example_llext_find_sym(const char *name, void **ref);
+
+/**
+ * @brief Release the reference of a module taken by example_llext_find_sym, the address of the symbol must no longer be used
+ * @param ref Reference of the module
+ */
+void example_llext_release(void *ref);
+
+/**
+ * @brief Submit the installation of a LLEXT module, the module is loaded and its initialization function is called by the work queue
+ * @note The installation is cancelled if it is not done after CONFIG_EXAMPLE_LLEXT_INSTALL_TIMEOUT milliseconds, the work queue is aborted and
+ * recreated if the initialization function does not return. The mender client is triggered with mender_client_execute when the result is available.
+ * @param name Name of the module, a resident module with the same name is replaced
+ * @param symbol Name of the initialization function of the module, called once the module is loaded, the module remains resident
+ * @param data Module data, allocated with malloc, released by the work queue when the installation is done or by example_llext_install_abort
+ * @param size Module size
+ * @return MENDER_OK if the function succeeds, error code otherwise, data is released if the installation can't be submitted
+ */
+mender_err_t example_llext_install_start(const char *name, const char *symbol, void *data, size_t size);
+
+/**
+ * @brief Check if an installation has been submitted and its result is not retrieved yet
+ * @return true if an installation is pending, false otherwise
+ */
+bool example_llext_install_pending(void);
+
+/**
+ * @brief Retrieve the result of the installation of the LLEXT module, the installation is no longer pending once it is done
+ * @return 0 if the module is installed, -EINPROGRESS if the installation is not done yet, -ENOENT if no installation is pending, error code otherwise
+ */
+int example_llext_install_result(void);
+
+/**
+ * @brief Abort the installation of the LLEXT module
+ * @note The module data is released if the installation is not started yet, else the module is unloaded when the installation is done
+ */
+void example_llext_install_abort(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_LLEXT_H__ */
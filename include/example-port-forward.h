@@ -0,0 +1,66 @@
+/**
+ * @file      example-port-forward.h
+ * @brief     Port forwarding of the troubleshoot add-on, bridge between the websocket and local sockets
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_PORT_FORWARD_H__
+#define __EXAMPLE_PORT_FORWARD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-troubleshoot.h"
+
+/**
+ * @brief Initialize port forwarding
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_port_forward_init(void);
+
+/**
+ * @brief Port forwarding connect callback, open a connection to a local service, only the loopback addresses and the allowed hosts are reachable
+ * @param host Host of the service, "localhost" for example
+ * @param port Port of the service
+ * @param protocol Protocol
+ * @param handle Connection handle
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_port_forward_connect(char *host, uint16_t port, mender_troubleshoot_port_forwarding_protocol_t protocol, void **handle);
+
+/**
+ * @brief Port forwarding send callback, the data received from the websocket are sent to the service without intermediate copy
+ * @note The troubleshoot add-on has no function to be notified when the service closes the connection, the function fails once the socket is closed
+ * @param handle Connection handle
+ * @param data Data
+ * @param length Length of the data
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_port_forward_send(void *handle, void *data, size_t length);
+
+/**
+ * @brief Port forwarding close callback, close the connection to the service and release it
+ * @param handle Connection handle
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_port_forward_close(void *handle);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_PORT_FORWARD_H__ */
@@ -0,0 +1,47 @@
+/**
+ * @file      example-push.h
+ * @brief     Push channel used by the server to notify the device of new deployments
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_PUSH_H__
+#define __EXAMPLE_PUSH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-common.h"
+
+/**
+ * @brief Start the push channel, the connection to the push server is kept open in the background
+ * @param identity Identity of the device sent to the push server, the MAC address for example
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_push_init(char *identity);
+
+/**
+ * @brief Set the token of the device used to authenticate to the push server
+ * @note This function is called by the wrapper of mender_http_perform with the token of the requests of the mender-mcu-client
+ * @param token Token of the device
+ */
+void example_push_set_token(char *token);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_PUSH_H__ */
@@ -0,0 +1,55 @@
+/**
+ * @file      example-reboot.h
+ * @brief     Measurement of the reboot window when applying an update
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_REBOOT_H__
+#define __EXAMPLE_REBOOT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-common.h"
+
+/**
+ * @brief Start measurement of the reboot window
+ * @note This function is called when the device is about to reboot to apply an update
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_reboot_window_start(void);
+
+/**
+ * @brief Stop measurement of the reboot window
+ * @note This function is called once at startup, the pending measurement is cleared
+ * @param window Reboot window in seconds, the resolution is one second because the RTC counter runs at 1 Hz
+ * @param measured Set to true if a measurement was pending
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_reboot_window_stop(uint32_t *window, bool *measured);
+
+/**
+ * @brief Get the reboot window measured at startup
+ * @return Reboot window in seconds as reported in the inventory, "0" if no measurement was pending
+ */
+char *example_reboot_window_str(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_REBOOT_H__ */
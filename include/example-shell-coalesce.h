@@ -0,0 +1,69 @@
+/**
+ * @file      example-shell-coalesce.h
+ * @brief     Coalescing of the output of the troubleshoot shell
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_SHELL_COALESCE_H__
+#define __EXAMPLE_SHELL_COALESCE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-common.h"
+
+/**
+ * @brief Statistics of the output of the troubleshoot shell
+ */
+typedef struct {
+    uint32_t writes;       /**< Number of writes of the shell */
+    uint32_t write_bytes;  /**< Number of bytes written by the shell */
+    uint32_t flushes;      /**< Number of messages sent to the troubleshoot add-on */
+    uint32_t frames;       /**< Number of websocket frames sent, all the troubleshoot messages included */
+    uint32_t frame_bytes;  /**< Number of bytes of the websocket frames sent, headers included, not including the TLS records overhead */
+    uint32_t records;      /**< Number of TLS records sent, all the TLS connections included */
+    uint32_t record_bytes; /**< Number of bytes of the TLS records sent, headers, explicit IV and authentication tags included */
+    uint32_t errors;       /**< Number of messages that could not be sent */
+} example_shell_coalesce_stats_t;
+
+/**
+ * @brief Initialize the coalescing of the output of the troubleshoot shell
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_shell_coalesce_init(void);
+
+/**
+ * @brief Send the pending output of the troubleshoot shell immediately
+ */
+void example_shell_coalesce_flush(void);
+
+/**
+ * @brief Get statistics of the output of the troubleshoot shell
+ * @param stats Statistics
+ */
+void example_shell_coalesce_stats(example_shell_coalesce_stats_t *stats);
+
+/**
+ * @brief Reset statistics of the output of the troubleshoot shell
+ */
+void example_shell_coalesce_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_SHELL_COALESCE_H__ */
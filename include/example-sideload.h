@@ -0,0 +1,47 @@
+/**
+ * @file      example-sideload.h
+ * @brief     Installation of artifacts saved in the file system of the device
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_SIDELOAD_H__
+#define __EXAMPLE_SIDELOAD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-client.h"
+
+/**
+ * @brief Initialize the installation of artifacts from the file system
+ * @param callbacks Callbacks of the mender-mcu-client, the deployment status and restart callbacks are invoked as for network deployments
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_sideload_init(mender_client_callbacks_t *callbacks);
+
+/**
+ * @brief Start the installation of an artifact saved in the file system, the artifact is installed in the background
+ * @param path Path of the artifact, for example "/littlefs/update.mender"
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_sideload_start(char *path);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_SIDELOAD_H__ */
@@ -0,0 +1,98 @@
+/**
+ * @file      example-trace.h
+ * @brief     Timing instrumentation of the deployment lifecycle
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXAMPLE_TRACE_H__
+#define __EXAMPLE_TRACE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "mender-client.h"
+
+/**
+ * @brief Traced phases
+ */
+typedef enum {
+    EXAMPLE_TRACE_PHASE_DNS = 0,           /**< DNS resolution */
+    EXAMPLE_TRACE_PHASE_TCP_CONNECT,       /**< TCP connection */
+    EXAMPLE_TRACE_PHASE_TLS_HANDSHAKE,     /**< TLS handshake */
+    EXAMPLE_TRACE_PHASE_HTTP_HEADERS,      /**< HTTP request sent until the response headers are received */
+    EXAMPLE_TRACE_PHASE_HTTP_FIRST_BYTE,   /**< HTTP request sent until the first byte of the response body is received */
+    EXAMPLE_TRACE_PHASE_AUTHENTICATION,    /**< Authentication request */
+    EXAMPLE_TRACE_PHASE_DEPLOYMENT_CHECK,  /**< Check for deployment request */
+    EXAMPLE_TRACE_PHASE_ARTIFACT_DOWNLOAD, /**< Artifact download request */
+    EXAMPLE_TRACE_PHASE_STATUS_REPORT,     /**< Deployment status report request */
+    EXAMPLE_TRACE_PHASE_HTTP_REQUEST,      /**< Other HTTP requests */
+    EXAMPLE_TRACE_PHASE_FLASH_WRITE,       /**< Flash write of a sector */
+    EXAMPLE_TRACE_PHASE_FLASH_ERASE,       /**< Flash erase of a sector by the writer, when the pre-erase has not reached it */
+    EXAMPLE_TRACE_PHASE_FLASH_VERIFY,      /**< Flush of the last data and verification of the checksum of the image */
+    EXAMPLE_TRACE_PHASE_DOWNLOADING,       /**< Deployment status is downloading */
+    EXAMPLE_TRACE_PHASE_INSTALLING,        /**< Deployment status is installing */
+    EXAMPLE_TRACE_PHASE_LLEXT_QUEUE,       /**< LLEXT module installation submitted until it is started by the work queue */
+    EXAMPLE_TRACE_PHASE_LLEXT_LOAD,        /**< LLEXT module loaded */
+    EXAMPLE_TRACE_PHASE_LLEXT_INIT,        /**< LLEXT module initialization function */
+    EXAMPLE_TRACE_PHASE_LLEXT_WAIT,        /**< Submission to retrieval of the result of the LLEXT module installation */
+    EXAMPLE_TRACE_PHASE_COUNT              /**< Number of phases, must be the last one */
+} example_trace_phase_t;
+
+/**
+ * @brief Initialize timing instrumentation
+ * @note The 32-bit cycle counter is extended to 64 bits when the timer has no 64-bit cycle counter
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+mender_err_t example_trace_init(void);
+
+/**
+ * @brief Get current timestamp
+ * @return Timestamp in cycles
+ */
+uint64_t example_trace_timestamp(void);
+
+/**
+ * @brief Record duration of a phase
+ * @param phase Phase
+ * @param begin Timestamp of the beginning of the phase, the end of the phase is now
+ */
+void example_trace_record(example_trace_phase_t phase, uint64_t begin);
+
+/**
+ * @brief Record deployment status, the duration of the previous status is recorded if it is traced
+ * @param status Deployment status
+ */
+void example_trace_deployment_status(mender_deployment_status_t status);
+
+/**
+ * @brief Reset all the traces
+ */
+void example_trace_reset(void);
+
+/**
+ * @brief Get summary of the traces as inventory entries, only phases with at least one record are returned
+ * @param inventory Inventory entries, names and values remain valid until the next call
+ * @param size Maximum number of inventory entries
+ * @return Number of inventory entries
+ */
+size_t example_trace_inventory(mender_keystore_t *inventory, size_t size);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __EXAMPLE_TRACE_H__ */
@@ -0,0 +1,503 @@
+/**
+ * @file      example-auth-cache.c
+ * @brief     Cache of the authentication token, the token is reused after a warm reboot
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/bbram.h>
+#include <zephyr/drivers/counter.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/fs/nvs.h>
+#include <zephyr/random/random.h>
+#include <zephyr/storage/flash_map.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/gcm.h>
+#include <mbedtls/platform_util.h>
+
+#include "cJSON.h"
+#include "mender-http.h"
+#include "mender-tls.h"
+
+#include "example-auth-cache.h"
+#include "example-http.h"
+
+/**
+ * @brief Path of the authentication API
+ */
+#define EXAMPLE_AUTH_CACHE_PATH "/api/devices/v1/authentication/auth_requests"
+
+/**
+ * @brief Signature returned instead of signing the authentication payload when the cached token is used, it is never sent to the server
+ */
+#define EXAMPLE_AUTH_CACHE_SIGNATURE "cached"
+
+/**
+ * @brief Token record saved in the token partition
+ */
+#define EXAMPLE_AUTH_CACHE_NVS_ID     (1)
+#define EXAMPLE_AUTH_CACHE_MAGIC      (0x4a575443)
+#define EXAMPLE_AUTH_CACHE_NONCE_SIZE (12)
+#define EXAMPLE_AUTH_CACHE_TAG_SIZE   (16)
+typedef struct {
+    uint32_t magic;                                       /**< Magic value, the record is valid only if equal to EXAMPLE_AUTH_CACHE_MAGIC */
+    uint32_t session;                                     /**< Session identifier, it must match the one saved in the backup registers */
+    uint32_t issued;                                      /**< RTC counter value when the token has been issued */
+    uint32_t lifetime;                                    /**< Validity of the token in seconds, computed from the claims of the token */
+    uint32_t length;                                      /**< Length of the token */
+    uint8_t  nonce[EXAMPLE_AUTH_CACHE_NONCE_SIZE];        /**< Nonce used to encrypt the token */
+    uint8_t  tag[EXAMPLE_AUTH_CACHE_TAG_SIZE];            /**< Authentication tag of the header and of the token */
+    uint8_t  token[CONFIG_EXAMPLE_AUTH_CACHE_TOKEN_SIZE]; /**< Encrypted token */
+} example_auth_cache_record_t;
+
+/**
+ * @brief Session saved in the backup registers, after the reboot window record
+ * @note The backup registers are lost when the power is removed, so that the token is only reused after a warm reboot and the RTC counter can be trusted.
+ * The encryption key of the token is a random secret saved in the session, so the token partition alone does not permit to retrieve the token.
+ */
+#define EXAMPLE_AUTH_CACHE_SESSION_MAGIC  (0x4a575453)
+#define EXAMPLE_AUTH_CACHE_SESSION_OFFSET (8)
+#define EXAMPLE_AUTH_CACHE_KEY_SIZE       (16)
+typedef struct {
+    uint32_t magic;                            /**< Magic value, the session is valid only if equal to EXAMPLE_AUTH_CACHE_SESSION_MAGIC */
+    uint32_t session;                          /**< Session identifier */
+    uint8_t  key[EXAMPLE_AUTH_CACHE_KEY_SIZE]; /**< Encryption key of the token */
+} example_auth_cache_session_t;
+
+/**
+ * @brief RTC counter and backup registers devices
+ */
+static const struct device *auth_cache_counter = DEVICE_DT_GET(DT_NODELABEL(rtc));
+static const struct device *auth_cache_bbram   = DEVICE_DT_GET(DT_CHILD(DT_NODELABEL(rtc), backup_regs));
+
+/**
+ * @brief Token partition
+ */
+static struct nvs_fs auth_cache_fs;
+
+/**
+ * @brief Cached token and its lock
+ */
+static K_MUTEX_DEFINE(auth_cache_lock);
+static example_auth_cache_record_t auth_cache_record;
+static char                        auth_cache_token[CONFIG_EXAMPLE_AUTH_CACHE_TOKEN_SIZE + 1];
+static bool                        auth_cache_valid = false;
+
+/**
+ * @brief Token received from the server, saved when the authentication succeeds
+ */
+typedef struct {
+    mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *); /**< Original callback */
+    void  *params;                                                                 /**< Original callback parameters */
+    size_t length;                                                                 /**< Length of the token */
+    bool   overflow;                                                               /**< Token is too large to be saved */
+} example_auth_cache_http_ctx_t;
+static char auth_cache_received[CONFIG_EXAMPLE_AUTH_CACHE_TOKEN_SIZE];
+
+/**
+ * @brief Function wrapped at link time
+ */
+mender_err_t __real_mender_tls_sign_payload(char *payload, char **signature, size_t *signature_length);
+
+/**
+ * @brief Encrypt or decrypt the token of the record, the header of the record is authenticated
+ * @param record Record
+ * @param key Encryption key
+ * @param input Token to be encrypted, NULL to decrypt the token of the record
+ * @param output Decrypted token, NULL to encrypt
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+auth_cache_crypt(example_auth_cache_record_t *record, const uint8_t *key, const uint8_t *input, uint8_t *output) {
+
+    mbedtls_gcm_context ctx;
+    int                 result;
+
+    /* Encrypt or decrypt the token */
+    mbedtls_gcm_init(&ctx);
+    if (0 == (result = mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, EXAMPLE_AUTH_CACHE_KEY_SIZE * 8))) {
+        if (NULL != input) {
+            result = mbedtls_gcm_crypt_and_tag(&ctx,
+                                               MBEDTLS_GCM_ENCRYPT,
+                                               record->length,
+                                               record->nonce,
+                                               sizeof(record->nonce),
+                                               (const uint8_t *)record,
+                                               offsetof(example_auth_cache_record_t, nonce),
+                                               input,
+                                               record->token,
+                                               sizeof(record->tag),
+                                               record->tag);
+        } else {
+            result = mbedtls_gcm_auth_decrypt(&ctx,
+                                              record->length,
+                                              record->nonce,
+                                              sizeof(record->nonce),
+                                              (const uint8_t *)record,
+                                              offsetof(example_auth_cache_record_t, nonce),
+                                              record->tag,
+                                              sizeof(record->tag),
+                                              record->token,
+                                              output);
+        }
+    }
+    mbedtls_gcm_free(&ctx);
+
+    return result;
+}
+
+/**
+ * @brief Get current RTC counter value
+ * @param ticks RTC counter value
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+auth_cache_now(uint32_t *ticks) {
+
+    counter_start(auth_cache_counter);
+
+    return counter_get_value(auth_cache_counter, ticks);
+}
+
+/**
+ * @brief Compute the validity of the token from its claims, the clock of the device is not synchronized so only the difference between the claims is used
+ * @param token Token
+ * @param length Length of the token
+ * @param lifetime Validity of the token in seconds
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+auth_cache_lifetime(const char *token, size_t length, uint32_t *lifetime) {
+
+    static uint8_t encoded[CONFIG_EXAMPLE_AUTH_CACHE_TOKEN_SIZE + 4];
+    static uint8_t decoded[CONFIG_EXAMPLE_AUTH_CACHE_TOKEN_SIZE];
+    const char    *begin, *end;
+    size_t         size, decoded_length;
+    cJSON         *claims, *exp, *iat;
+    int            result = -EINVAL;
+
+    /* Retrieve the claims, second part of the token */
+    if ((NULL == (begin = memchr(token, '.', length))) || (NULL == (end = memchr(begin + 1, '.', length - (begin + 1 - token))))) {
+        return -EINVAL;
+    }
+    begin++;
+    size = end - begin;
+
+    /* Convert base64url to base64 with padding */
+    for (size_t index = 0; index < size; index++) {
+        encoded[index] = ('-' == begin[index]) ? '+' : ('_' == begin[index]) ? '/' : begin[index];
+    }
+    while (0 != size % 4) {
+        encoded[size++] = '=';
+    }
+    if (0 != mbedtls_base64_decode(decoded, sizeof(decoded), &decoded_length, encoded, size)) {
+        return -EINVAL;
+    }
+
+    /* Validity is the difference between the expiration and the issue times */
+    if (NULL == (claims = cJSON_ParseWithLength((const char *)decoded, decoded_length))) {
+        return -EINVAL;
+    }
+    exp = cJSON_GetObjectItemCaseSensitive(claims, "exp");
+    iat = cJSON_GetObjectItemCaseSensitive(claims, "iat");
+    if ((true == cJSON_IsNumber(exp)) && (true == cJSON_IsNumber(iat)) && (exp->valuedouble > iat->valuedouble)) {
+        *lifetime = (uint32_t)MIN(exp->valuedouble - iat->valuedouble, UINT32_MAX);
+        result    = 0;
+    }
+    cJSON_Delete(claims);
+
+    return result;
+}
+
+/**
+ * @brief Check if the cached token is still valid, the lock must be taken
+ * @return true if the cached token is valid, false otherwise
+ */
+static bool
+auth_cache_is_valid(void) {
+
+    uint32_t ticks, elapsed;
+
+    if ((true != auth_cache_valid) || (0 != auth_cache_now(&ticks)) || (ticks < auth_cache_record.issued)) {
+        return false;
+    }
+    elapsed = (uint32_t)(counter_ticks_to_us(auth_cache_counter, ticks - auth_cache_record.issued) / USEC_PER_SEC);
+
+    return (elapsed + CONFIG_EXAMPLE_AUTH_CACHE_MARGIN < auth_cache_record.lifetime);
+}
+
+/**
+ * @brief Clear the cached token, the lock must be taken
+ */
+static void
+auth_cache_clear(void) {
+
+    example_auth_cache_session_t session = { 0 };
+
+    auth_cache_valid = false;
+    memset(auth_cache_token, 0, sizeof(auth_cache_token));
+    memset(&auth_cache_record, 0, sizeof(auth_cache_record));
+    nvs_delete(&auth_cache_fs, EXAMPLE_AUTH_CACHE_NVS_ID);
+    bbram_write(auth_cache_bbram, EXAMPLE_AUTH_CACHE_SESSION_OFFSET, sizeof(session), (uint8_t *)&session);
+}
+
+/**
+ * @brief Save the token received from the server, the lock must be taken
+ * @param token Token
+ * @param length Length of the token
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+auth_cache_save(const char *token, size_t length) {
+
+    example_auth_cache_session_t session = { .magic = EXAMPLE_AUTH_CACHE_SESSION_MAGIC };
+    int                          result;
+
+    /* Prepare record header, the encryption key is renewed each time a token is saved */
+    auth_cache_clear();
+    auth_cache_record.magic  = EXAMPLE_AUTH_CACHE_MAGIC;
+    auth_cache_record.length = length;
+    if (0 != (result = auth_cache_lifetime(token, length, &auth_cache_record.lifetime))) {
+        LOG_WRN("Unable to retrieve the validity of the authentication token");
+        return result;
+    }
+    if ((0 != (result = auth_cache_now(&auth_cache_record.issued)))
+        || (0 != (result = sys_csrand_get(&auth_cache_record.session, sizeof(auth_cache_record.session))))
+        || (0 != (result = sys_csrand_get(auth_cache_record.nonce, sizeof(auth_cache_record.nonce))))
+        || (0 != (result = sys_csrand_get(session.key, sizeof(session.key))))) {
+        goto END;
+    }
+
+    /* Encrypt and save the token, the session and the key are saved in the backup registers */
+    if (0 != (result = auth_cache_crypt(&auth_cache_record, session.key, (const uint8_t *)token, NULL))) {
+        goto END;
+    }
+    if ((result = nvs_write(&auth_cache_fs, EXAMPLE_AUTH_CACHE_NVS_ID, &auth_cache_record, offsetof(example_auth_cache_record_t, token) + length)) < 0) {
+        goto END;
+    }
+    session.session = auth_cache_record.session;
+    if (0 != (result = bbram_write(auth_cache_bbram, EXAMPLE_AUTH_CACHE_SESSION_OFFSET, sizeof(session), (uint8_t *)&session))) {
+        goto END;
+    }
+    memcpy(auth_cache_token, token, length);
+    auth_cache_token[length] = '\0';
+    auth_cache_valid         = true;
+    result                   = 0;
+
+END:
+
+    /* Erase the key from the stack */
+    mbedtls_platform_zeroize(&session, sizeof(session));
+
+    return result;
+}
+
+/**
+ * @brief Load the token saved before the reboot, the lock must be taken
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+auth_cache_load(void) {
+
+    example_auth_cache_session_t session;
+    ssize_t                      length;
+    int                          result;
+
+    /* Read the token record and check the session, it must not be reused after a power loss */
+    if ((length = nvs_read(&auth_cache_fs, EXAMPLE_AUTH_CACHE_NVS_ID, &auth_cache_record, sizeof(auth_cache_record))) < 0) {
+        return (int)length;
+    }
+    if (0 != (result = bbram_read(auth_cache_bbram, EXAMPLE_AUTH_CACHE_SESSION_OFFSET, sizeof(session), (uint8_t *)&session))) {
+        return result;
+    }
+    if (((size_t)length < offsetof(example_auth_cache_record_t, token)) || (EXAMPLE_AUTH_CACHE_MAGIC != auth_cache_record.magic)
+        || (auth_cache_record.length != (size_t)length - offsetof(example_auth_cache_record_t, token))
+        || (EXAMPLE_AUTH_CACHE_SESSION_MAGIC != session.magic) || (auth_cache_record.session != session.session)) {
+        mbedtls_platform_zeroize(&session, sizeof(session));
+        return -EINVAL;
+    }
+
+    /* Decrypt the token */
+    result = auth_cache_crypt(&auth_cache_record, session.key, NULL, (uint8_t *)auth_cache_token);
+    mbedtls_platform_zeroize(&session, sizeof(session));
+    if (0 != result) {
+        return result;
+    }
+    auth_cache_token[auth_cache_record.length] = '\0';
+    auth_cache_valid                           = true;
+
+    /* Check the token has not expired */
+    return (true == auth_cache_is_valid()) ? 0 : -ETIME;
+}
+
+/**
+ * @brief HTTP callback used to retrieve the token received from the server
+ * @param event HTTP client event
+ * @param data Data received
+ * @param data_length Length of the data received
+ * @param params Context of the authentication request
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+auth_cache_http_cb(mender_http_client_event_t event, void *data, size_t data_length, void *params) {
+
+    example_auth_cache_http_ctx_t *ctx = (example_auth_cache_http_ctx_t *)params;
+
+    /* Save the token */
+    if ((MENDER_HTTP_EVENT_DATA_RECEIVED == event) && (NULL != data)) {
+        if (ctx->length + data_length <= sizeof(auth_cache_received)) {
+            memcpy(&auth_cache_received[ctx->length], data, data_length);
+            ctx->length += data_length;
+        } else {
+            ctx->overflow = true;
+        }
+    }
+
+    /* Invoke original callback */
+    return ctx->callback(event, data, data_length, ctx->params);
+}
+
+mender_err_t
+example_auth_cache_init(void) {
+
+    struct flash_pages_info info;
+    int                     result;
+
+    /* Check devices */
+    if ((!device_is_ready(auth_cache_counter)) || (!device_is_ready(auth_cache_bbram))) {
+        LOG_ERR("Unable to use the authentication token cache, RTC is not available");
+        return MENDER_FAIL;
+    }
+
+    /* Mount the token partition */
+    auth_cache_fs.flash_device = FIXED_PARTITION_DEVICE(token_partition);
+    auth_cache_fs.offset       = FIXED_PARTITION_OFFSET(token_partition);
+    if (0 != (result = flash_get_page_info_by_offs(auth_cache_fs.flash_device, auth_cache_fs.offset, &info))) {
+        LOG_ERR("Unable to get page info (%d)", result);
+        return MENDER_FAIL;
+    }
+    auth_cache_fs.sector_size  = info.size;
+    auth_cache_fs.sector_count = FIXED_PARTITION_SIZE(token_partition) / info.size;
+    if (0 != (result = nvs_mount(&auth_cache_fs))) {
+        LOG_ERR("Unable to mount the token partition (%d)", result);
+        return MENDER_FAIL;
+    }
+
+    /* Load the token saved before the reboot */
+    k_mutex_lock(&auth_cache_lock, K_FOREVER);
+    if (0 == (result = auth_cache_load())) {
+        LOG_INF("Authentication token loaded from cache");
+    } else if (-ENOENT != result) {
+        LOG_INF("Authentication token not reused (%d)", result);
+        auth_cache_clear();
+    }
+    k_mutex_unlock(&auth_cache_lock);
+
+    return MENDER_OK;
+}
+
+mender_err_t
+example_auth_cache_invalidate(void) {
+
+    k_mutex_lock(&auth_cache_lock, K_FOREVER);
+    auth_cache_clear();
+    k_mutex_unlock(&auth_cache_lock);
+
+    return MENDER_OK;
+}
+
+mender_err_t
+__wrap_mender_tls_sign_payload(char *payload, char **signature, size_t *signature_length) {
+
+    bool valid;
+
+    /* The payload is only signed to request authentication, signing is skipped if the cached token is used instead */
+    k_mutex_lock(&auth_cache_lock, K_FOREVER);
+    valid = auth_cache_is_valid();
+    k_mutex_unlock(&auth_cache_lock);
+    if (true == valid) {
+        if (NULL == (*signature = (char *)malloc(sizeof(EXAMPLE_AUTH_CACHE_SIGNATURE)))) {
+            return MENDER_FAIL;
+        }
+        memcpy(*signature, EXAMPLE_AUTH_CACHE_SIGNATURE, sizeof(EXAMPLE_AUTH_CACHE_SIGNATURE));
+        *signature_length = strlen(EXAMPLE_AUTH_CACHE_SIGNATURE);
+        return MENDER_OK;
+    }
+
+    return __real_mender_tls_sign_payload(payload, signature, signature_length);
+}
+
+mender_err_t
+example_auth_cache_http_perform(char                *jwt,
+                                char                *path,
+                                mender_http_method_t method,
+                                char                *payload,
+                                char                *signature,
+                                mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *),
+                                void *params,
+                                int  *status) {
+
+    example_auth_cache_http_ctx_t ctx = { .callback = callback, .params = params, .length = 0, .overflow = false };
+    mender_err_t                  ret;
+
+    /* Authentication request */
+    if ((NULL == jwt) && (NULL != path) && (NULL != strstr(path, EXAMPLE_AUTH_CACHE_PATH))) {
+
+        /* Return the cached token if it is still valid, the request is not sent */
+        k_mutex_lock(&auth_cache_lock, K_FOREVER);
+        if (true == auth_cache_is_valid()) {
+            if ((MENDER_OK == (ret = callback(MENDER_HTTP_EVENT_CONNECTED, NULL, 0, params)))
+                && (MENDER_OK == (ret = callback(MENDER_HTTP_EVENT_DATA_RECEIVED, auth_cache_token, strlen(auth_cache_token), params)))) {
+                ret = callback(MENDER_HTTP_EVENT_DISCONNECTED, NULL, 0, params);
+            }
+            k_mutex_unlock(&auth_cache_lock);
+            *status = 200;
+            LOG_INF("Authentication token reused from cache");
+            return ret;
+        }
+        k_mutex_unlock(&auth_cache_lock);
+
+        /* Perform the request and save the token received */
+        if ((MENDER_OK == (ret = __real_mender_http_perform(jwt, path, method, payload, signature, auth_cache_http_cb, &ctx, status))) && (200 == *status)
+            && (true != ctx.overflow)) {
+            k_mutex_lock(&auth_cache_lock, K_FOREVER);
+            if (0 != auth_cache_save(auth_cache_received, ctx.length)) {
+                LOG_WRN("Unable to save the authentication token in cache");
+                auth_cache_clear();
+            }
+            k_mutex_unlock(&auth_cache_lock);
+        }
+
+        return ret;
+    }
+
+    /* Other requests, the cached token is invalidated if it is rejected so that the next authentication is sent to the server */
+    if ((MENDER_OK == (ret = __real_mender_http_perform(jwt, path, method, payload, signature, callback, params, status))) && (401 == *status)) {
+        k_mutex_lock(&auth_cache_lock, K_FOREVER);
+        if ((true == auth_cache_valid) && (NULL != jwt) && (0 == strcmp(jwt, auth_cache_token))) {
+            LOG_WRN("Authentication token rejected, cache invalidated");
+            auth_cache_clear();
+        }
+        k_mutex_unlock(&auth_cache_lock);
+    }
+
+    return ret;
+}
@@ -0,0 +1,724 @@
+/**
+ * @file      example-crypto.c
+ * @brief     Crypto backend offloading AES and SHA-256 to the hardware when it is available
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <mbedtls/aes.h>
+#include <mbedtls/ccm.h>
+#include <mbedtls/gcm.h>
+#include <mbedtls/platform_util.h>
+
+#ifdef CONFIG_CRYPTO
+#include <zephyr/crypto/crypto.h>
+#endif /* CONFIG_CRYPTO */
+
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#else
+struct shell;
+#endif /* CONFIG_SHELL */
+
+#include "example-crypto.h"
+
+/**
+ * @brief Hardware backends are disabled, used to execute the known answer tests with the software implementation
+ */
+static atomic_t crypto_software_only = ATOMIC_INIT(0);
+
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_AES
+
+/**
+ * @brief Number of AES sessions kept open, TLS uses one key per direction
+ */
+#define EXAMPLE_CRYPTO_AES_SESSIONS (2)
+
+/**
+ * @brief Number of AES encryption keys recorded, TLS uses one context per direction and per connection
+ */
+#define EXAMPLE_CRYPTO_AES_KEYS (8)
+
+/**
+ * @brief Flags of the AES sessions
+ */
+#define EXAMPLE_CRYPTO_AES_FLAGS (CAP_RAW_KEY | CAP_SEPARATE_IO_BUFS | CAP_SYNC_OPS | CAP_NO_IV_PREFIX)
+
+/**
+ * @brief AES session
+ */
+typedef struct {
+    struct cipher_ctx ctx;     /**< Cipher context */
+    uint8_t           key[32]; /**< Key of the session */
+    size_t            key_len; /**< Length of the key, 0 if the session is not open */
+    uint32_t          used;    /**< Last use of the session */
+} example_crypto_aes_session_t;
+
+/**
+ * @brief Encryption key of an AES context, recorded when the key is set so that the private fields of the context are not accessed
+ */
+typedef struct {
+    const mbedtls_aes_context *ctx;     /**< AES context, NULL if the entry is free */
+    uint8_t                    key[32]; /**< Key of the context */
+    size_t                     key_len; /**< Length of the key */
+} example_crypto_aes_key_t;
+
+/**
+ * @brief AES statistics
+ */
+typedef struct {
+    uint32_t hits;      /**< Blocks encrypted with the session of the key already open */
+    uint32_t misses;    /**< Blocks for which a session has been open */
+    uint32_t fallbacks; /**< Blocks encrypted in software because the key size, the mode or the device is not supported */
+    uint32_t errors;    /**< Blocks encrypted in software because the hardware failed */
+} example_crypto_aes_stats_t;
+
+/**
+ * @brief AES device, keys, sessions, statistics and their lock
+ */
+static const struct device *const crypto_aes_dev = DEVICE_DT_GET(DT_NODELABEL(aes));
+static example_crypto_aes_key_t     crypto_aes_keys[EXAMPLE_CRYPTO_AES_KEYS];
+static example_crypto_aes_session_t crypto_aes_sessions[EXAMPLE_CRYPTO_AES_SESSIONS];
+static uint32_t                     crypto_aes_counter = 0;
+static example_crypto_aes_stats_t   crypto_aes_stats;
+static K_MUTEX_DEFINE(crypto_aes_mutex);
+
+/**
+ * @brief Functions wrapped at link time
+ */
+int  __real_mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits);
+int  __real_mbedtls_aes_setkey_dec(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits);
+int  __real_mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx, int mode, const unsigned char input[16], unsigned char output[16]);
+void __real_mbedtls_aes_free(mbedtls_aes_context *ctx);
+
+/**
+ * @brief Retrieve the encryption key of an AES context, the lock must be held
+ * @param ctx AES context
+ * @return Key of the context, NULL if the context has no encryption key recorded
+ */
+static example_crypto_aes_key_t *
+crypto_aes_key_get(const mbedtls_aes_context *ctx) {
+
+    for (size_t index = 0; index < EXAMPLE_CRYPTO_AES_KEYS; index++) {
+        if (ctx == crypto_aes_keys[index].ctx) {
+            return &crypto_aes_keys[index];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Close an AES session, the copy of the key is erased
+ * @param session Session
+ */
+static void
+crypto_aes_session_close(example_crypto_aes_session_t *session) {
+
+    if (0 != session->key_len) {
+        cipher_free_session(crypto_aes_dev, &session->ctx);
+    }
+    mbedtls_platform_zeroize(session->key, sizeof(session->key));
+    session->key_len = 0;
+    session->used    = 0;
+}
+
+/**
+ * @brief Forget the encryption key of an AES context, the lock must be held
+ * @note The session of the key is closed and the copies of the key are erased
+ * @param ctx AES context
+ */
+static void
+crypto_aes_key_forget(const mbedtls_aes_context *ctx) {
+
+    example_crypto_aes_key_t *entry = crypto_aes_key_get(ctx);
+
+    if (NULL != entry) {
+        for (size_t index = 0; index < EXAMPLE_CRYPTO_AES_SESSIONS; index++) {
+            if ((entry->key_len == crypto_aes_sessions[index].key_len) && (0 == memcmp(entry->key, crypto_aes_sessions[index].key, entry->key_len))) {
+                crypto_aes_session_close(&crypto_aes_sessions[index]);
+            }
+        }
+        mbedtls_platform_zeroize(entry, sizeof(example_crypto_aes_key_t));
+    }
+}
+
+/**
+ * @brief Retrieve the session of the key, the least recently used session is replaced if the key has no session
+ * @param key Key
+ * @param key_len Length of the key
+ * @return Session if the function succeeds, NULL otherwise
+ */
+static example_crypto_aes_session_t *
+crypto_aes_session_get(const uint8_t *key, size_t key_len) {
+
+    example_crypto_aes_session_t *session = &crypto_aes_sessions[0];
+    int                           result;
+
+    /* Search for the session of the key */
+    for (size_t index = 0; index < EXAMPLE_CRYPTO_AES_SESSIONS; index++) {
+        if ((key_len == crypto_aes_sessions[index].key_len) && (0 == memcmp(key, crypto_aes_sessions[index].key, key_len))) {
+            crypto_aes_sessions[index].used = ++crypto_aes_counter;
+            crypto_aes_stats.hits++;
+            return &crypto_aes_sessions[index];
+        }
+        if (crypto_aes_sessions[index].used < session->used) {
+            session = &crypto_aes_sessions[index];
+        }
+    }
+    crypto_aes_stats.misses++;
+
+    /* Replace the least recently used session */
+    crypto_aes_session_close(session);
+    memcpy(session->key, key, key_len);
+    memset(&session->ctx, 0, sizeof(struct cipher_ctx));
+    session->ctx.keylen         = key_len;
+    session->ctx.key.bit_stream = session->key;
+    session->ctx.flags          = EXAMPLE_CRYPTO_AES_FLAGS;
+    if (0 != (result = cipher_begin_session(crypto_aes_dev, &session->ctx, CRYPTO_CIPHER_ALGO_AES, CRYPTO_CIPHER_MODE_ECB, CRYPTO_CIPHER_OP_ENCRYPT))) {
+        LOG_ERR("cipher_begin_session failed (%d)", result);
+        mbedtls_platform_zeroize(session->key, sizeof(session->key));
+        return NULL;
+    }
+    session->key_len = key_len;
+    session->used    = ++crypto_aes_counter;
+
+    return session;
+}
+
+/**
+ * @brief Encrypt the block using the hardware
+ * @param ctx AES context
+ * @param mode MBEDTLS_AES_ENCRYPT or MBEDTLS_AES_DECRYPT
+ * @param input Input block
+ * @param output Output block
+ * @return true if the block has been encrypted, false if the software implementation must be used
+ */
+static bool
+crypto_aes_hw_encrypt(mbedtls_aes_context *ctx, int mode, const unsigned char input[16], unsigned char output[16]) {
+
+    example_crypto_aes_key_t     *entry;
+    example_crypto_aes_session_t *session;
+    bool                          done = false;
+
+    /* Only the encryption with the 128 and 256 bits keys recorded is supported by the hardware */
+    k_mutex_lock(&crypto_aes_mutex, K_FOREVER);
+    if ((0 != atomic_get(&crypto_software_only)) || (!device_is_ready(crypto_aes_dev)) || (MBEDTLS_AES_ENCRYPT != mode)
+        || (NULL == (entry = crypto_aes_key_get(ctx)))) {
+        crypto_aes_stats.fallbacks++;
+        k_mutex_unlock(&crypto_aes_mutex);
+        return false;
+    }
+
+    /* Encrypt the block */
+    if (NULL != (session = crypto_aes_session_get(entry->key, entry->key_len))) {
+        struct cipher_pkt pkt = { .in_buf = (uint8_t *)input, .in_len = 16, .out_buf = output, .out_buf_max = 16 };
+        if (0 == cipher_block_op(&session->ctx, &pkt)) {
+            done = true;
+        } else {
+            crypto_aes_session_close(session);
+        }
+    }
+    if (true != done) {
+        crypto_aes_stats.errors++;
+    }
+    k_mutex_unlock(&crypto_aes_mutex);
+
+    return done;
+}
+
+int
+__wrap_mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits) {
+
+    int ret = __real_mbedtls_aes_setkey_enc(ctx, key, keybits);
+
+    /* Record the key, the software implementation is used for the 192 bits keys and if all the entries are used */
+    k_mutex_lock(&crypto_aes_mutex, K_FOREVER);
+    crypto_aes_key_forget(ctx);
+    if ((0 == ret) && ((128 == keybits) || (256 == keybits))) {
+        example_crypto_aes_key_t *entry = crypto_aes_key_get(NULL);
+        if (NULL != entry) {
+            entry->ctx     = ctx;
+            entry->key_len = keybits / 8;
+            memcpy(entry->key, key, entry->key_len);
+        }
+    }
+    k_mutex_unlock(&crypto_aes_mutex);
+
+    return ret;
+}
+
+int
+__wrap_mbedtls_aes_setkey_dec(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits) {
+
+    /* The context is now used for decryption, the software implementation is used */
+    k_mutex_lock(&crypto_aes_mutex, K_FOREVER);
+    crypto_aes_key_forget(ctx);
+    k_mutex_unlock(&crypto_aes_mutex);
+
+    return __real_mbedtls_aes_setkey_dec(ctx, key, keybits);
+}
+
+int
+__wrap_mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx, int mode, const unsigned char input[16], unsigned char output[16]) {
+
+    /* GCM and CCM only use the encryption direction of the block cipher, the software implementation is used for everything else */
+    if (true == crypto_aes_hw_encrypt(ctx, mode, input, output)) {
+        return 0;
+    }
+
+    return __real_mbedtls_aes_crypt_ecb(ctx, mode, input, output);
+}
+
+void
+__wrap_mbedtls_aes_free(mbedtls_aes_context *ctx) {
+
+    /* Close the session of the key so that no copy of the key remains once the context is released */
+    if (NULL != ctx) {
+        k_mutex_lock(&crypto_aes_mutex, K_FOREVER);
+        crypto_aes_key_forget(ctx);
+        k_mutex_unlock(&crypto_aes_mutex);
+    }
+
+    __real_mbedtls_aes_free(ctx);
+}
+
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_AES */
+
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_HASH
+
+/**
+ * @brief Hash device
+ */
+static const struct device *const crypto_hash_dev = DEVICE_DT_GET(DT_CHOSEN(example_hash));
+
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_HASH */
+
+void
+example_crypto_backends(const char **aes, const char **sha256) {
+
+    assert(NULL != aes);
+    assert(NULL != sha256);
+
+    *aes    = "software";
+    *sha256 = "software";
+    if (0 != atomic_get(&crypto_software_only)) {
+        return;
+    }
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_AES
+    if (device_is_ready(crypto_aes_dev)) {
+        *aes = crypto_aes_dev->name;
+    }
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_AES */
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_HASH
+    if (device_is_ready(crypto_hash_dev)) {
+        *sha256 = crypto_hash_dev->name;
+    }
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_HASH */
+}
+
+mender_err_t
+example_crypto_sha256_start(example_crypto_sha256_t *ctx) {
+
+    assert(NULL != ctx);
+
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_HASH
+    /* Start hardware session, fallback to software if it is not available */
+    memset(&ctx->hash, 0, sizeof(struct hash_ctx));
+    ctx->hash.flags = CAP_SEPARATE_IO_BUFS | CAP_SYNC_OPS;
+    ctx->hw         = ((0 == atomic_get(&crypto_software_only)) && device_is_ready(crypto_hash_dev)
+               && (0 == hash_begin_session(crypto_hash_dev, &ctx->hash, CRYPTO_HASH_ALGO_SHA256)));
+    if (true == ctx->hw) {
+        return MENDER_OK;
+    }
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_HASH */
+
+    /* Start software computation */
+    mbedtls_sha256_init(&ctx->sw);
+    if (0 != mbedtls_sha256_starts(&ctx->sw, 0)) {
+        mbedtls_sha256_free(&ctx->sw);
+        return MENDER_FAIL;
+    }
+
+    return MENDER_OK;
+}
+
+mender_err_t
+example_crypto_sha256_update(example_crypto_sha256_t *ctx, const uint8_t *data, size_t length) {
+
+    assert(NULL != ctx);
+
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_HASH
+    if (true == ctx->hw) {
+        struct hash_pkt pkt = { .in_buf = (uint8_t *)data, .in_len = length, .out_buf = NULL };
+        return (0 == hash_update(&ctx->hash, &pkt)) ? MENDER_OK : MENDER_FAIL;
+    }
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_HASH */
+
+    return (0 == mbedtls_sha256_update(&ctx->sw, data, length)) ? MENDER_OK : MENDER_FAIL;
+}
+
+mender_err_t
+example_crypto_sha256_finish(example_crypto_sha256_t *ctx, uint8_t digest[EXAMPLE_CRYPTO_SHA256_SIZE]) {
+
+    assert(NULL != ctx);
+    assert(NULL != digest);
+
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_HASH
+    if (true == ctx->hw) {
+        struct hash_pkt pkt = { .in_buf = NULL, .in_len = 0, .out_buf = digest };
+        return (0 == hash_compute(&ctx->hash, &pkt)) ? MENDER_OK : MENDER_FAIL;
+    }
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_HASH */
+
+    return (0 == mbedtls_sha256_finish(&ctx->sw, digest)) ? MENDER_OK : MENDER_FAIL;
+}
+
+void
+example_crypto_sha256_free(example_crypto_sha256_t *ctx) {
+
+    assert(NULL != ctx);
+
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_HASH
+    if (true == ctx->hw) {
+        hash_free_session(crypto_hash_dev, &ctx->hash);
+        ctx->hw = false;
+        return;
+    }
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_HASH */
+
+    mbedtls_sha256_free(&ctx->sw);
+}
+
+/**
+ * @brief Known answer tests of the AES block encryption, FIPS-197 appendix C
+ */
+static const struct {
+    uint8_t key[32];
+    size_t  key_bits;
+    uint8_t plaintext[16];
+    uint8_t ciphertext[16];
+} crypto_kat_aes[] = {
+    { .key        = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+      .key_bits   = 128,
+      .plaintext  = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff },
+      .ciphertext = { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a } },
+    { .key        = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+                      0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17 },
+      .key_bits   = 192,
+      .plaintext  = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff },
+      .ciphertext = { 0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91 } },
+    { .key        = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+                      0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f },
+      .key_bits   = 256,
+      .plaintext  = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff },
+      .ciphertext = { 0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89 } },
+};
+
+/**
+ * @brief Known answer test of AES-128-GCM, test case 2 of the GCM specification
+ */
+static const uint8_t crypto_kat_gcm_ciphertext[16] = { 0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92, 0xf3, 0x28, 0xc2, 0xb9, 0x71, 0xb2, 0xfe, 0x78 };
+static const uint8_t crypto_kat_gcm_tag[16]        = { 0xab, 0x6e, 0x47, 0xd4, 0x2c, 0xec, 0x13, 0xbd, 0xf5, 0x3a, 0x67, 0xb2, 0x12, 0x57, 0xbd, 0xdf };
+
+/**
+ * @brief Known answer test of AES-128-CCM, example 1 of NIST SP 800-38C
+ */
+static const uint8_t crypto_kat_ccm_key[16]       = { 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f };
+static const uint8_t crypto_kat_ccm_nonce[7]      = { 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16 };
+static const uint8_t crypto_kat_ccm_ad[8]         = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+static const uint8_t crypto_kat_ccm_plaintext[4]  = { 0x20, 0x21, 0x22, 0x23 };
+static const uint8_t crypto_kat_ccm_ciphertext[8] = { 0x71, 0x62, 0x01, 0x5b, 0x4d, 0xac, 0x25, 0x5d };
+
+/**
+ * @brief Known answer test of SHA-256, "abc" message of FIPS 180-2 appendix B
+ */
+static const uint8_t crypto_kat_sha256_digest[EXAMPLE_CRYPTO_SHA256_SIZE]
+    = { 0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad };
+
+/**
+ * @brief Print result of a known answer test
+ * @param sh Shell instance, NULL to log the failures only
+ * @param name Name of the test
+ * @param passed Result of the test
+ * @return 0 if the test passed, -EIO otherwise
+ */
+static int
+crypto_kat_result(const struct shell *sh, const char *name, bool passed) {
+
+#ifdef CONFIG_SHELL
+    if (NULL != sh) {
+        shell_print(sh, "%-16s %s", name, (true == passed) ? "passed" : "FAILED");
+    }
+#endif /* CONFIG_SHELL */
+    if ((NULL == sh) && (true != passed)) {
+        LOG_ERR("Known answer test '%s' failed", name);
+    }
+
+    return (true == passed) ? 0 : -EIO;
+}
+
+/**
+ * @brief Execute the known answer tests using the current backends
+ * @param sh Shell instance, NULL to log the failures only
+ * @return 0 if the tests passed, -EIO otherwise
+ */
+static int
+crypto_kat_run(const struct shell *sh) {
+
+    uint8_t                 output[32];
+    uint8_t                 tag[16];
+    uint8_t                 zero[16] = { 0 };
+    mbedtls_aes_context     aes;
+    mbedtls_gcm_context     gcm;
+    mbedtls_ccm_context     ccm;
+    example_crypto_sha256_t sha256;
+    const char             *aes_backend, *sha256_backend;
+    char                    name[16];
+    int                     ret = 0;
+    bool                    passed;
+
+    example_crypto_backends(&aes_backend, &sha256_backend);
+#ifdef CONFIG_SHELL
+    if (NULL != sh) {
+        shell_print(sh, "AES backend: %s, SHA-256 backend: %s", aes_backend, sha256_backend);
+    }
+#endif /* CONFIG_SHELL */
+
+    /* AES block encryption, 192 bits keys use the software implementation */
+    for (size_t index = 0; index < ARRAY_SIZE(crypto_kat_aes); index++) {
+        mbedtls_aes_init(&aes);
+        passed = (0 == mbedtls_aes_setkey_enc(&aes, crypto_kat_aes[index].key, crypto_kat_aes[index].key_bits))
+                 && (0 == mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_ENCRYPT, crypto_kat_aes[index].plaintext, output))
+                 && (0 == memcmp(output, crypto_kat_aes[index].ciphertext, 16));
+        mbedtls_aes_free(&aes);
+        snprintf(name, sizeof(name), "aes-%u-ecb", (unsigned int)crypto_kat_aes[index].key_bits);
+        ret |= crypto_kat_result(sh, name, passed);
+    }
+
+    /* AES-128-GCM */
+    mbedtls_gcm_init(&gcm);
+    passed = (0 == mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, zero, 128))
+             && (0 == mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, 16, zero, 12, NULL, 0, zero, output, sizeof(tag), tag))
+             && (0 == memcmp(output, crypto_kat_gcm_ciphertext, 16)) && (0 == memcmp(tag, crypto_kat_gcm_tag, sizeof(tag)))
+             && (0 == mbedtls_gcm_auth_decrypt(&gcm, 16, zero, 12, NULL, 0, crypto_kat_gcm_tag, sizeof(tag), crypto_kat_gcm_ciphertext, output))
+             && (0 == memcmp(output, zero, 16));
+    mbedtls_gcm_free(&gcm);
+    ret |= crypto_kat_result(sh, "aes-128-gcm", passed);
+
+    /* AES-128-CCM */
+    mbedtls_ccm_init(&ccm);
+    passed = (0 == mbedtls_ccm_setkey(&ccm, MBEDTLS_CIPHER_ID_AES, crypto_kat_ccm_key, 128))
+             && (0
+                 == mbedtls_ccm_encrypt_and_tag(&ccm,
+                                                sizeof(crypto_kat_ccm_plaintext),
+                                                crypto_kat_ccm_nonce,
+                                                sizeof(crypto_kat_ccm_nonce),
+                                                crypto_kat_ccm_ad,
+                                                sizeof(crypto_kat_ccm_ad),
+                                                crypto_kat_ccm_plaintext,
+                                                output,
+                                                tag,
+                                                4))
+             && (0 == memcmp(output, crypto_kat_ccm_ciphertext, 4)) && (0 == memcmp(tag, &crypto_kat_ccm_ciphertext[4], 4));
+    mbedtls_ccm_free(&ccm);
+    ret |= crypto_kat_result(sh, "aes-128-ccm", passed);
+
+    /* SHA-256 */
+    passed = (MENDER_OK == example_crypto_sha256_start(&sha256));
+    if (true == passed) {
+        passed = (MENDER_OK == example_crypto_sha256_update(&sha256, (const uint8_t *)"abc", 3)) && (MENDER_OK == example_crypto_sha256_finish(&sha256, output))
+                 && (0 == memcmp(output, crypto_kat_sha256_digest, EXAMPLE_CRYPTO_SHA256_SIZE));
+        example_crypto_sha256_free(&sha256);
+    }
+    ret |= crypto_kat_result(sh, "sha-256", passed);
+
+    return (0 == ret) ? 0 : -EIO;
+}
+
+mender_err_t
+example_crypto_init(void) {
+
+#if defined(CONFIG_EXAMPLE_CRYPTO_HW_AES) || defined(CONFIG_EXAMPLE_CRYPTO_HW_HASH)
+    /* Execute the known answer tests using the hardware backends, the software implementation is used if they fail */
+    if (0 != crypto_kat_run(NULL)) {
+        LOG_WRN("Known answer tests of the hardware backends failed, using the software implementation");
+        atomic_set(&crypto_software_only, 1);
+    }
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_AES || CONFIG_EXAMPLE_CRYPTO_HW_HASH */
+
+    return MENDER_OK;
+}
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief Size of the buffer and number of iterations of the benchmark
+ */
+#define EXAMPLE_CRYPTO_BENCH_BUFFER_SIZE (1024)
+#define EXAMPLE_CRYPTO_BENCH_ITERATIONS  (64)
+
+/**
+ * @brief Execute the known answer tests using the hardware backends, and then using the software implementation
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_crypto_kat(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)argc;
+    (void)argv;
+    int ret;
+
+    /* Current backends */
+    ret = crypto_kat_run(sh);
+
+#if defined(CONFIG_EXAMPLE_CRYPTO_HW_AES) || defined(CONFIG_EXAMPLE_CRYPTO_HW_HASH)
+    /* Software implementation, the other users of the crypto backends also use it during the tests */
+    atomic_val_t software_only = atomic_set(&crypto_software_only, 1);
+    ret |= crypto_kat_run(sh);
+    atomic_set(&crypto_software_only, software_only);
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_AES || CONFIG_EXAMPLE_CRYPTO_HW_HASH */
+
+    return (0 == ret) ? 0 : -EIO;
+}
+
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_AES
+
+/**
+ * @brief Display the statistics of the AES sessions
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_crypto_stats(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)argc;
+    (void)argv;
+    example_crypto_aes_stats_t stats;
+
+    k_mutex_lock(&crypto_aes_mutex, K_FOREVER);
+    memcpy(&stats, &crypto_aes_stats, sizeof(example_crypto_aes_stats_t));
+    k_mutex_unlock(&crypto_aes_mutex);
+    shell_print(sh, "AES session hits: %u, misses: %u, software fallbacks: %u, hardware errors: %u", stats.hits, stats.misses, stats.fallbacks, stats.errors);
+
+    return 0;
+}
+
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_AES */
+
+/**
+ * @brief Print result of a benchmark
+ * @param sh Shell instance
+ * @param name Name of the benchmark
+ * @param cycles Number of cycles
+ * @param length Number of bytes processed
+ */
+static void
+crypto_bench_result(const struct shell *sh, const char *name, uint64_t cycles, size_t length) {
+
+    uint64_t us = k_cyc_to_us_floor64(cycles);
+
+    shell_print(sh,
+                "%-16s %u.%u cycles/byte, %u KB/s",
+                name,
+                (uint32_t)(cycles / length),
+                (uint32_t)((cycles * 10 / length) % 10),
+                (0 == us) ? 0 : (uint32_t)((uint64_t)length * 1000000 / 1024 / us));
+}
+
+/**
+ * @brief Measure cycles per byte of the record decryption and of the hashing using the current backends
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_crypto_bench(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)argc;
+    (void)argv;
+    static uint8_t          buffer[EXAMPLE_CRYPTO_BENCH_BUFFER_SIZE];
+    static uint8_t          output[EXAMPLE_CRYPTO_BENCH_BUFFER_SIZE];
+    uint8_t                 key[16] = { 0 };
+    uint8_t                 iv[12]  = { 0 };
+    uint8_t                 tag[16];
+    mbedtls_gcm_context     gcm;
+    example_crypto_sha256_t sha256;
+    const char             *aes_backend, *sha256_backend;
+    uint32_t                begin;
+    uint64_t                cycles;
+    size_t                  length = EXAMPLE_CRYPTO_BENCH_BUFFER_SIZE * EXAMPLE_CRYPTO_BENCH_ITERATIONS;
+
+    example_crypto_backends(&aes_backend, &sha256_backend);
+    shell_print(sh, "AES backend: %s, SHA-256 backend: %s", aes_backend, sha256_backend);
+
+    /* AES-128-GCM record decryption, the tag is not checked */
+    mbedtls_gcm_init(&gcm);
+    if (0 != mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, 128)) {
+        shell_error(sh, "Unable to set GCM key");
+        mbedtls_gcm_free(&gcm);
+        return -EIO;
+    }
+    cycles = 0;
+    for (size_t index = 0; index < EXAMPLE_CRYPTO_BENCH_ITERATIONS; index++) {
+        begin = k_cycle_get_32();
+        mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_DECRYPT, sizeof(buffer), iv, sizeof(iv), NULL, 0, buffer, output, sizeof(tag), tag);
+        cycles += k_cycle_get_32() - begin;
+    }
+    mbedtls_gcm_free(&gcm);
+    crypto_bench_result(sh, "aes-128-gcm", cycles, length);
+
+    /* SHA-256 */
+    if (MENDER_OK != example_crypto_sha256_start(&sha256)) {
+        shell_error(sh, "Unable to start SHA-256");
+        return -EIO;
+    }
+    cycles = 0;
+    for (size_t index = 0; index < EXAMPLE_CRYPTO_BENCH_ITERATIONS; index++) {
+        begin = k_cycle_get_32();
+        example_crypto_sha256_update(&sha256, buffer, sizeof(buffer));
+        cycles += k_cycle_get_32() - begin;
+    }
+    example_crypto_sha256_finish(&sha256, output);
+    example_crypto_sha256_free(&sha256);
+    crypto_bench_result(sh, "sha-256", cycles, length);
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(crypto_cmds,
+                               SHELL_CMD(kat, NULL, "Execute the known answer tests of the hardware and software backends", cmd_crypto_kat),
+                               SHELL_CMD(bench, NULL, "Measure cycles per byte of the record decryption and of the hashing", cmd_crypto_bench),
+#ifdef CONFIG_EXAMPLE_CRYPTO_HW_AES
+                               SHELL_CMD(stats, NULL, "Display the statistics of the AES sessions", cmd_crypto_stats),
+#endif /* CONFIG_EXAMPLE_CRYPTO_HW_AES */
+                               SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(crypto, &crypto_cmds, "Crypto backend commands", NULL);
+
+#endif /* CONFIG_SHELL */
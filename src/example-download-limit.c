@@ -0,0 +1,321 @@
+/**
+ * @file      example-download-limit.c
+ * @brief     Bandwidth and CPU limits of the download of the artifacts
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif /* CONFIG_SHELL */
+
+#include "example-download-limit.h"
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief Maximum number of samples of the latency probe
+ */
+#define EXAMPLE_DOWNLOAD_LIMIT_PROBE_MAX_SAMPLES (2000)
+
+/**
+ * @brief Latency probe, periodic thread simulating the telemetry of the application
+ */
+static K_THREAD_STACK_DEFINE(download_limit_probe_stack, CONFIG_EXAMPLE_DOWNLOAD_LIMIT_PROBE_STACK_SIZE);
+static struct k_thread download_limit_probe_thread;
+
+#endif /* CONFIG_SHELL */
+
+/**
+ * @brief Download limits and their lock
+ */
+static K_MUTEX_DEFINE(download_limit_lock);
+static uint32_t download_limit_rate     = CONFIG_EXAMPLE_DOWNLOAD_LIMIT_RATE;       /**< Maximum rate in KB/s, 0 for no limit */
+static int      download_limit_priority = CONFIG_EXAMPLE_DOWNLOAD_LIMIT_PRIORITY;   /**< Priority of the download, -1 to keep the priority */
+static uint32_t download_limit_cpu      = CONFIG_EXAMPLE_DOWNLOAD_LIMIT_CPU_BUDGET; /**< CPU budget of the download in percent, 100 for no limit */
+
+/**
+ * @brief Download context, only accessed by the mender client thread
+ */
+typedef struct {
+    bool     active;   /**< Download in progress */
+    int      priority; /**< Priority of the mender client thread before the download */
+    int64_t  tokens;   /**< Tokens of the bucket in bytes, negative when the rate is exceeded */
+    int64_t  refill;   /**< Uptime of the last refill of the bucket */
+    uint64_t cycles;   /**< Execution cycles of the mender client thread at the previous chunk */
+    uint64_t debt;     /**< Idle time owed to respect the CPU budget, in cycles */
+    uint64_t throttle; /**< Time spent sleeping to respect the limits, in milliseconds */
+} example_download_limit_ctx_t;
+
+/**
+ * @brief Download context
+ */
+static example_download_limit_ctx_t download_limit_ctx;
+
+/**
+ * @brief Get value of a configuration key
+ * @param configuration Device configuration
+ * @param name Name of the key
+ * @param value Value of the key, unchanged if the key is not found or if the value is not valid
+ * @param min Minimum value
+ * @param max Maximum value
+ */
+static void
+download_limit_get_key(mender_keystore_t *configuration, const char *name, int *value, int min, int max) {
+
+    char *end;
+    long  result;
+
+    for (size_t index = 0; (NULL != configuration[index].name) && (NULL != configuration[index].value); index++) {
+        if (0 == strcmp(configuration[index].name, name)) {
+            result = strtol(configuration[index].value, &end, 10);
+            if (('\0' == *end) && (end != configuration[index].value) && (result >= min) && (result <= max)) {
+                *value = (int)result;
+            } else {
+                LOG_ERR("Invalid value '%s' for '%s'", configuration[index].value, name);
+            }
+        }
+    }
+}
+
+mender_err_t
+example_download_limit_configure(mender_keystore_t *configuration) {
+
+    int rate, priority, cpu;
+
+    if (NULL == configuration) {
+        return MENDER_OK;
+    }
+
+    /* Read limits, the new values are applied at the next chunk, and at the next download for the priority */
+    k_mutex_lock(&download_limit_lock, K_FOREVER);
+    rate     = (int)download_limit_rate;
+    priority = download_limit_priority;
+    cpu      = (int)download_limit_cpu;
+    download_limit_get_key(configuration, "download-rate-kbps", &rate, 0, INT_MAX / 1024);
+    download_limit_get_key(configuration, "download-priority", &priority, -1, K_LOWEST_APPLICATION_THREAD_PRIO);
+    download_limit_get_key(configuration, "download-cpu-percent", &cpu, 1, 100);
+    download_limit_rate     = (uint32_t)rate;
+    download_limit_priority = priority;
+    download_limit_cpu      = (uint32_t)cpu;
+    k_mutex_unlock(&download_limit_lock);
+    LOG_INF("Download limited to %u KB/s, priority %d, CPU budget %u%%", (uint32_t)rate, priority, (uint32_t)cpu);
+
+    return MENDER_OK;
+}
+
+/**
+ * @brief Get execution cycles of the current thread
+ * @return Execution cycles, 0 if the thread runtime statistics are not available
+ */
+static uint64_t
+download_limit_cycles(void) {
+
+    k_thread_runtime_stats_t stats;
+
+    if (0 != k_thread_runtime_stats_get(k_current_get(), &stats)) {
+        return 0;
+    }
+
+    return stats.execution_cycles;
+}
+
+void
+example_download_limit_begin(void) {
+
+    int priority;
+
+    k_mutex_lock(&download_limit_lock, K_FOREVER);
+    priority = download_limit_priority;
+    k_mutex_unlock(&download_limit_lock);
+
+    /* Change priority of the thread processing the download, it is restored at the end of the download */
+    if (true != download_limit_ctx.active) {
+        download_limit_ctx.priority = k_thread_priority_get(k_current_get());
+        if (priority >= 0) {
+            k_thread_priority_set(k_current_get(), priority);
+        }
+    }
+
+    /* Reset limits */
+    download_limit_ctx.active   = true;
+    download_limit_ctx.tokens   = CONFIG_EXAMPLE_DOWNLOAD_LIMIT_BURST;
+    download_limit_ctx.refill   = k_uptime_get();
+    download_limit_ctx.cycles   = download_limit_cycles();
+    download_limit_ctx.debt     = 0;
+    download_limit_ctx.throttle = 0;
+}
+
+void
+example_download_limit_chunk(size_t length) {
+
+    uint32_t rate, cpu;
+    int64_t  now = k_uptime_get();
+    uint64_t cycles;
+    uint32_t delay = 0;
+
+    if (true != download_limit_ctx.active) {
+        return;
+    }
+
+    k_mutex_lock(&download_limit_lock, K_FOREVER);
+    rate = download_limit_rate;
+    cpu  = download_limit_cpu;
+    k_mutex_unlock(&download_limit_lock);
+
+    /* Token bucket, refilled at the rate up to the burst size, the thread sleeps until the debt is paid when the rate is exceeded */
+    if (0 != rate) {
+        download_limit_ctx.tokens
+            = MIN(download_limit_ctx.tokens + (now - download_limit_ctx.refill) * rate * 1024 / MSEC_PER_SEC, CONFIG_EXAMPLE_DOWNLOAD_LIMIT_BURST);
+        download_limit_ctx.tokens -= length;
+        if (download_limit_ctx.tokens < 0) {
+            delay = (uint32_t)DIV_ROUND_UP(-download_limit_ctx.tokens * MSEC_PER_SEC, rate * 1024);
+        }
+    }
+    download_limit_ctx.refill = now;
+
+    /* CPU budget, the thread sleeps so that its execution time since the previous chunk is the budget of the elapsed time */
+    if ((cpu < 100) && (0 != (cycles = download_limit_cycles()))) {
+        download_limit_ctx.debt += (cycles - download_limit_ctx.cycles) * (100 - cpu) / cpu;
+        download_limit_ctx.cycles = cycles;
+        delay                     = MAX(delay, (uint32_t)k_cyc_to_ms_floor64(download_limit_ctx.debt));
+    }
+
+    /* Sleep, the TCP receive window closes and the server slows down */
+    if (0 != delay) {
+        k_msleep(delay);
+        download_limit_ctx.throttle += delay;
+        download_limit_ctx.debt   = 0;
+        download_limit_ctx.cycles = download_limit_cycles();
+    }
+}
+
+void
+example_download_limit_end(void) {
+
+    if (true != download_limit_ctx.active) {
+        return;
+    }
+
+    /* Restore priority */
+    k_thread_priority_set(k_current_get(), download_limit_ctx.priority);
+    download_limit_ctx.active = false;
+    if (0 != download_limit_ctx.throttle) {
+        LOG_INF("Download throttled for %u ms", (uint32_t)download_limit_ctx.throttle);
+    }
+}
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief Latency probe thread, wake up periodically and record the latency between the deadline and the wake up
+ * @param p1 Samples
+ * @param p2 Number of samples
+ * @param p3 Period in milliseconds
+ */
+static void
+download_limit_probe(void *p1, void *p2, void *p3) {
+
+    uint32_t *samples  = (uint32_t *)p1;
+    size_t    count    = (size_t)(uintptr_t)p2;
+    int64_t   period   = (int64_t)k_ms_to_ticks_ceil64((uint32_t)(uintptr_t)p3);
+    int64_t   deadline = k_uptime_ticks();
+
+    for (size_t index = 0; index < count; index++) {
+        deadline += period;
+        k_sleep(K_TIMEOUT_ABS_TICKS(deadline));
+        samples[index] = k_ticks_to_us_floor32((uint32_t)(k_uptime_ticks() - deadline));
+    }
+}
+
+/**
+ * @brief Compare two samples
+ * @param a First sample
+ * @param b Second sample
+ * @return Negative, zero or positive value if the first sample is lower, equal or greater than the second one
+ */
+static int
+download_limit_compare(const void *a, const void *b) {
+
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Measure the latency percentiles of a periodic thread, run it while a download is in progress to check the limits
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_download_limit_probe(const struct shell *sh, size_t argc, char **argv) {
+
+    uint32_t  period   = (argc > 1) ? strtoul(argv[1], NULL, 10) : 10;
+    size_t    count    = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1000;
+    int       priority = (argc > 3) ? (int)strtol(argv[3], NULL, 10) : CONFIG_EXAMPLE_DOWNLOAD_LIMIT_PROBE_PRIORITY;
+    uint32_t *samples;
+
+    if ((0 == period) || (0 == count) || (count > EXAMPLE_DOWNLOAD_LIMIT_PROBE_MAX_SAMPLES) || (priority < 0)
+        || (priority > K_LOWEST_APPLICATION_THREAD_PRIO)) {
+        shell_error(sh, "Invalid arguments");
+        return -EINVAL;
+    }
+    if (NULL == (samples = malloc(count * sizeof(uint32_t)))) {
+        shell_error(sh, "Unable to allocate memory");
+        return -ENOMEM;
+    }
+
+    /* Run probe and wait for the samples */
+    shell_print(sh, "Probing %u samples every %u ms at priority %d", (uint32_t)count, period, priority);
+    k_thread_create(&download_limit_probe_thread,
+                    download_limit_probe_stack,
+                    K_THREAD_STACK_SIZEOF(download_limit_probe_stack),
+                    download_limit_probe,
+                    samples,
+                    (void *)(uintptr_t)count,
+                    (void *)(uintptr_t)period,
+                    priority,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&download_limit_probe_thread, "download_probe");
+    k_thread_join(&download_limit_probe_thread, K_FOREVER);
+
+    /* Compute percentiles */
+    qsort(samples, count, sizeof(uint32_t), download_limit_compare);
+    shell_print(sh, "%10s %10s %10s %10s", "p50 (us)", "p90 (us)", "p99 (us)", "max (us)");
+    shell_print(sh, "%10u %10u %10u %10u", samples[count * 50 / 100], samples[count * 90 / 100], samples[count * 99 / 100], samples[count - 1]);
+    free(samples);
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(download_limit_cmds,
+                               SHELL_CMD_ARG(probe, NULL, "Measure latency percentiles [period_ms] [samples] [priority]", cmd_download_limit_probe, 1, 3),
+                               SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(download_limit, &download_limit_cmds, "Download limits commands", NULL);
+
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,708 @@
+/**
+ * @file      example-download-streams.c
+ * @brief     Download of the artifacts using parallel range requests
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/client.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/tls_credentials.h>
+#include <zephyr/sys/util.h>
+
+#include "example-download-streams.h"
+
+/**
+ * @brief Timeout of the range requests
+ */
+#define EXAMPLE_DOWNLOAD_STREAMS_TIMEOUT (30000)
+
+/**
+ * @brief Size of the reception buffer of the HTTP client of each stream
+ */
+#define EXAMPLE_DOWNLOAD_STREAMS_RECV_BUFFER_SIZE (512)
+
+/**
+ * @brief Maximum length of the host name and of the port of the URL of the artifact
+ */
+#define EXAMPLE_DOWNLOAD_STREAMS_HOST_SIZE (128)
+#define EXAMPLE_DOWNLOAD_STREAMS_PORT_SIZE (6)
+
+/**
+ * @brief Maximum length of the name of the headers parsed and of the value of the Content-Range header
+ */
+#define EXAMPLE_DOWNLOAD_STREAMS_HEADER_FIELD_SIZE   (16)
+#define EXAMPLE_DOWNLOAD_STREAMS_CONTENT_RANGE_SIZE (48)
+
+BUILD_ASSERT(CONFIG_EXAMPLE_DOWNLOAD_STREAMS_REORDER_SLOTS >= CONFIG_EXAMPLE_DOWNLOAD_STREAMS_COUNT, "Each stream must have a slot of the reorder buffer");
+
+/**
+ * @brief Slot of the reorder buffer, a range of the artifact
+ */
+typedef struct {
+    int32_t index;                                            /**< Index of the range, -1 if the slot is free */
+    size_t  length;                                           /**< Length of the data received */
+    bool    ready;                                            /**< Range received, data can be given to the callback */
+    uint8_t data[CONFIG_EXAMPLE_DOWNLOAD_STREAMS_RANGE_SIZE]; /**< Data of the range */
+} example_download_streams_slot_t;
+
+/**
+ * @brief Stream, connection used to request ranges of the artifact one after the other
+ */
+typedef struct {
+    int                              sock;                                                           /**< Socket, -1 if not connected */
+    example_download_streams_slot_t *slot;                                                           /**< Slot being received */
+    uint16_t                         http_status;                                                    /**< Status code of the response */
+    bool                             overflow;                                                       /**< More data than the size of a range received */
+    char                             header_field[EXAMPLE_DOWNLOAD_STREAMS_HEADER_FIELD_SIZE];       /**< Name of the header being received */
+    size_t                           header_field_len;                                               /**< Length of the name of the header being received */
+    bool                             header_value;                                                   /**< Value of the header being received */
+    char                             content_range[EXAMPLE_DOWNLOAD_STREAMS_CONTENT_RANGE_SIZE + 1]; /**< Value of the Content-Range header */
+    size_t                           content_range_len;                                              /**< Length of the value of the Content-Range header */
+    uint8_t                          recv_buffer[EXAMPLE_DOWNLOAD_STREAMS_RECV_BUFFER_SIZE];         /**< Reception buffer of the HTTP client */
+} example_download_streams_stream_t;
+
+/**
+ * @brief Download context
+ */
+typedef struct {
+    char        host[EXAMPLE_DOWNLOAD_STREAMS_HOST_SIZE]; /**< Host of the URL of the artifact */
+    char        port[EXAMPLE_DOWNLOAD_STREAMS_PORT_SIZE]; /**< Port of the URL of the artifact */
+    bool        explicit_port;                            /**< Port is given in the URL of the artifact */
+    bool        secure;                                   /**< HTTPS is used */
+    const char *path;                                     /**< Path and query of the URL of the artifact */
+    int32_t     next_fetch;                               /**< Index of the next range to be requested */
+    int32_t     next_deliver;                             /**< Index of the next range to be given to the callback */
+    int32_t     end;                                      /**< Index of the first range after the end of the artifact, INT32_MAX until it is known */
+    bool        single;                                   /**< Range requests not supported by the server, the download continues with a single stream */
+    bool        error;                                    /**< Download failed or aborted */
+} example_download_streams_ctx_t;
+
+/**
+ * @brief Download context of the single stream, used when the server does not support range requests
+ */
+typedef struct {
+    mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *); /**< Callback of the mender-mcu-client */
+    void        *params;                                                          /**< Parameters of the callback */
+    int          sock;                                                            /**< Socket, -1 once it is closed by the response callback */
+    uint16_t     http_status;                                                     /**< Status code of the response */
+    size_t       skip;                                                            /**< Number of bytes already given to the callback, skipped */
+    size_t       total;                                                           /**< Number of bytes given to the callback */
+    mender_err_t ret;                                                             /**< Result of the callback */
+} example_download_streams_single_t;
+
+/**
+ * @brief Download context, reorder buffer and streams, protected by the lock
+ * @note A range is only requested when its slot is free, so the reorder buffer bounds the number of ranges received in advance
+ */
+static K_MUTEX_DEFINE(download_streams_lock);
+static K_CONDVAR_DEFINE(download_streams_cond);
+static example_download_streams_ctx_t    download_streams_ctx;
+static example_download_streams_slot_t   download_streams_slots[CONFIG_EXAMPLE_DOWNLOAD_STREAMS_REORDER_SLOTS];
+static example_download_streams_stream_t download_streams[CONFIG_EXAMPLE_DOWNLOAD_STREAMS_COUNT];
+
+/**
+ * @brief Threads of the streams
+ */
+static K_THREAD_STACK_ARRAY_DEFINE(download_streams_stacks, CONFIG_EXAMPLE_DOWNLOAD_STREAMS_COUNT, CONFIG_EXAMPLE_DOWNLOAD_STREAMS_STACK_SIZE);
+static struct k_thread download_streams_threads[CONFIG_EXAMPLE_DOWNLOAD_STREAMS_COUNT];
+
+/**
+ * @brief Parse the URL of the artifact
+ * @param url URL of the artifact
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+download_streams_parse_url(const char *url) {
+
+    const char *host;
+    const char *end;
+    const char *colon;
+
+    /* Scheme */
+    if (0 == strncmp(url, "https://", strlen("https://"))) {
+        download_streams_ctx.secure = true;
+        host                        = url + strlen("https://");
+        strcpy(download_streams_ctx.port, "443");
+    } else if (0 == strncmp(url, "http://", strlen("http://"))) {
+        download_streams_ctx.secure = false;
+        host                        = url + strlen("http://");
+        strcpy(download_streams_ctx.port, "80");
+    } else {
+        return -EINVAL;
+    }
+
+    /* Host, port and path */
+    if (NULL == (end = strchr(host, '/'))) {
+        end                       = host + strlen(host);
+        download_streams_ctx.path = "/";
+    } else {
+        download_streams_ctx.path = end;
+    }
+    colon                              = memchr(host, ':', end - host);
+    download_streams_ctx.explicit_port = (NULL != colon);
+    if (NULL == colon) {
+        colon = end;
+    } else if ((size_t)(end - colon - 1) >= EXAMPLE_DOWNLOAD_STREAMS_PORT_SIZE) {
+        return -EINVAL;
+    } else {
+        memcpy(download_streams_ctx.port, colon + 1, end - colon - 1);
+        download_streams_ctx.port[end - colon - 1] = '\0';
+    }
+    if ((size_t)(colon - host) >= EXAMPLE_DOWNLOAD_STREAMS_HOST_SIZE) {
+        return -ENAMETOOLONG;
+    }
+    memcpy(download_streams_ctx.host, host, colon - host);
+    download_streams_ctx.host[colon - host] = '\0';
+
+    return 0;
+}
+
+/**
+ * @brief Connect a stream to the host of the artifact
+ * @param stream Stream
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+download_streams_connect(example_download_streams_stream_t *stream) {
+
+    struct zsock_addrinfo  hints     = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct zsock_addrinfo *addr      = NULL;
+    sec_tag_t              sec_tag[] = { CONFIG_MENDER_NET_CA_CERTIFICATE_TAG };
+    int                    result    = 0;
+
+    /* Resolve host */
+    if (0 != zsock_getaddrinfo(download_streams_ctx.host, download_streams_ctx.port, &hints, &addr)) {
+        LOG_ERR("Unable to resolve '%s'", download_streams_ctx.host);
+        return -EHOSTUNREACH;
+    }
+
+    /* Create socket, TLS is handled by the sockets */
+    if ((stream->sock = zsock_socket(addr->ai_family, SOCK_STREAM, download_streams_ctx.secure ? IPPROTO_TLS_1_2 : IPPROTO_TCP)) < 0) {
+        result = -errno;
+        goto END;
+    }
+    if (true == download_streams_ctx.secure) {
+        if ((zsock_setsockopt(stream->sock, SOL_TLS, TLS_SEC_TAG_LIST, sec_tag, sizeof(sec_tag)) < 0)
+            || (zsock_setsockopt(stream->sock, SOL_TLS, TLS_HOSTNAME, download_streams_ctx.host, strlen(download_streams_ctx.host) + 1) < 0)) {
+            result = -errno;
+            goto END;
+        }
+    }
+
+    /* Connect */
+    if (zsock_connect(stream->sock, addr->ai_addr, addr->ai_addrlen) < 0) {
+        result = -errno;
+        goto END;
+    }
+
+END:
+
+    /* Release memory */
+    if ((0 != result) && (stream->sock >= 0)) {
+        zsock_close(stream->sock);
+        stream->sock = -1;
+    }
+    zsock_freeaddrinfo(addr);
+
+    return result;
+}
+
+/**
+ * @brief HTTP parser callback, save the name of the header being received
+ * @param parser HTTP parser of the request
+ * @param at Name of the header, or part of it
+ * @param length Length of the name
+ * @return Always returns 0
+ */
+static int
+download_streams_header_field_cb(struct http_parser *parser, const char *at, size_t length) {
+
+    struct http_request               *req    = CONTAINER_OF(parser, struct http_request, internal.parser);
+    example_download_streams_stream_t *stream = (example_download_streams_stream_t *)req->internal.user_data;
+
+    /* A new header begins after a value */
+    if (true == stream->header_value) {
+        stream->header_value     = false;
+        stream->header_field_len = 0;
+    }
+    if (stream->header_field_len + length <= sizeof(stream->header_field)) {
+        memcpy(&stream->header_field[stream->header_field_len], at, length);
+    }
+    stream->header_field_len += length;
+
+    return 0;
+}
+
+/**
+ * @brief HTTP parser callback, save the value of the Content-Range header
+ * @param parser HTTP parser of the request
+ * @param at Value of the header, or part of it
+ * @param length Length of the value
+ * @return Always returns 0
+ */
+static int
+download_streams_header_value_cb(struct http_parser *parser, const char *at, size_t length) {
+
+    struct http_request               *req    = CONTAINER_OF(parser, struct http_request, internal.parser);
+    example_download_streams_stream_t *stream = (example_download_streams_stream_t *)req->internal.user_data;
+
+    stream->header_value = true;
+    if ((strlen("Content-Range") == stream->header_field_len) && (0 == strncasecmp(stream->header_field, "Content-Range", stream->header_field_len))
+        && (stream->content_range_len + length <= EXAMPLE_DOWNLOAD_STREAMS_CONTENT_RANGE_SIZE)) {
+        memcpy(&stream->content_range[stream->content_range_len], at, length);
+        stream->content_range_len += length;
+        stream->content_range[stream->content_range_len] = '\0';
+    }
+
+    return 0;
+}
+
+/**
+ * @brief HTTP parser callbacks of the range requests, called by the HTTP client in addition to its own callbacks
+ */
+static const struct http_parser_settings download_streams_parser_settings
+    = { .on_header_field = download_streams_header_field_cb, .on_header_value = download_streams_header_value_cb };
+
+/**
+ * @brief Stop the reception of the response, the socket is closed from the callback so that the HTTP client returns at its next reception
+ * @note zsock_shutdown does not wake the reception of a TLS socket, the HTTP client would wait until the end of the response or the timeout
+ * @param sock Socket, set to -1
+ */
+static void
+download_streams_abort(int *sock) {
+
+    zsock_close(*sock);
+    *sock = -1;
+}
+
+/**
+ * @brief HTTP response callback, copy the body to the slot of the range
+ * @param rsp HTTP response
+ * @param final_data Indicates if the response is complete
+ * @param user_data Stream
+ */
+static void
+download_streams_response_cb(struct http_response *rsp, enum http_final_call final_data, void *user_data) {
+
+    (void)final_data;
+    example_download_streams_stream_t *stream = (example_download_streams_stream_t *)user_data;
+
+    stream->http_status = rsp->http_status_code;
+    if ((NULL != rsp->body_frag_start) && (0 != rsp->body_frag_len)) {
+        if (stream->slot->length + rsp->body_frag_len > CONFIG_EXAMPLE_DOWNLOAD_STREAMS_RANGE_SIZE) {
+            /* The whole artifact is sent when the server does not support range requests, stop the reception */
+            if ((true != stream->overflow) && (200 == stream->http_status)) {
+                download_streams_abort(&stream->sock);
+            }
+            stream->overflow = true;
+        } else {
+            memcpy(&stream->slot->data[stream->slot->length], rsp->body_frag_start, rsp->body_frag_len);
+            stream->slot->length += rsp->body_frag_len;
+        }
+    }
+}
+
+/**
+ * @brief Check the Content-Range header of the response to the request of a range against the range requested and the data received
+ * @param stream Stream
+ * @param index Index of the range
+ * @return 0 if the Content-Range header is valid, error code otherwise
+ */
+static int
+download_streams_check_range(example_download_streams_stream_t *stream, int32_t index) {
+
+    char         *end;
+    unsigned long first;
+    unsigned long last;
+
+    /* Content-Range is "bytes first-last/size" */
+    if (0 != strncmp(stream->content_range, "bytes ", strlen("bytes "))) {
+        return -EINVAL;
+    }
+    first = strtoul(stream->content_range + strlen("bytes "), &end, 10);
+    if ('-' != *end) {
+        return -EINVAL;
+    }
+    last = strtoul(end + 1, &end, 10);
+    if ('/' != *end) {
+        return -EINVAL;
+    }
+
+    /* The range must begin at the offset requested and contain the data received */
+    if ((first != (unsigned long)index * CONFIG_EXAMPLE_DOWNLOAD_STREAMS_RANGE_SIZE) || (last < first) || (last - first + 1 != stream->slot->length)) {
+        return -ERANGE;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Request a range of the artifact, the connection of the stream is kept alive and it is opened again once if the request fails
+ * @param stream Stream
+ * @param index Index of the range
+ * @return 0 if the response is received, error code otherwise
+ */
+static int
+download_streams_fetch(example_download_streams_stream_t *stream, int32_t index) {
+
+    char                range[48];
+    const char         *headers[] = { range, NULL };
+    struct http_request req;
+    int                 result = -EIO;
+
+    /* Prepare request */
+    snprintf(range,
+             sizeof(range),
+             "Range: bytes=%u-%u\r\n",
+             (uint32_t)index * CONFIG_EXAMPLE_DOWNLOAD_STREAMS_RANGE_SIZE,
+             (uint32_t)(index + 1) * CONFIG_EXAMPLE_DOWNLOAD_STREAMS_RANGE_SIZE - 1);
+    memset(&req, 0, sizeof(struct http_request));
+    req.method        = HTTP_GET;
+    req.url           = download_streams_ctx.path;
+    req.host          = download_streams_ctx.host;
+    req.port          = (true == download_streams_ctx.explicit_port) ? download_streams_ctx.port : NULL;
+    req.protocol      = "HTTP/1.1";
+    req.header_fields = headers;
+    req.http_cb       = &download_streams_parser_settings;
+    req.response      = download_streams_response_cb;
+    req.recv_buf      = stream->recv_buffer;
+    req.recv_buf_len  = sizeof(stream->recv_buffer);
+
+    /* Perform request */
+    for (size_t attempt = 0; attempt < 2; attempt++) {
+        stream->slot->length      = 0;
+        stream->http_status       = 0;
+        stream->overflow          = false;
+        stream->header_field_len  = 0;
+        stream->header_value      = false;
+        stream->content_range[0]  = '\0';
+        stream->content_range_len = 0;
+        if ((stream->sock < 0) && (0 != (result = download_streams_connect(stream)))) {
+            continue;
+        }
+        result = http_client_req(stream->sock, &req, EXAMPLE_DOWNLOAD_STREAMS_TIMEOUT, stream);
+
+        /* The reception is stopped when the server sends the whole artifact */
+        if (((result >= 0) || ((true == stream->overflow) && (200 == stream->http_status))) && (0 != stream->http_status)) {
+            return 0;
+        }
+        if (stream->sock >= 0) {
+            zsock_close(stream->sock);
+            stream->sock = -1;
+        }
+        result = (result < 0) ? result : -EIO;
+    }
+
+    return result;
+}
+
+/**
+ * @brief HTTP response callback of the single stream, give the body to the callback of the mender-mcu-client
+ * @param rsp HTTP response
+ * @param final_data Indicates if the response is complete
+ * @param user_data Download context of the single stream
+ */
+static void
+download_streams_single_response_cb(struct http_response *rsp, enum http_final_call final_data, void *user_data) {
+
+    (void)final_data;
+    example_download_streams_single_t *single = (example_download_streams_single_t *)user_data;
+    size_t                             skipped;
+
+    single->http_status = rsp->http_status_code;
+    if ((200 != single->http_status) || (MENDER_OK != single->ret) || (NULL == rsp->body_frag_start) || (0 == rsp->body_frag_len)) {
+        return;
+    }
+
+    /* Skip the data already given to the callback */
+    skipped = MIN(single->skip, rsp->body_frag_len);
+    single->skip -= skipped;
+    if (rsp->body_frag_len > skipped) {
+        single->ret = single->callback(MENDER_HTTP_EVENT_DATA_RECEIVED, rsp->body_frag_start + skipped, rsp->body_frag_len - skipped, single->params);
+        single->total += rsp->body_frag_len - skipped;
+
+        /* Stop the reception if the callback fails */
+        if (MENDER_OK != single->ret) {
+            download_streams_abort(&single->sock);
+        }
+    }
+}
+
+/**
+ * @brief Download the artifact with a single request, used when the server does not support range requests
+ * @param single Download context of the single stream, the data already given to the callback is skipped
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+download_streams_single(example_download_streams_single_t *single) {
+
+    example_download_streams_stream_t *stream  = &download_streams[0];
+    struct zsock_timeval               timeout = { .tv_sec = EXAMPLE_DOWNLOAD_STREAMS_TIMEOUT / 1000, .tv_usec = 0 };
+    struct http_request                req;
+    int                                result;
+
+    /* Connect, the timeout applies to each reception because the whole artifact is received */
+    if ((0 != (result = download_streams_connect(stream))) || (zsock_setsockopt(stream->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)) {
+        LOG_ERR("Unable to connect to '%s' (%d)", download_streams_ctx.host, (0 != result) ? result : -errno);
+        if (stream->sock >= 0) {
+            zsock_close(stream->sock);
+            stream->sock = -1;
+        }
+        return MENDER_FAIL;
+    }
+
+    /* Perform request */
+    memset(&req, 0, sizeof(struct http_request));
+    req.method       = HTTP_GET;
+    req.url          = download_streams_ctx.path;
+    req.host         = download_streams_ctx.host;
+    req.port         = (true == download_streams_ctx.explicit_port) ? download_streams_ctx.port : NULL;
+    req.protocol     = "HTTP/1.1";
+    req.response     = download_streams_single_response_cb;
+    req.recv_buf     = stream->recv_buffer;
+    req.recv_buf_len = sizeof(stream->recv_buffer);
+    single->sock     = stream->sock;
+    result           = http_client_req(stream->sock, &req, SYS_FOREVER_MS, single);
+    if (single->sock >= 0) {
+        zsock_close(single->sock);
+    }
+    stream->sock = -1;
+
+    /* Check the artifact is complete */
+    if (MENDER_OK != single->ret) {
+        return single->ret;
+    }
+    if ((result < 0) || (200 != single->http_status) || (0 != single->skip)) {
+        LOG_ERR("Unable to download the artifact with a single stream (%d, status %u)", result, single->http_status);
+        return MENDER_FAIL;
+    }
+
+    return MENDER_OK;
+}
+
+/**
+ * @brief Stream thread, request the next range while its slot in the reorder buffer is free
+ * @param p1 Stream
+ * @param p2 Not used
+ * @param p3 Not used
+ */
+static void
+download_streams_thread(void *p1, void *p2, void *p3) {
+
+    (void)p2;
+    (void)p3;
+    example_download_streams_stream_t *stream = (example_download_streams_stream_t *)p1;
+    example_download_streams_slot_t   *slot;
+    int32_t                            index;
+    int                                result;
+
+    while (true) {
+
+        /* Wait for a free slot */
+        k_mutex_lock(&download_streams_lock, K_FOREVER);
+        while ((true != download_streams_ctx.error) && (true != download_streams_ctx.single) && (download_streams_ctx.next_fetch < download_streams_ctx.end)
+               && (download_streams_ctx.next_fetch >= download_streams_ctx.next_deliver + CONFIG_EXAMPLE_DOWNLOAD_STREAMS_REORDER_SLOTS)) {
+            k_condvar_wait(&download_streams_cond, &download_streams_lock, K_FOREVER);
+        }
+        if ((true == download_streams_ctx.error) || (true == download_streams_ctx.single) || (download_streams_ctx.next_fetch >= download_streams_ctx.end)) {
+            k_mutex_unlock(&download_streams_lock);
+            break;
+        }
+        index        = download_streams_ctx.next_fetch++;
+        slot         = &download_streams_slots[index % CONFIG_EXAMPLE_DOWNLOAD_STREAMS_REORDER_SLOTS];
+        slot->index  = index;
+        slot->ready  = false;
+        stream->slot = slot;
+        k_mutex_unlock(&download_streams_lock);
+
+        /* Request the range */
+        result = download_streams_fetch(stream, index);
+
+        /* The end of the artifact is reached when a range is not complete or when it is after the end of the artifact */
+        k_mutex_lock(&download_streams_lock, K_FOREVER);
+        if (true == download_streams_ctx.single) {
+            /* The download continues with a single stream, the range is dropped */
+        } else if (0 != result) {
+            LOG_ERR("Unable to download range %d (%d)", index, result);
+            download_streams_ctx.error = true;
+        } else if (416 == stream->http_status) {
+            slot->length             = 0;
+            slot->ready              = true;
+            download_streams_ctx.end = MIN(download_streams_ctx.end, index);
+        } else if ((206 == stream->http_status) && (true != stream->overflow)) {
+            if (0 != (result = download_streams_check_range(stream, index))) {
+                LOG_ERR("Invalid Content-Range '%s' in the response to the request of range %d (%d)", stream->content_range, index, result);
+                download_streams_ctx.error = true;
+            } else {
+                slot->ready = true;
+                if (slot->length < CONFIG_EXAMPLE_DOWNLOAD_STREAMS_RANGE_SIZE) {
+                    download_streams_ctx.end = MIN(download_streams_ctx.end, index + 1);
+                }
+            }
+        } else if ((200 == stream->http_status) && (0 == index) && (true != stream->overflow)) {
+            /* Range is not supported but the artifact fits in the first slot */
+            slot->ready              = true;
+            download_streams_ctx.end = 1;
+        } else if (200 == stream->http_status) {
+            /* Range is not supported, the other streams are stopped */
+            LOG_WRN("Range requests are not supported by the server, the download continues with a single stream");
+            download_streams_ctx.single = true;
+        } else {
+            LOG_ERR("Unexpected response %u to the request of range %d", stream->http_status, index);
+            download_streams_ctx.error = true;
+        }
+        k_condvar_broadcast(&download_streams_cond);
+        k_mutex_unlock(&download_streams_lock);
+    }
+
+    /* Release connection */
+    if (stream->sock >= 0) {
+        zsock_close(stream->sock);
+        stream->sock = -1;
+    }
+}
+
+bool
+example_download_streams_match(char *jwt, char *path, mender_http_method_t method) {
+
+    /* The artifact is downloaded without token using its full URL */
+    return (NULL == jwt) && (MENDER_HTTP_GET == method) && (NULL != path) && (0 == strncmp(path, "http", strlen("http")));
+}
+
+mender_err_t
+example_download_streams_perform(char *url,
+                                 mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *),
+                                 void *params,
+                                 int  *status) {
+
+    example_download_streams_slot_t  *slot;
+    example_download_streams_single_t single;
+    int64_t                           begin    = k_uptime_get();
+    int                               priority = k_thread_priority_get(k_current_get());
+    size_t                            total    = 0;
+    mender_err_t                      ret;
+    int                               result;
+
+    /* Parse URL */
+    if (0 != (result = download_streams_parse_url(url))) {
+        LOG_ERR("Invalid URL of the artifact (%d)", result);
+        return MENDER_FAIL;
+    }
+
+    /* Initialize reorder buffer */
+    download_streams_ctx.next_fetch   = 0;
+    download_streams_ctx.next_deliver = 0;
+    download_streams_ctx.end          = INT32_MAX;
+    download_streams_ctx.single       = false;
+    download_streams_ctx.error        = false;
+    for (size_t index = 0; index < CONFIG_EXAMPLE_DOWNLOAD_STREAMS_REORDER_SLOTS; index++) {
+        download_streams_slots[index].index = -1;
+        download_streams_slots[index].ready = false;
+    }
+    if (MENDER_OK != (ret = callback(MENDER_HTTP_EVENT_CONNECTED, NULL, 0, params))) {
+        return ret;
+    }
+
+    /* Start the streams at the priority of the mender client */
+    for (size_t index = 0; index < CONFIG_EXAMPLE_DOWNLOAD_STREAMS_COUNT; index++) {
+        download_streams[index].sock = -1;
+        k_thread_create(&download_streams_threads[index],
+                        download_streams_stacks[index],
+                        K_THREAD_STACK_SIZEOF(download_streams_stacks[index]),
+                        download_streams_thread,
+                        &download_streams[index],
+                        NULL,
+                        NULL,
+                        priority,
+                        0,
+                        K_NO_WAIT);
+        k_thread_name_set(&download_streams_threads[index], "download_stream");
+    }
+
+    /* Give the ranges to the callback in order */
+    while (MENDER_OK == ret) {
+        k_mutex_lock(&download_streams_lock, K_FOREVER);
+        slot = &download_streams_slots[download_streams_ctx.next_deliver % CONFIG_EXAMPLE_DOWNLOAD_STREAMS_REORDER_SLOTS];
+        while ((true != download_streams_ctx.error) && (true != download_streams_ctx.single) && (download_streams_ctx.next_deliver < download_streams_ctx.end)
+               && ((slot->index != download_streams_ctx.next_deliver) || (true != slot->ready))) {
+            k_condvar_wait(&download_streams_cond, &download_streams_lock, K_FOREVER);
+        }
+        if (true == download_streams_ctx.error) {
+            ret = MENDER_FAIL;
+        }
+        if ((true == download_streams_ctx.error) || (true == download_streams_ctx.single) || (download_streams_ctx.next_deliver >= download_streams_ctx.end)) {
+            k_mutex_unlock(&download_streams_lock);
+            break;
+        }
+        k_mutex_unlock(&download_streams_lock);
+        if (0 != slot->length) {
+            ret = callback(MENDER_HTTP_EVENT_DATA_RECEIVED, slot->data, slot->length, params);
+            total += slot->length;
+        }
+
+        /* Release the slot, the next range can be requested */
+        k_mutex_lock(&download_streams_lock, K_FOREVER);
+        slot->index = -1;
+        slot->ready = false;
+        download_streams_ctx.next_deliver++;
+        k_condvar_broadcast(&download_streams_cond);
+        k_mutex_unlock(&download_streams_lock);
+    }
+
+    /* Stop the streams */
+    k_mutex_lock(&download_streams_lock, K_FOREVER);
+    if (MENDER_OK != ret) {
+        download_streams_ctx.error = true;
+    }
+    k_condvar_broadcast(&download_streams_cond);
+    k_mutex_unlock(&download_streams_lock);
+    for (size_t index = 0; index < CONFIG_EXAMPLE_DOWNLOAD_STREAMS_COUNT; index++) {
+        k_thread_join(&download_streams_threads[index], K_FOREVER);
+    }
+
+    /* Range is not supported, download the artifact again with a single stream, the ranges already given to the callback are skipped */
+    if ((MENDER_OK == ret) && (true == download_streams_ctx.single)) {
+        single.callback = callback;
+        single.params   = params;
+        single.skip     = total;
+        single.total    = total;
+        single.ret      = MENDER_OK;
+        ret             = download_streams_single(&single);
+        total           = single.total;
+    }
+
+    /* Notify the end of the download */
+    if (MENDER_OK != ret) {
+        callback(MENDER_HTTP_EVENT_ERROR, NULL, 0, params);
+        return ret;
+    }
+    *status = 200;
+    LOG_INF("Artifact downloaded with %d streams, %u bytes in %u ms",
+            (true == download_streams_ctx.single) ? 1 : CONFIG_EXAMPLE_DOWNLOAD_STREAMS_COUNT,
+            (uint32_t)total,
+            (uint32_t)(k_uptime_get() - begin));
+
+    return callback(MENDER_HTTP_EVENT_DISCONNECTED, NULL, 0, params);
+}
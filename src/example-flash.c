@@ -0,0 +1,720 @@
+/**
+ * @file      example-flash.c
+ * @brief     Mender flash platform implementation, the checksum of the image is computed while it is written
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <zephyr/kernel.h>
+#include <zephyr/dfu/mcuboot.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "mender-flash.h"
+
+#include "example-crypto.h"
+#include "example-flash.h"
+
+#ifdef CONFIG_EXAMPLE_DOWNLOAD_LIMIT
+#include "example-download-limit.h"
+#endif /* CONFIG_EXAMPLE_DOWNLOAD_LIMIT */
+#ifdef CONFIG_EXAMPLE_TRACE
+#include "example-trace.h"
+#endif /* CONFIG_EXAMPLE_TRACE */
+
+/**
+ * @brief MCUboot image header, only the fields used to locate the TLV area are decoded
+ */
+#define EXAMPLE_FLASH_IMAGE_MAGIC       (0x96f3b83d)
+#define EXAMPLE_FLASH_IMAGE_HEADER_SIZE (32)
+
+/**
+ * @brief MCUboot TLV area, the SHA256 TLV is located at the beginning of the unprotected TLV area
+ */
+#define EXAMPLE_FLASH_TLV_INFO_MAGIC (0x6907)
+#define EXAMPLE_FLASH_TLV_SHA256     (0x10)
+#define EXAMPLE_FLASH_TLV_SIZE       (128)
+
+/**
+ * @brief Sector and write block sizes of the flash where the update slot is located
+ */
+#define EXAMPLE_FLASH_SECTOR_SIZE      DT_PROP(DT_MTD_FROM_FIXED_PARTITION(DT_NODELABEL(slot1_partition)), erase_block_size)
+#define EXAMPLE_FLASH_WRITE_BLOCK_SIZE DT_PROP(DT_MTD_FROM_FIXED_PARTITION(DT_NODELABEL(slot1_partition)), write_block_size)
+
+/**
+ * @brief Size of the chunks read to check if a sector is erased
+ */
+#define EXAMPLE_FLASH_READ_CHUNK_SIZE (64)
+
+#ifdef CONFIG_EXAMPLE_FLASH_PRE_ERASE
+
+/**
+ * @brief Pre-erase work queue priority, the sectors are erased when the network and the mender client are idle
+ */
+#define EXAMPLE_FLASH_PRE_ERASE_WORK_QUEUE_PRIORITY (K_LOWEST_APPLICATION_THREAD_PRIO)
+
+#endif /* CONFIG_EXAMPLE_FLASH_PRE_ERASE */
+
+/**
+ * @brief Flash context
+ */
+typedef struct {
+    const struct flash_area *flash_area;                              /**< Update slot */
+    example_crypto_sha256_t  sha256;                                  /**< Checksum of the image computed while it is written */
+    size_t                   size;                                    /**< Size of the image */
+    size_t                   offset;                                  /**< Number of bytes received */
+    bool                     verify;                                  /**< Image is a MCUboot image and the checksum is verified */
+    size_t                   hashed_size;                             /**< Size of the hashed part of the image, header, payload and protected TLVs */
+    uint8_t                  header[EXAMPLE_FLASH_IMAGE_HEADER_SIZE]; /**< Image header */
+    uint8_t                  tlv[EXAMPLE_FLASH_TLV_SIZE];             /**< Beginning of the unprotected TLV area */
+    uint8_t __aligned(4)     sector[EXAMPLE_FLASH_SECTOR_SIZE];       /**< Data of the current sector, programmed when it is complete */
+    size_t                   sector_length;                           /**< Number of bytes of the current sector */
+    int64_t                  begin;                                   /**< Uptime when the image is opened, used to compute the throughput */
+    uint32_t                 written_count;                           /**< Number of sectors programmed */
+    uint32_t                 skipped_count;                           /**< Number of sectors skipped because they are identical to the content of the slot */
+    uint32_t                 erase_count;                             /**< Number of sectors erased by the writer */
+    uint64_t                 erase_duration;                          /**< Time spent by the writer to erase sectors, in ticks */
+} example_flash_ctx_t;
+
+/**
+ * @brief Flash context, only one image is written at a time
+ */
+static example_flash_ctx_t flash_ctx;
+
+/**
+ * @brief Erased-watermark of the update slot and its lock
+ * @note The sectors between the current sector of the writer and the watermark are erased. The watermark is moved by the pre-erase work and by the
+ * writer, which only erases a sector itself when the pre-erase is late. It is reset when the slot is written.
+ */
+static K_MUTEX_DEFINE(flash_erase_lock);
+static size_t flash_erase_watermark = 0;
+
+#ifdef CONFIG_EXAMPLE_FLASH_PRE_ERASE
+
+/**
+ * @brief Pre-erase work queue
+ */
+static K_THREAD_STACK_DEFINE(flash_pre_erase_work_queue_stack, CONFIG_EXAMPLE_FLASH_PRE_ERASE_STACK_SIZE);
+static struct k_work_q flash_pre_erase_work_queue;
+static struct k_work   flash_pre_erase_work;
+
+/**
+ * @brief Pre-erase is allowed, it is stopped when the slot is written
+ */
+static bool flash_pre_erase_enabled = false;
+
+#endif /* CONFIG_EXAMPLE_FLASH_PRE_ERASE */
+
+/**
+ * @brief Compare a sector with data and check if it is erased, reading stops as soon as the sector is neither identical nor erased
+ * @param flash_area Flash area
+ * @param offset Offset of the sector
+ * @param data Data compared to the beginning of the sector, NULL to only check if the sector is erased
+ * @param length Length of the data
+ * @param identical true if the beginning of the sector is identical to the data, false otherwise
+ * @param erased true if the sector is erased, false otherwise
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+flash_sector_check(const struct flash_area *flash_area, size_t offset, const uint8_t *data, size_t length, bool *identical, bool *erased) {
+
+    uint8_t buffer[EXAMPLE_FLASH_READ_CHUNK_SIZE];
+    uint8_t erased_value = flash_area_erased_val(flash_area);
+    int     result;
+
+    *identical = (NULL != data);
+    *erased    = true;
+    for (size_t index = 0; ((true == *identical) || (true == *erased)) && (index < EXAMPLE_FLASH_SECTOR_SIZE); index += sizeof(buffer)) {
+        if (0 != (result = flash_area_read(flash_area, offset + index, buffer, sizeof(buffer)))) {
+            return result;
+        }
+        if ((true == *identical) && (index < length)) {
+            *identical = (0 == memcmp(buffer, &data[index], MIN(sizeof(buffer), length - index)));
+        }
+        for (size_t byte = 0; (true == *erased) && (byte < sizeof(buffer)); byte++) {
+            *erased = (erased_value == buffer[byte]);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Erase a sector, the sector is only read if it is already erased
+ * @param flash_area Flash area
+ * @param offset Offset of the sector
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+flash_sector_erase(const struct flash_area *flash_area, size_t offset) {
+
+    bool identical, erased;
+    int  result;
+
+    if (0 != (result = flash_sector_check(flash_area, offset, NULL, 0, &identical, &erased))) {
+        return result;
+    }
+
+    return (true == erased) ? 0 : flash_area_erase(flash_area, offset, EXAMPLE_FLASH_SECTOR_SIZE);
+}
+
+/**
+ * @brief Erase a sector by the writer, the time spent is recorded
+ * @param ctx Flash context
+ * @param offset Offset of the sector
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+flash_writer_erase(example_flash_ctx_t *ctx, size_t offset) {
+
+#ifdef CONFIG_EXAMPLE_TRACE
+    uint64_t timestamp = example_trace_timestamp();
+#endif /* CONFIG_EXAMPLE_TRACE */
+    int64_t begin  = k_uptime_ticks();
+    int     result = flash_sector_erase(ctx->flash_area, offset);
+
+    ctx->erase_count++;
+    ctx->erase_duration += k_uptime_ticks() - begin;
+#ifdef CONFIG_EXAMPLE_TRACE
+    example_trace_record(EXAMPLE_TRACE_PHASE_FLASH_ERASE, timestamp);
+#endif /* CONFIG_EXAMPLE_TRACE */
+
+    return result;
+}
+
+#ifndef CONFIG_EXAMPLE_FLASH_SKIP_IDENTICAL
+
+/**
+ * @brief Make sure the sectors are erased up to the wanted offset, the sectors above the watermark are erased by the writer
+ * @param ctx Flash context
+ * @param end Offset of the end of the data to be programmed
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+flash_erase_until(example_flash_ctx_t *ctx, size_t end) {
+
+    int result = 0;
+
+    k_mutex_lock(&flash_erase_lock, K_FOREVER);
+    while ((0 == result) && (flash_erase_watermark < end)) {
+        if (0 == (result = flash_writer_erase(ctx, flash_erase_watermark))) {
+            flash_erase_watermark += EXAMPLE_FLASH_SECTOR_SIZE;
+        }
+    }
+    k_mutex_unlock(&flash_erase_lock);
+
+    return result;
+}
+
+#endif /* CONFIG_EXAMPLE_FLASH_SKIP_IDENTICAL */
+
+/**
+ * @brief Reset the watermark when the slot is written, the pre-erase is stopped
+ */
+static void
+flash_erase_reset(void) {
+
+    k_mutex_lock(&flash_erase_lock, K_FOREVER);
+    flash_erase_watermark = 0;
+#ifdef CONFIG_EXAMPLE_FLASH_PRE_ERASE
+    flash_pre_erase_enabled = false;
+#endif /* CONFIG_EXAMPLE_FLASH_PRE_ERASE */
+    k_mutex_unlock(&flash_erase_lock);
+}
+
+/**
+ * @brief Program the current sector, it is erased before if required
+ * @param ctx Flash context
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+flash_program_sector(example_flash_ctx_t *ctx) {
+
+    size_t offset = ctx->offset - ctx->sector_length;
+    size_t length = ROUND_UP(ctx->sector_length, EXAMPLE_FLASH_WRITE_BLOCK_SIZE);
+    int    result;
+
+    /* Pad the last sector to the write block size */
+    memset(&ctx->sector[ctx->sector_length], flash_area_erased_val(ctx->flash_area), length - ctx->sector_length);
+
+#ifdef CONFIG_EXAMPLE_FLASH_SKIP_IDENTICAL
+
+    /* Compare the sector with the current content of the slot, erase and program are skipped if it is identical */
+    bool identical, erased;
+    if (0 != (result = flash_sector_check(ctx->flash_area, offset, ctx->sector, length, &identical, &erased))) {
+        LOG_ERR("flash_area_read failed (%d)", result);
+        return result;
+    }
+    if (true == identical) {
+        ctx->sector_length = 0;
+        ctx->skipped_count++;
+        return 0;
+    }
+    if ((true != erased) && (0 != (result = flash_writer_erase(ctx, offset)))) {
+        LOG_ERR("flash_area_erase failed (%d)", result);
+        return result;
+    }
+
+#else
+
+    /* Erase the sector if the pre-erase has not reached it yet */
+    if (0 != (result = flash_erase_until(ctx, offset + EXAMPLE_FLASH_SECTOR_SIZE))) {
+        LOG_ERR("flash_area_erase failed (%d)", result);
+        return result;
+    }
+
+#endif /* CONFIG_EXAMPLE_FLASH_SKIP_IDENTICAL */
+
+#ifdef CONFIG_EXAMPLE_TRACE
+    uint64_t begin = example_trace_timestamp();
+#endif /* CONFIG_EXAMPLE_TRACE */
+
+    /* Program the sector */
+    if (0 != (result = flash_area_write(ctx->flash_area, offset, ctx->sector, length))) {
+        LOG_ERR("flash_area_write failed (%d)", result);
+    }
+    ctx->sector_length = 0;
+    ctx->written_count++;
+
+#ifdef CONFIG_EXAMPLE_TRACE
+    example_trace_record(EXAMPLE_TRACE_PHASE_FLASH_WRITE, begin);
+#endif /* CONFIG_EXAMPLE_TRACE */
+
+    return result;
+}
+
+/**
+ * @brief Parse image header and compute the size of the hashed part of the image
+ * @param ctx Flash context
+ */
+static void
+flash_parse_header(example_flash_ctx_t *ctx) {
+
+    /* Check image magic, the checksum is not verified if the image is not a MCUboot image */
+    if (EXAMPLE_FLASH_IMAGE_MAGIC != sys_get_le32(&ctx->header[0])) {
+        LOG_WRN("Image is not a MCUboot image, checksum is not verified");
+        ctx->verify = false;
+        return;
+    }
+
+    /* The hash covers the header, the payload and the protected TLVs */
+    ctx->hashed_size = sys_get_le16(&ctx->header[8]) + sys_get_le32(&ctx->header[12]) + sys_get_le16(&ctx->header[10]);
+    ctx->verify      = true;
+}
+
+/**
+ * @brief Process data written in the flash, update the checksum and save header and TLV area
+ * @param ctx Flash context
+ * @param data Data
+ * @param length Length of the data
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+flash_process(example_flash_ctx_t *ctx, const uint8_t *data, size_t length) {
+
+    size_t count;
+
+    while (length > 0) {
+        if (ctx->offset < EXAMPLE_FLASH_IMAGE_HEADER_SIZE) {
+            /* Save image header, it is also hashed */
+            count = MIN(length, EXAMPLE_FLASH_IMAGE_HEADER_SIZE - ctx->offset);
+            memcpy(&ctx->header[ctx->offset], data, count);
+            if (MENDER_OK != example_crypto_sha256_update(&ctx->sha256, data, count)) {
+                LOG_ERR("Unable to compute checksum");
+                return MENDER_FAIL;
+            }
+            if (EXAMPLE_FLASH_IMAGE_HEADER_SIZE == ctx->offset + count) {
+                flash_parse_header(ctx);
+            }
+        } else if ((true == ctx->verify) && (ctx->offset < ctx->hashed_size)) {
+            /* Hash the payload and protected TLVs */
+            count = MIN(length, ctx->hashed_size - ctx->offset);
+            if (MENDER_OK != example_crypto_sha256_update(&ctx->sha256, data, count)) {
+                LOG_ERR("Unable to compute checksum");
+                return MENDER_FAIL;
+            }
+        } else {
+            /* Save the beginning of the unprotected TLV area */
+            count = length;
+            if ((true == ctx->verify) && (ctx->offset - ctx->hashed_size < EXAMPLE_FLASH_TLV_SIZE)) {
+                memcpy(&ctx->tlv[ctx->offset - ctx->hashed_size], data, MIN(count, EXAMPLE_FLASH_TLV_SIZE - (ctx->offset - ctx->hashed_size)));
+            }
+        }
+        data += count;
+        length -= count;
+        ctx->offset += count;
+    }
+
+    return MENDER_OK;
+}
+
+/**
+ * @brief Compare the checksum computed while the image was written to the SHA256 TLV of the image
+ * @param ctx Flash context
+ * @return MENDER_OK if the checksum matches, error code otherwise
+ */
+static mender_err_t
+flash_verify(example_flash_ctx_t *ctx) {
+
+    uint8_t  digest[EXAMPLE_CRYPTO_SHA256_SIZE];
+    size_t   tlv_end = MIN(ctx->offset - ctx->hashed_size, EXAMPLE_FLASH_TLV_SIZE);
+    size_t   index   = 4;
+    uint16_t type, length;
+
+    /* Finalize checksum */
+    if (MENDER_OK != example_crypto_sha256_finish(&ctx->sha256, digest)) {
+        LOG_ERR("Unable to compute checksum");
+        return MENDER_FAIL;
+    }
+
+    /* Check TLV area */
+    if ((ctx->offset < ctx->hashed_size) || (tlv_end < 4) || (EXAMPLE_FLASH_TLV_INFO_MAGIC != sys_get_le16(&ctx->tlv[0]))) {
+        LOG_ERR("Invalid image, TLV area not found");
+        return MENDER_FAIL;
+    }
+
+    /* Search for the SHA256 TLV and compare the checksum */
+    while (index + 4 <= tlv_end) {
+        type   = sys_get_le16(&ctx->tlv[index]);
+        length = sys_get_le16(&ctx->tlv[index + 2]);
+        if ((EXAMPLE_FLASH_TLV_SHA256 == type) && (sizeof(digest) == length) && (index + 4 + length <= tlv_end)) {
+            if (0 != memcmp(&ctx->tlv[index + 4], digest, sizeof(digest))) {
+                LOG_ERR("Invalid image, checksum mismatch");
+                return MENDER_FAIL;
+            }
+            return MENDER_OK;
+        }
+        index += 4 + length;
+    }
+    LOG_ERR("Invalid image, checksum not found");
+
+    return MENDER_FAIL;
+}
+
+mender_err_t
+mender_flash_open(char *name, size_t size, void **handle) {
+
+    assert(NULL != name);
+    assert(NULL != handle);
+    int result;
+
+    /* Initialize flash context */
+    memset(&flash_ctx, 0, sizeof(example_flash_ctx_t));
+    flash_ctx.size  = size;
+    flash_ctx.begin = k_uptime_get();
+    if (0 != (result = flash_area_open(FIXED_PARTITION_ID(slot1_partition), &flash_ctx.flash_area))) {
+        LOG_ERR("flash_area_open failed (%d)", result);
+        return MENDER_FAIL;
+    }
+    if (size > flash_ctx.flash_area->fa_size) {
+        LOG_ERR("Image is too large, %u bytes, slot size is %u bytes", size, flash_ctx.flash_area->fa_size);
+        flash_area_close(flash_ctx.flash_area);
+        return MENDER_FAIL;
+    }
+
+    /* Start computing the checksum */
+    if (MENDER_OK != example_crypto_sha256_start(&flash_ctx.sha256)) {
+        LOG_ERR("Unable to start computing checksum");
+        flash_area_close(flash_ctx.flash_area);
+        return MENDER_FAIL;
+    }
+    *handle = &flash_ctx;
+
+    return MENDER_OK;
+}
+
+mender_err_t
+mender_flash_write(void *handle, void *data, size_t index, size_t length) {
+
+    assert(NULL != data);
+    example_flash_ctx_t *ctx = (example_flash_ctx_t *)handle;
+    const uint8_t       *ptr = (const uint8_t *)data;
+    size_t               count;
+
+    /* Check flash handle */
+    if (NULL == ctx) {
+        LOG_ERR("Invalid flash handle");
+        return MENDER_FAIL;
+    }
+
+    /* Data are expected to be written sequentially */
+    if (index != ctx->offset) {
+        LOG_ERR("Unexpected offset %u, expected %u", index, ctx->offset);
+        return MENDER_FAIL;
+    }
+
+    /* Check size of the image */
+    if (ctx->offset + length > ctx->size) {
+        LOG_ERR("Invalid image, more than %u bytes received", ctx->size);
+        return MENDER_FAIL;
+    }
+
+    while (length > 0) {
+        /* Copy data to the current sector */
+        count = MIN(length, EXAMPLE_FLASH_SECTOR_SIZE - ctx->sector_length);
+        memcpy(&ctx->sector[ctx->sector_length], ptr, count);
+        ctx->sector_length += count;
+
+        /* Update checksum */
+        if (MENDER_OK != flash_process(ctx, ptr, count)) {
+            return MENDER_FAIL;
+        }
+        ptr += count;
+        length -= count;
+
+        /* Program the sector when it is complete */
+        if ((EXAMPLE_FLASH_SECTOR_SIZE == ctx->sector_length) && (0 != flash_program_sector(ctx))) {
+            return MENDER_FAIL;
+        }
+    }
+
+#ifdef CONFIG_EXAMPLE_DOWNLOAD_LIMIT
+    /* Throttle the download if the limits are exceeded */
+    example_download_limit_chunk(ptr - (const uint8_t *)data);
+#endif /* CONFIG_EXAMPLE_DOWNLOAD_LIMIT */
+
+    return MENDER_OK;
+}
+
+mender_err_t
+mender_flash_close(void *handle) {
+
+    example_flash_ctx_t *ctx    = (example_flash_ctx_t *)handle;
+    mender_err_t         ret    = MENDER_OK;
+    int                  result = 0;
+    ssize_t              trailer;
+    size_t               start;
+    uint32_t             elapsed;
+
+    /* Check flash handle */
+    if (NULL == ctx) {
+        LOG_ERR("Invalid flash handle");
+        return MENDER_FAIL;
+    }
+
+#ifdef CONFIG_EXAMPLE_TRACE
+    uint64_t begin = example_trace_timestamp();
+#endif /* CONFIG_EXAMPLE_TRACE */
+
+    /* Program last data */
+    if ((ctx->sector_length > 0) && (0 != flash_program_sector(ctx))) {
+        ret = MENDER_FAIL;
+        goto END;
+    }
+
+    /* Erase the image trailer if the pre-erase has not reached it, it must be erased before the upgrade is requested */
+    if ((trailer = boot_get_area_trailer_status_offset(FIXED_PARTITION_ID(slot1_partition))) < 0) {
+        LOG_ERR("Unable to get image trailer offset (%d)", (int)trailer);
+        ret = MENDER_FAIL;
+        goto END;
+    }
+    k_mutex_lock(&flash_erase_lock, K_FOREVER);
+    start = MAX(ROUND_DOWN((size_t)trailer, EXAMPLE_FLASH_SECTOR_SIZE), ROUND_UP(ctx->offset, EXAMPLE_FLASH_SECTOR_SIZE));
+    for (size_t offset = MAX(start, flash_erase_watermark); (0 == result) && (offset < ctx->flash_area->fa_size); offset += EXAMPLE_FLASH_SECTOR_SIZE) {
+        result = flash_sector_erase(ctx->flash_area, offset);
+    }
+    k_mutex_unlock(&flash_erase_lock);
+    if (0 != result) {
+        LOG_ERR("flash_area_erase failed (%d)", result);
+        ret = MENDER_FAIL;
+        goto END;
+    }
+
+    /* Check size of the image */
+    if (ctx->offset != ctx->size) {
+        LOG_ERR("Invalid image, %u bytes written, expected %u", ctx->offset, ctx->size);
+        ret = MENDER_FAIL;
+        goto END;
+    }
+
+    /* Verify checksum, the image has been hashed while it was written so that the flash is not read again */
+    if ((true == ctx->verify) && (MENDER_OK != (ret = flash_verify(ctx)))) {
+        goto END;
+    }
+
+    /* Download throughput, sectors written and skipped, and time spent by the writer to erase sectors, compare the erase strategies */
+    elapsed = (uint32_t)MAX(k_uptime_get() - ctx->begin, 1);
+    LOG_INF("Image written, %u bytes in %u ms (%u KB/s), %u sectors written, %u skipped, %u erased while writing in %u ms",
+            ctx->offset,
+            elapsed,
+            (uint32_t)(ctx->offset / elapsed),
+            ctx->written_count,
+            ctx->skipped_count,
+            ctx->erase_count,
+            (uint32_t)k_ticks_to_ms_floor64(ctx->erase_duration));
+
+END:
+
+#ifdef CONFIG_EXAMPLE_TRACE
+    example_trace_record(EXAMPLE_TRACE_PHASE_FLASH_VERIFY, begin);
+#endif /* CONFIG_EXAMPLE_TRACE */
+
+    /* The slot is written, the watermark is not valid anymore */
+    flash_erase_reset();
+
+    /* Release checksum context and flash area */
+    example_crypto_sha256_free(&ctx->sha256);
+    flash_area_close(ctx->flash_area);
+
+    return ret;
+}
+
+mender_err_t
+mender_flash_set_pending_image(void *handle) {
+
+    int result;
+
+    /* Check flash handle */
+    if (NULL == handle) {
+        LOG_ERR("Invalid flash handle");
+        return MENDER_FAIL;
+    }
+
+    /* Request upgrade, the image is swapped at next boot and it must be confirmed to become permanent */
+    if (0 != (result = boot_request_upgrade(BOOT_UPGRADE_TEST))) {
+        LOG_ERR("boot_request_upgrade failed (%d)", result);
+        return MENDER_FAIL;
+    }
+
+    return MENDER_OK;
+}
+
+mender_err_t
+mender_flash_abort_deployment(void *handle) {
+
+    example_flash_ctx_t *ctx = (example_flash_ctx_t *)handle;
+
+    /* Release checksum context and flash area, nothing else to do because the image is not marked pending */
+    if (NULL != ctx) {
+        flash_erase_reset();
+        example_crypto_sha256_free(&ctx->sha256);
+        flash_area_close(ctx->flash_area);
+    }
+
+    return MENDER_OK;
+}
+
+mender_err_t
+mender_flash_confirm_image(void) {
+
+    int result;
+
+    /* Validate the image if it is still pending */
+    if (true != boot_is_img_confirmed()) {
+        if (0 != (result = boot_write_img_confirmed())) {
+            LOG_ERR("boot_write_img_confirmed failed (%d)", result);
+            return MENDER_FAIL;
+        }
+    }
+
+#ifdef CONFIG_EXAMPLE_FLASH_PRE_ERASE
+    /* The previous image is not needed anymore, erase the update slot during idle time */
+    if (MENDER_OK != example_flash_pre_erase_start()) {
+        LOG_WRN("Unable to start pre-erase of the update slot");
+    }
+#endif /* CONFIG_EXAMPLE_FLASH_PRE_ERASE */
+
+    return MENDER_OK;
+}
+
+bool
+mender_flash_is_image_confirmed(void) {
+
+    /* Check if the image is still pending */
+    return boot_is_img_confirmed();
+}
+
+#ifdef CONFIG_EXAMPLE_FLASH_PRE_ERASE
+
+/**
+ * @brief Pre-erase work handler, erase the sectors above the watermark one by one until the end of the slot
+ * @param work Work item
+ */
+static void
+flash_pre_erase_work_handler(struct k_work *work) {
+
+    (void)work;
+    const struct flash_area *flash_area;
+    int64_t                  begin = k_uptime_get();
+    size_t                   count = 0;
+    bool                     done  = false;
+    int                      result;
+
+    /* Open update slot */
+    if (0 != (result = flash_area_open(FIXED_PARTITION_ID(slot1_partition), &flash_area))) {
+        LOG_ERR("flash_area_open failed (%d)", result);
+        return;
+    }
+
+    /* Erase one sector at a time so that the writer never waits more than one sector */
+    while ((0 == result) && (true != done)) {
+        k_mutex_lock(&flash_erase_lock, K_FOREVER);
+        if ((true != flash_pre_erase_enabled) || (flash_erase_watermark >= flash_area->fa_size)) {
+            done = true;
+        } else if (0 == (result = flash_sector_erase(flash_area, flash_erase_watermark))) {
+            flash_erase_watermark += EXAMPLE_FLASH_SECTOR_SIZE;
+            count++;
+        }
+        k_mutex_unlock(&flash_erase_lock);
+    }
+    if (0 != result) {
+        LOG_ERR("flash_area_erase failed (%d)", result);
+    } else {
+        LOG_INF("Pre-erase of the update slot done, %u sectors checked in %u ms", count, (uint32_t)(k_uptime_get() - begin));
+    }
+
+    /* Release flash area */
+    flash_area_close(flash_area);
+}
+
+mender_err_t
+example_flash_init(void) {
+
+    /* Start pre-erase work queue */
+    k_work_queue_start(&flash_pre_erase_work_queue,
+                       flash_pre_erase_work_queue_stack,
+                       K_THREAD_STACK_SIZEOF(flash_pre_erase_work_queue_stack),
+                       EXAMPLE_FLASH_PRE_ERASE_WORK_QUEUE_PRIORITY,
+                       NULL);
+    k_thread_name_set(&flash_pre_erase_work_queue.thread, "flash_pre_erase");
+    k_work_init(&flash_pre_erase_work, flash_pre_erase_work_handler);
+
+    return MENDER_OK;
+}
+
+mender_err_t
+example_flash_pre_erase_start(void) {
+
+    /* The update slot must not be erased if an upgrade is pending or if the running image is not confirmed */
+    if (BOOT_SWAP_TYPE_NONE != mcuboot_swap_type()) {
+        return MENDER_OK;
+    }
+
+    /* Allow pre-erase and submit the work, nothing is done if the slot is already erased */
+    k_mutex_lock(&flash_erase_lock, K_FOREVER);
+    flash_pre_erase_enabled = true;
+    k_mutex_unlock(&flash_erase_lock);
+    if (k_work_submit_to_queue(&flash_pre_erase_work_queue, &flash_pre_erase_work) < 0) {
+        LOG_ERR("Unable to submit pre-erase work");
+        return MENDER_FAIL;
+    }
+
+    return MENDER_OK;
+}
+
+#endif /* CONFIG_EXAMPLE_FLASH_PRE_ERASE */
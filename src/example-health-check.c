@@ -0,0 +1,208 @@
+/**
+ * @file      example-health-check.c
+ * @brief     Health check pipeline used to confirm or rollback the image
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <zephyr/kernel.h>
+
+#include "example-health-check.h"
+
+/**
+ * @brief Health check threads priority
+ * @note The pipeline thread has an higher priority than the steps work queue so that timeouts are handled even if a step is busy
+ */
+#define EXAMPLE_HEALTH_CHECK_THREAD_PRIORITY     (K_LOWEST_APPLICATION_THREAD_PRIO - 2)
+#define EXAMPLE_HEALTH_CHECK_WORK_QUEUE_PRIORITY (K_LOWEST_APPLICATION_THREAD_PRIO - 1)
+
+/**
+ * @brief Health check events
+ */
+#define EXAMPLE_HEALTH_CHECK_EVENT_STEP_DONE (1 << 0)
+#define EXAMPLE_HEALTH_CHECK_EVENT_DONE      (1 << 1)
+static K_EVENT_DEFINE(health_check_events);
+
+/**
+ * @brief Health check pipeline thread
+ */
+static K_THREAD_STACK_DEFINE(health_check_thread_stack, CONFIG_EXAMPLE_HEALTH_CHECK_STACK_SIZE);
+static struct k_thread health_check_thread;
+
+/**
+ * @brief Health check steps work queue, used to execute each step with a timeout
+ */
+static K_THREAD_STACK_DEFINE(health_check_work_queue_stack, CONFIG_EXAMPLE_HEALTH_CHECK_STACK_SIZE);
+static struct k_work_q health_check_work_queue;
+static struct k_work   health_check_work;
+
+/**
+ * @brief Health check callbacks
+ */
+static example_health_check_callbacks_t health_check_callbacks;
+
+/**
+ * @brief Health check steps, current step and status
+ */
+static example_health_check_step_t *health_check_steps[CONFIG_EXAMPLE_HEALTH_CHECK_MAX_STEPS];
+static size_t                       health_check_steps_count = 0;
+static example_health_check_step_t *health_check_current_step;
+static mender_err_t                 health_check_step_status;
+static mender_err_t                 health_check_status;
+static bool                         health_check_started = false;
+
+/**
+ * @brief Health check work handler, execute current step
+ * @param work Work item
+ */
+static void
+health_check_work_handler(struct k_work *work) {
+
+    (void)work;
+
+    /* Execute current step */
+    health_check_step_status = health_check_current_step->run();
+    k_event_post(&health_check_events, EXAMPLE_HEALTH_CHECK_EVENT_STEP_DONE);
+}
+
+/**
+ * @brief Health check pipeline thread entry point
+ * @param p1 Not used
+ * @param p2 Not used
+ * @param p3 Not used
+ */
+static void
+health_check_thread_entry(void *p1, void *p2, void *p3) {
+
+    (void)p1;
+    (void)p2;
+    (void)p3;
+    int64_t start = k_uptime_get();
+    int64_t step_start;
+
+    /* Execute each step of the pipeline */
+    health_check_status = MENDER_OK;
+    for (size_t index = 0; (MENDER_OK == health_check_status) && (index < health_check_steps_count); index++) {
+
+        /* Submit step to the work queue and wait for the result */
+        health_check_current_step = health_check_steps[index];
+        step_start                = k_uptime_get();
+        k_event_clear(&health_check_events, EXAMPLE_HEALTH_CHECK_EVENT_STEP_DONE);
+        k_work_submit_to_queue(&health_check_work_queue, &health_check_work);
+        if (0 == k_event_wait(&health_check_events, EXAMPLE_HEALTH_CHECK_EVENT_STEP_DONE, false, K_MSEC(health_check_current_step->timeout))) {
+            LOG_ERR("Health check '%s' timed out after %d ms", health_check_current_step->name, health_check_current_step->timeout);
+            health_check_status = MENDER_FAIL;
+        } else if (MENDER_OK != health_check_step_status) {
+            LOG_ERR("Health check '%s' failed after %d ms", health_check_current_step->name, (int)(k_uptime_get() - step_start));
+            health_check_status = MENDER_FAIL;
+        } else {
+            LOG_INF("Health check '%s' passed in %d ms", health_check_current_step->name, (int)(k_uptime_get() - step_start));
+        }
+    }
+    LOG_INF("Health check pipeline done in %d ms", (int)(k_uptime_get() - start));
+
+    /* Invoke done callback */
+    if (NULL != health_check_callbacks.done) {
+        health_check_callbacks.done(health_check_status);
+    }
+
+    /* Indicate the pipeline is done */
+    k_event_post(&health_check_events, EXAMPLE_HEALTH_CHECK_EVENT_DONE);
+}
+
+mender_err_t
+example_health_check_init(example_health_check_callbacks_t *callbacks) {
+
+    /* Save callbacks */
+    if (NULL != callbacks) {
+        memcpy(&health_check_callbacks, callbacks, sizeof(example_health_check_callbacks_t));
+    }
+
+    /* Start steps work queue */
+    k_work_queue_start(&health_check_work_queue,
+                       health_check_work_queue_stack,
+                       K_THREAD_STACK_SIZEOF(health_check_work_queue_stack),
+                       EXAMPLE_HEALTH_CHECK_WORK_QUEUE_PRIORITY,
+                       NULL);
+    k_thread_name_set(&health_check_work_queue.thread, "health_check_work_queue");
+    k_work_init(&health_check_work, health_check_work_handler);
+
+    return MENDER_OK;
+}
+
+mender_err_t
+example_health_check_register(example_health_check_step_t *step) {
+
+    assert(NULL != step);
+    assert(NULL != step->run);
+
+    /* Check if the pipeline is already started */
+    if (true == health_check_started) {
+        LOG_ERR("Unable to register health check '%s', pipeline is already started", step->name);
+        return MENDER_FAIL;
+    }
+
+    /* Add step to the pipeline */
+    if (health_check_steps_count >= CONFIG_EXAMPLE_HEALTH_CHECK_MAX_STEPS) {
+        LOG_ERR("Unable to register health check '%s', too many steps", step->name);
+        return MENDER_FAIL;
+    }
+    health_check_steps[health_check_steps_count++] = step;
+
+    return MENDER_OK;
+}
+
+mender_err_t
+example_health_check_run(void) {
+
+    /* Check if the pipeline is already started */
+    if (true == health_check_started) {
+        LOG_ERR("Health check pipeline is already started");
+        return MENDER_FAIL;
+    }
+    health_check_started = true;
+
+    /* Start pipeline thread */
+    k_thread_create(&health_check_thread,
+                    health_check_thread_stack,
+                    K_THREAD_STACK_SIZEOF(health_check_thread_stack),
+                    health_check_thread_entry,
+                    NULL,
+                    NULL,
+                    NULL,
+                    EXAMPLE_HEALTH_CHECK_THREAD_PRIORITY,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&health_check_thread, "health_check");
+
+    return MENDER_OK;
+}
+
+mender_err_t
+example_health_check_wait(void) {
+
+    /* Nothing to wait if the pipeline has not been started */
+    if (true != health_check_started) {
+        return MENDER_OK;
+    }
+
+    /* Wait for the pipeline to be done */
+    k_event_wait(&health_check_events, EXAMPLE_HEALTH_CHECK_EVENT_DONE, false, K_FOREVER);
+
+    return health_check_status;
+}
@@ -0,0 +1,256 @@
+/**
+ * @file      example-http.c
+ * @brief     HTTP requests of the mender-mcu-client intercepted by the application
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include "example-http.h"
+
+#if (defined(CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY) && defined(CONFIG_SYS_HEAP_RUNTIME_STATS)) || defined(CONFIG_LLEXT)
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#endif /* (CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY && CONFIG_SYS_HEAP_RUNTIME_STATS) || CONFIG_LLEXT */
+
+#if defined(CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY) && defined(CONFIG_SYS_HEAP_RUNTIME_STATS)
+#include <zephyr/sys/libc-hooks.h>
+#endif /* CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY && CONFIG_SYS_HEAP_RUNTIME_STATS */
+
+#ifdef CONFIG_EXAMPLE_AUTH_CACHE
+#include "example-auth-cache.h"
+#endif /* CONFIG_EXAMPLE_AUTH_CACHE */
+#ifdef CONFIG_EXAMPLE_DOWNLOAD_STREAMS
+#include "example-download-streams.h"
+#endif /* CONFIG_EXAMPLE_DOWNLOAD_STREAMS */
+#ifdef CONFIG_EXAMPLE_LAN_CACHE
+#include "example-lan-cache.h"
+#endif /* CONFIG_EXAMPLE_LAN_CACHE */
+#ifdef CONFIG_LLEXT
+#include "example-llext.h"
+#endif /* CONFIG_LLEXT */
+#ifdef CONFIG_EXAMPLE_PUSH
+#include "example-push.h"
+#endif /* CONFIG_EXAMPLE_PUSH */
+
+#if (defined(CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY) && defined(CONFIG_SYS_HEAP_RUNTIME_STATS)) || defined(CONFIG_LLEXT)
+
+/**
+ * @brief Path of the deployments API, the deployment status is published to the status of the deployment
+ */
+#define EXAMPLE_HTTP_DEPLOYMENTS_PATH "/deployments/device/deployments/"
+
+/**
+ * @brief HTTP callback of the requests done by the dispatcher, the response has no body
+ * @param event Event
+ * @param data Data received
+ * @param data_length Length of the data received
+ * @param params Callback parameters (not used)
+ * @return MENDER_OK
+ */
+static mender_err_t
+http_no_body_cb(mender_http_client_event_t event, void *data, size_t data_length, void *params) {
+
+    (void)event;
+    (void)data;
+    (void)data_length;
+    (void)params;
+
+    return MENDER_OK;
+}
+
+/**
+ * @brief Check if the request publishes a deployment status
+ * @param path Path of the request
+ * @param method Method
+ * @param payload Payload, NULL if no payload
+ * @param value Deployment status, quoted
+ * @return true if the request publishes the deployment status, false otherwise
+ */
+static bool
+http_is_deployment_status(char *path, mender_http_method_t method, char *payload, const char *value) {
+
+    return (MENDER_HTTP_PUT == method) && (NULL != path) && (NULL != payload) && (NULL != strstr(path, EXAMPLE_HTTP_DEPLOYMENTS_PATH))
+           && (NULL != strstr(payload, value));
+}
+
+#endif /* (CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY && CONFIG_SYS_HEAP_RUNTIME_STATS) || CONFIG_LLEXT */
+
+#ifdef CONFIG_LLEXT
+
+/**
+ * @brief Path of the success deployment status deferred until the installation of the LLEXT module is done, empty if no status is deferred
+ */
+static char http_deferred_status_path[128] = "";
+
+/**
+ * @brief Result of the installation of the LLEXT module, -EINPROGRESS until it is retrieved
+ */
+static int http_deferred_status_result = -EINPROGRESS;
+
+/**
+ * @brief Defer the success deployment status while the installation of the LLEXT module is pending, the request is answered at once
+ * @param path Path of the request
+ * @param method Method
+ * @param payload Payload, NULL if no payload
+ * @param status Status code of the response
+ * @return true if the deployment status is deferred, false otherwise
+ */
+static bool
+http_defer_status(char *path, mender_http_method_t method, char *payload, int *status) {
+
+    /* Check if the request is the success deployment status of a deployment installing a LLEXT module */
+    if ((true != http_is_deployment_status(path, method, payload, "\"success\"")) || (true != example_llext_install_pending())
+        || (strlen(path) >= sizeof(http_deferred_status_path))) {
+        return false;
+    }
+
+    /* The deployment status is published once the result of the installation is available */
+    LOG_INF("Deployment status deferred until the installation of the module is done");
+    strcpy(http_deferred_status_path, path);
+    http_deferred_status_result = -EINPROGRESS;
+    *status                     = 204;
+
+    return true;
+}
+
+/**
+ * @brief Publish the deferred deployment status if the result of the installation of the LLEXT module is available
+ * @note The request is done by the thread performing the next request, the mender client is triggered when the result is available
+ * @param jwt Token
+ */
+static void
+http_publish_deferred_status(char *jwt) {
+
+    char payload[32];
+    int  status = 0;
+
+    /* Check if a deployment status is deferred and if the result of the installation is available */
+    if (('\0' == http_deferred_status_path[0]) || (NULL == jwt)) {
+        return;
+    }
+    if ((-EINPROGRESS == http_deferred_status_result) && (-EINPROGRESS == (http_deferred_status_result = example_llext_install_result()))) {
+        return;
+    }
+
+    /* Publish the deployment status, it is published again at the next request if it fails */
+    snprintf(payload, sizeof(payload), "{\"status\":\"%s\"}", (0 == http_deferred_status_result) ? "success" : "failure");
+    if ((MENDER_OK != __real_mender_http_perform(jwt, http_deferred_status_path, MENDER_HTTP_PUT, payload, NULL, http_no_body_cb, NULL, &status))
+        || ((204 != status) && (409 != status))) {
+        LOG_ERR("Unable to publish the deferred deployment status (status=%d)", status);
+        return;
+    }
+    LOG_INF("Deferred deployment status published");
+    http_deferred_status_path[0] = '\0';
+}
+
+#endif /* CONFIG_LLEXT */
+
+#if defined(CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY) && defined(CONFIG_SYS_HEAP_RUNTIME_STATS)
+
+/**
+ * @brief Path of the device attributes of the inventory API
+ */
+#define EXAMPLE_HTTP_INVENTORY_PATH "/api/devices/v1/inventory/device/attributes"
+
+/**
+ * @brief Publish the peak usage of the heap in the inventory before the rebooting deployment status is published
+ * @note The request is done synchronously by the thread publishing the status, the peak usage of the deployment is lost after the reboot
+ * @param jwt Token
+ * @param path Path of the request
+ * @param method Method
+ * @param payload Payload, NULL if no payload
+ */
+static void
+http_publish_heap_peak(char *jwt, char *path, mender_http_method_t method, char *payload) {
+
+    struct sys_memory_stats heap_stats;
+    char                    attributes[64];
+    int                     status = 0;
+
+    /* Check if the request is the rebooting deployment status */
+    if ((NULL == jwt) || (true != http_is_deployment_status(path, method, payload, "\"rebooting\""))) {
+        return;
+    }
+
+    /* Update the heap-peak-bytes attribute, the other attributes are kept */
+    if (0 != malloc_runtime_stats_get(&heap_stats)) {
+        return;
+    }
+    snprintf(attributes, sizeof(attributes), "[{\"name\":\"heap-peak-bytes\",\"value\":\"%u\"}]", (uint32_t)heap_stats.max_allocated_bytes);
+    if ((MENDER_OK != __real_mender_http_perform(jwt, EXAMPLE_HTTP_INVENTORY_PATH, MENDER_HTTP_PATCH, attributes, NULL, http_no_body_cb, NULL, &status))
+        || (200 != status)) {
+        LOG_ERR("Unable to publish the peak usage of the heap (status=%d)", status);
+    }
+}
+
+#endif /* CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY && CONFIG_SYS_HEAP_RUNTIME_STATS */
+
+mender_err_t
+__wrap_mender_http_perform(char                *jwt,
+                           char                *path,
+                           mender_http_method_t method,
+                           char                *payload,
+                           char                *signature,
+                           mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *),
+                           void *params,
+                           int  *status) {
+
+#ifdef CONFIG_EXAMPLE_PUSH
+    /* The token of the device authenticates the push channel */
+    if (NULL != jwt) {
+        example_push_set_token(jwt);
+    }
+#endif /* CONFIG_EXAMPLE_PUSH */
+
+#ifdef CONFIG_LLEXT
+    /* The success deployment status is deferred until the installation of the LLEXT module is done, it is published before the next request */
+    if (true == http_defer_status(path, method, payload, status)) {
+        return MENDER_OK;
+    }
+    http_publish_deferred_status(jwt);
+#endif /* CONFIG_LLEXT */
+
+#if defined(CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY) && defined(CONFIG_SYS_HEAP_RUNTIME_STATS)
+    /* The peak usage of the heap during the deployment is published before the device reboots */
+    http_publish_heap_peak(jwt, path, method, payload);
+#endif /* CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY && CONFIG_SYS_HEAP_RUNTIME_STATS */
+
+#ifdef CONFIG_EXAMPLE_LAN_CACHE
+    mender_err_t ret;
+
+    /* Download of the artifact from the cache of the local network, the server is used if the artifact is not available in the cache */
+    if ((true == example_lan_cache_match(jwt, path, method)) && (true == example_lan_cache_perform(path, callback, params, status, &ret))) {
+        return ret;
+    }
+#endif /* CONFIG_EXAMPLE_LAN_CACHE */
+
+#ifdef CONFIG_EXAMPLE_DOWNLOAD_STREAMS
+    /* Download of the artifact using parallel streams */
+    if (true == example_download_streams_match(jwt, path, method)) {
+        return example_download_streams_perform(path, callback, params, status);
+    }
+#endif /* CONFIG_EXAMPLE_DOWNLOAD_STREAMS */
+
+#ifdef CONFIG_EXAMPLE_AUTH_CACHE
+    /* Authentication request answered with the cached token, and other requests */
+    return example_auth_cache_http_perform(jwt, path, method, payload, signature, callback, params, status);
+#else
+    return __real_mender_http_perform(jwt, path, method, payload, signature, callback, params, status);
+#endif /* CONFIG_EXAMPLE_AUTH_CACHE */
+}
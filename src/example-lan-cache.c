@@ -0,0 +1,333 @@
+/**
+ * @file      example-lan-cache.c
+ * @brief     Download of the artifacts from a cache of the local network
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/client.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/tls_credentials.h>
+
+#include "example-http.h"
+#include "example-lan-cache.h"
+
+/**
+ * @brief Paths of the cache API, the URL of the artifact on the server is given as query parameter
+ * @note The probe answers 200 when the artifact is available in the cache, it is fetched from the server by the cache if it is not already available
+ */
+#define EXAMPLE_LAN_CACHE_PROBE_PATH    "/probe?url="
+#define EXAMPLE_LAN_CACHE_ARTIFACT_PATH "/artifact?url="
+
+/**
+ * @brief Timeout of the receptions of the download from the cache
+ */
+#define EXAMPLE_LAN_CACHE_TIMEOUT (30000)
+
+/**
+ * @brief Size of the reception buffer of the HTTP client
+ */
+#define EXAMPLE_LAN_CACHE_RECV_BUFFER_SIZE (512)
+
+/**
+ * @brief Maximum length of the host name and of the port of the URL of the cache
+ */
+#define EXAMPLE_LAN_CACHE_HOST_SIZE (64)
+#define EXAMPLE_LAN_CACHE_PORT_SIZE (6)
+
+/**
+ * @brief Download context, events are given to the original callback once the cache starts sending the artifact
+ */
+typedef struct {
+    mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *); /**< Original callback */
+    void        *params;                                                          /**< Original callback parameters */
+    int          sock;                                                            /**< Socket of the download */
+    uint16_t     http_status;                                                     /**< Status code of the response */
+    bool         connected;                                                       /**< Connected event given to the original callback */
+    size_t       received;                                                        /**< Length of the data given to the original callback */
+    mender_err_t ret;                                                             /**< Result of the original callback */
+} example_lan_cache_http_ctx_t;
+
+/**
+ * @brief Build the URL of a request to the cache
+ * @param path Path of the cache API
+ * @param url URL of the artifact on the server, percent-encoded in the query
+ * @return URL of the request if the function succeeds, NULL otherwise
+ */
+static char *
+lan_cache_url(const char *path, const char *url) {
+
+    char  *result;
+    size_t length = strlen(CONFIG_EXAMPLE_LAN_CACHE_URL) + strlen(path);
+
+    /* Allocate the URL, reserved characters are encoded with 3 characters */
+    if (NULL == (result = malloc(length + 3 * strlen(url) + 1))) {
+        LOG_ERR("Unable to allocate memory");
+        return NULL;
+    }
+    sprintf(result, "%s%s", CONFIG_EXAMPLE_LAN_CACHE_URL, path);
+
+    /* Encode the URL of the artifact */
+    for (const char *c = url; '\0' != *c; c++) {
+        if (((*c >= 'a') && (*c <= 'z')) || ((*c >= 'A') && (*c <= 'Z')) || ((*c >= '0') && (*c <= '9')) || (NULL != strchr("-._~", *c))) {
+            result[length++] = *c;
+        } else {
+            length += sprintf(&result[length], "%%%02X", (uint8_t)*c);
+        }
+    }
+    result[length] = '\0';
+
+    return result;
+}
+
+/**
+ * @brief HTTP callback of the probe, the response is ignored
+ * @param event Event
+ * @param data Data received
+ * @param data_length Length of the data received
+ * @param params Not used
+ * @return MENDER_OK
+ */
+static mender_err_t
+lan_cache_probe_cb(mender_http_client_event_t event, void *data, size_t data_length, void *params) {
+
+    (void)event;
+    (void)data;
+    (void)data_length;
+    (void)params;
+
+    return MENDER_OK;
+}
+
+/**
+ * @brief Stop the download when the original callback fails, the socket is closed by the thread running the HTTP client, which then fails at once
+ * @note Shutting down the reception does not stop a TLS socket, the whole artifact would be received from the cache before the failure is reported
+ * @param ctx Download context
+ */
+static void
+lan_cache_abort(example_lan_cache_http_ctx_t *ctx) {
+
+    zsock_close(ctx->sock);
+    ctx->sock = -1;
+}
+
+/**
+ * @brief HTTP response callback of the download, the body is given to the original callback only if the status is 200
+ * @note The connected event is given to the original callback when the first data is received, so that nothing is given to the original
+ * callback if the cache fails before sending the artifact and it can be downloaded from the server
+ * @param rsp HTTP response
+ * @param final_data Indicates if the response is complete
+ * @param user_data Download context
+ */
+static void
+lan_cache_response_cb(struct http_response *rsp, enum http_final_call final_data, void *user_data) {
+
+    (void)final_data;
+    example_lan_cache_http_ctx_t *ctx = (example_lan_cache_http_ctx_t *)user_data;
+
+    /* The body of an error is dropped */
+    ctx->http_status = rsp->http_status_code;
+    if ((200 != ctx->http_status) || (MENDER_OK != ctx->ret) || (NULL == rsp->body_frag_start) || (0 == rsp->body_frag_len)) {
+        return;
+    }
+
+    /* Give the data to the original callback */
+    if (true != ctx->connected) {
+        if (MENDER_OK != (ctx->ret = ctx->callback(MENDER_HTTP_EVENT_CONNECTED, NULL, 0, ctx->params))) {
+            lan_cache_abort(ctx);
+            return;
+        }
+        ctx->connected = true;
+    }
+    ctx->received += rsp->body_frag_len;
+    if (MENDER_OK != (ctx->ret = ctx->callback(MENDER_HTTP_EVENT_DATA_RECEIVED, rsp->body_frag_start, rsp->body_frag_len, ctx->params))) {
+        lan_cache_abort(ctx);
+    }
+}
+
+/**
+ * @brief Download the artifact from the cache
+ * @param url URL of the request to the cache
+ * @param ctx Download context
+ * @return 0 if the response is received, error code otherwise
+ */
+static int
+lan_cache_download(const char *url, example_lan_cache_http_ctx_t *ctx) {
+
+    struct zsock_addrinfo  hints       = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct zsock_addrinfo *addr        = NULL;
+    struct zsock_timeval   timeout     = { .tv_sec = EXAMPLE_LAN_CACHE_TIMEOUT / 1000, .tv_usec = 0 };
+    sec_tag_t              sec_tag[]   = { CONFIG_MENDER_NET_CA_CERTIFICATE_TAG };
+    uint8_t               *recv_buffer = NULL;
+    char                   host[EXAMPLE_LAN_CACHE_HOST_SIZE];
+    char                   port[EXAMPLE_LAN_CACHE_PORT_SIZE];
+    const char            *path;
+    const char            *end;
+    const char            *colon;
+    struct http_request    req;
+    bool                   secure;
+    int                    result = 0;
+
+    /* Parse URL */
+    ctx->sock = -1;
+    if (0 == strncmp(url, "https://", strlen("https://"))) {
+        secure = true;
+        url += strlen("https://");
+        strcpy(port, "443");
+    } else if (0 == strncmp(url, "http://", strlen("http://"))) {
+        secure = false;
+        url += strlen("http://");
+        strcpy(port, "80");
+    } else {
+        return -EINVAL;
+    }
+    if (NULL == (path = strchr(url, '/'))) {
+        return -EINVAL;
+    }
+    if (NULL == (colon = memchr(url, ':', path - url))) {
+        end = path;
+    } else if ((size_t)(path - colon - 1) >= EXAMPLE_LAN_CACHE_PORT_SIZE) {
+        return -EINVAL;
+    } else {
+        end = colon;
+        memcpy(port, colon + 1, path - colon - 1);
+        port[path - colon - 1] = '\0';
+    }
+    if ((size_t)(end - url) >= EXAMPLE_LAN_CACHE_HOST_SIZE) {
+        return -ENAMETOOLONG;
+    }
+    memcpy(host, url, end - url);
+    host[end - url] = '\0';
+
+    /* Resolve host */
+    if (0 != zsock_getaddrinfo(host, port, &hints, &addr)) {
+        return -EHOSTUNREACH;
+    }
+    if (NULL == (recv_buffer = malloc(EXAMPLE_LAN_CACHE_RECV_BUFFER_SIZE))) {
+        result = -ENOMEM;
+        goto END;
+    }
+
+    /* Connect, TLS is handled by the sockets */
+    if ((ctx->sock = zsock_socket(addr->ai_family, SOCK_STREAM, secure ? IPPROTO_TLS_1_2 : IPPROTO_TCP)) < 0) {
+        result = -errno;
+        goto END;
+    }
+    if ((true == secure)
+        && ((zsock_setsockopt(ctx->sock, SOL_TLS, TLS_SEC_TAG_LIST, sec_tag, sizeof(sec_tag)) < 0)
+            || (zsock_setsockopt(ctx->sock, SOL_TLS, TLS_HOSTNAME, host, strlen(host) + 1) < 0))) {
+        result = -errno;
+        goto END;
+    }
+    if ((zsock_setsockopt(ctx->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+        || (zsock_connect(ctx->sock, addr->ai_addr, addr->ai_addrlen) < 0)) {
+        result = -errno;
+        goto END;
+    }
+
+    /* Perform request */
+    memset(&req, 0, sizeof(struct http_request));
+    req.method       = HTTP_GET;
+    req.url          = path;
+    req.host         = host;
+    req.port         = (NULL != colon) ? port : NULL;
+    req.protocol     = "HTTP/1.1";
+    req.response     = lan_cache_response_cb;
+    req.recv_buf     = recv_buffer;
+    req.recv_buf_len = EXAMPLE_LAN_CACHE_RECV_BUFFER_SIZE;
+    if ((result = http_client_req(ctx->sock, &req, SYS_FOREVER_MS, ctx)) >= 0) {
+        result = 0;
+    }
+
+END:
+
+    /* Release memory */
+    if (ctx->sock >= 0) {
+        zsock_close(ctx->sock);
+        ctx->sock = -1;
+    }
+    free(recv_buffer);
+    zsock_freeaddrinfo(addr);
+
+    return result;
+}
+
+bool
+example_lan_cache_match(char *jwt, char *path, mender_http_method_t method) {
+
+    /* The artifact is downloaded without token using its full URL */
+    return ('\0' != CONFIG_EXAMPLE_LAN_CACHE_URL[0]) && (NULL == jwt) && (MENDER_HTTP_GET == method) && (NULL != path)
+           && (0 == strncmp(path, "http", strlen("http")));
+}
+
+bool
+example_lan_cache_perform(char *url,
+                          mender_err_t (*callback)(mender_http_client_event_t, void *, size_t, void *),
+                          void         *params,
+                          int          *status,
+                          mender_err_t *ret) {
+
+    example_lan_cache_http_ctx_t ctx
+        = { .callback = callback, .params = params, .sock = -1, .http_status = 0, .connected = false, .received = 0, .ret = MENDER_OK };
+    char *probe  = NULL;
+    char *cached = NULL;
+    bool  served = false;
+    int   result;
+
+    /* Build the URLs of the requests to the cache */
+    if ((NULL == (probe = lan_cache_url(EXAMPLE_LAN_CACHE_PROBE_PATH, url))) || (NULL == (cached = lan_cache_url(EXAMPLE_LAN_CACHE_ARTIFACT_PATH, url)))) {
+        goto END;
+    }
+
+    /* Check if the artifact is available in the cache */
+    if ((MENDER_OK != __real_mender_http_perform(NULL, probe, MENDER_HTTP_GET, NULL, NULL, lan_cache_probe_cb, NULL, status)) || (200 != *status)) {
+        LOG_WRN("Artifact not available in the cache, downloading from the server");
+        goto END;
+    }
+
+    /* Download the artifact from the cache, only the body of a successful response is given to the mender-mcu-client */
+    result = lan_cache_download(cached, &ctx);
+    if ((0 == result) && (MENDER_OK == ctx.ret) && (200 == ctx.http_status) && (0 != ctx.received)) {
+        LOG_INF("Artifact downloaded from the cache, %u bytes", (uint32_t)ctx.received);
+        *status = 200;
+        *ret    = callback(MENDER_HTTP_EVENT_DISCONNECTED, NULL, 0, params);
+        served  = true;
+    } else if (true == ctx.connected) {
+        /* The artifact is partially processed, it is not possible to restart the download from the server */
+        LOG_ERR("Unable to download the artifact from the cache after %u bytes (%d)", (uint32_t)ctx.received, result);
+        callback(MENDER_HTTP_EVENT_ERROR, NULL, 0, params);
+        *status = ctx.http_status;
+        *ret    = (MENDER_OK != ctx.ret) ? ctx.ret : MENDER_FAIL;
+        served  = true;
+    } else {
+        LOG_WRN("Unable to download the artifact from the cache (%d, status %u), downloading from the server", result, ctx.http_status);
+    }
+
+END:
+
+    /* Release memory */
+    free(probe);
+    free(cached);
+
+    return served;
+}
@@ -0,0 +1,919 @@
+/**
+ * @file      example-llext.c
+ * @brief     LLEXT modules manager, modules are installed on a dedicated work queue
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/llext/llext.h>
+#include <zephyr/llext/buf_loader.h>
+
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif /* CONFIG_SHELL */
+
+#include "example-llext.h"
+#include "mender-client.h"
+
+#ifdef CONFIG_EXAMPLE_TRACE
+#include "example-trace.h"
+#endif /* CONFIG_EXAMPLE_TRACE */
+
+/**
+ * @brief Install work queue priority, lower than the mender client so that the status reports are not delayed by the modules
+ */
+#define EXAMPLE_LLEXT_WORK_QUEUE_PRIORITY (K_LOWEST_APPLICATION_THREAD_PRIO)
+
+#ifdef CONFIG_EXAMPLE_LLEXT_BENCH
+
+/**
+ * @brief Number of lookups of the benchmark, and maximum size of the names of the symbols of the benchmark
+ */
+#define EXAMPLE_LLEXT_BENCH_LOOKUPS   (1000)
+#define EXAMPLE_LLEXT_BENCH_NAME_SIZE (16)
+
+#endif /* CONFIG_EXAMPLE_LLEXT_BENCH */
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_EXAMPLE_LLEXT_SYMBOL_INDEX_SIZE), "Size of the symbol index must be a power of two");
+
+/**
+ * @brief Resident module
+ */
+typedef struct {
+    char          name[LLEXT_MAX_NAME_LEN + 1]; /**< Name of the module, empty if the slot is free */
+    struct llext *ext;                          /**< Extension, its name is the name of the module with a suffix alternating when it is replaced */
+    void         *data;                         /**< Module data, kept while the module is resident when the sections are used in place */
+    uint32_t      generation;                   /**< Number of times the module has been loaded */
+    uint32_t      refs[2];                      /**< References of the extensions taken by example_llext_find_sym, indexed by the parity of the generation */
+} example_llext_module_t;
+
+/**
+ * @brief Resident modules, symbol index and their lock, and the condition signaled when a reference is released
+ */
+static K_MUTEX_DEFINE(llext_modules_lock);
+static K_CONDVAR_DEFINE(llext_modules_released);
+static example_llext_module_t      llext_modules[CONFIG_EXAMPLE_LLEXT_MAX_MODULES];
+static example_llext_index_entry_t llext_index_entries[CONFIG_EXAMPLE_LLEXT_SYMBOL_INDEX_SIZE];
+static example_llext_index_t       llext_index = { .entries = llext_index_entries, .size = CONFIG_EXAMPLE_LLEXT_SYMBOL_INDEX_SIZE, .count = 0 };
+
+/**
+ * @brief Lock serializing the loads and the unloads, the modules lock is released while the references are waited
+ */
+static K_MUTEX_DEFINE(llext_update_lock);
+
+/**
+ * @brief Installation context
+ */
+typedef struct {
+    const char *name;         /**< Name of the module */
+    const char *symbol;       /**< Name of the initialization function of the module */
+    void       *data;         /**< Module data, NULL when it is released */
+    size_t      size;         /**< Module size */
+    bool        pending;      /**< Installation submitted and its result not retrieved yet */
+    bool        cancelled;    /**< Installation cancelled while it is running, the module is unloaded when it is done */
+    bool        initializing; /**< Initialization function of the module running on the work queue */
+    void       *ref;          /**< Reference of the module taken while the initialization function is running */
+    int         result;       /**< Result of the installation, 0 if the module is installed, -EINPROGRESS until it is done */
+    int64_t     submitted;    /**< Uptime when the installation is submitted */
+    uint64_t    timestamp;    /**< Timestamp when the installation is submitted, used by the timing instrumentation */
+} example_llext_ctx_t;
+
+/**
+ * @brief Installation context and its lock, only one module is installed at a time
+ */
+static K_MUTEX_DEFINE(llext_lock);
+static example_llext_ctx_t llext_ctx;
+
+/**
+ * @brief Install work queue
+ */
+static K_THREAD_STACK_DEFINE(llext_work_queue_stack, CONFIG_EXAMPLE_LLEXT_WORK_QUEUE_STACK_SIZE);
+static struct k_work_q llext_work_queue;
+static struct k_work   llext_install_work;
+
+/**
+ * @brief Timeout of the installation, run on the system work queue because the install work queue may be blocked by the module
+ */
+static void llext_install_timeout_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(llext_install_timeout_work, llext_install_timeout_work_handler);
+
+/**
+ * @brief Compute the hash of the name of a symbol, FNV-1a
+ * @param name Name of the symbol
+ * @return Hash
+ */
+static uint32_t
+llext_index_hash(const char *name) {
+
+    uint32_t hash = 2166136261u;
+
+    while ('\0' != *name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+void
+example_llext_index_clear(example_llext_index_t *index) {
+
+    memset(index->entries, 0, index->size * sizeof(example_llext_index_entry_t));
+    index->count = 0;
+}
+
+int
+example_llext_index_add(example_llext_index_t *index, const struct llext_symtable *table, void *owner) {
+
+    uint32_t hash;
+    size_t   position;
+
+    /* Keep at least one free entry so that the lookup of an unknown symbol always ends */
+    if (index->count + table->sym_cnt >= index->size) {
+        return -ENOSPC;
+    }
+
+    /* Insert symbols with linear probing */
+    for (size_t sym = 0; sym < table->sym_cnt; sym++) {
+        hash     = llext_index_hash(table->syms[sym].name);
+        position = hash & (index->size - 1);
+        while (NULL != index->entries[position].name) {
+            if ((hash == index->entries[position].hash) && (0 == strcmp(table->syms[sym].name, index->entries[position].name))) {
+                return -EEXIST;
+            }
+            position = (position + 1) & (index->size - 1);
+        }
+        index->entries[position].hash  = hash;
+        index->entries[position].name  = table->syms[sym].name;
+        index->entries[position].addr  = table->syms[sym].addr;
+        index->entries[position].owner = owner;
+        index->count++;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Find the entry of a symbol in the symbol index
+ * @param index Symbol index
+ * @param name Name of the symbol
+ * @return Entry of the symbol, NULL if it is not found
+ */
+static const example_llext_index_entry_t *
+llext_index_lookup(const example_llext_index_t *index, const char *name) {
+
+    uint32_t hash     = llext_index_hash(name);
+    size_t   position = hash & (index->size - 1);
+
+    /* Probe until the symbol or a free entry is found */
+    while (NULL != index->entries[position].name) {
+        if ((hash == index->entries[position].hash) && (0 == strcmp(name, index->entries[position].name))) {
+            return &index->entries[position];
+        }
+        position = (position + 1) & (index->size - 1);
+    }
+
+    return NULL;
+}
+
+const void *
+example_llext_index_find(const example_llext_index_t *index, const char *name) {
+
+    const example_llext_index_entry_t *entry = llext_index_lookup(index, name);
+
+    return (NULL != entry) ? entry->addr : NULL;
+}
+
+/**
+ * @brief Rebuild the symbol index from the export tables of the resident modules
+ * @note The index is rebuilt when a module is loaded, replaced or unloaded, which is rare compared to the lookups
+ * @param skip Module which symbols are not added, NULL to add all the resident modules
+ * @param ext New extension of the module skipped which symbols are added in addition to the resident modules, NULL if none
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+llext_index_rebuild(example_llext_module_t *skip, struct llext *ext) {
+
+    int result = 0;
+
+    example_llext_index_clear(&llext_index);
+    for (size_t index = 0; (0 == result) && (index < CONFIG_EXAMPLE_LLEXT_MAX_MODULES); index++) {
+        if ((&llext_modules[index] != skip) && (NULL != llext_modules[index].ext)) {
+            result = example_llext_index_add(
+                &llext_index, &llext_modules[index].ext->exp_tab, &llext_modules[index].refs[(llext_modules[index].generation - 1) & 1]);
+        }
+    }
+    if ((0 == result) && (NULL != ext)) {
+        result = example_llext_index_add(&llext_index, &ext->exp_tab, &skip->refs[skip->generation & 1]);
+    }
+
+    return result;
+}
+
+/**
+ * @brief Find a resident module
+ * @param name Name of the module
+ * @return Module, NULL if it is not found
+ */
+static example_llext_module_t *
+llext_module_find(const char *name) {
+
+    for (size_t index = 0; index < CONFIG_EXAMPLE_LLEXT_MAX_MODULES; index++) {
+        if ((NULL != llext_modules[index].ext) && (0 == strcmp(name, llext_modules[index].name))) {
+            return &llext_modules[index];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Release a module, unload the extension and release the module data
+ * @note The symbols of the module must be removed from the index before, the function waits for their references to be released
+ * @param module Module
+ */
+static void
+llext_module_release(example_llext_module_t *module) {
+
+    uint32_t *refs = &module->refs[(module->generation - 1) & 1];
+
+    /* Wait for the callers of the functions of the extension */
+    while (0 != *refs) {
+        k_condvar_wait(&llext_modules_released, &llext_modules_lock, K_FOREVER);
+    }
+    llext_unload(&module->ext);
+    module->ext = NULL;
+    free(module->data);
+    module->data = NULL;
+}
+
+mender_err_t
+example_llext_load(const char *name, void *data, size_t size) {
+
+    struct llext_buf_loader buf_loader = LLEXT_BUF_LOADER(data, size);
+    struct llext_load_param ldr_parm   = LLEXT_LOAD_PARAM_DEFAULT;
+    struct llext           *ext        = NULL;
+    example_llext_module_t *module;
+    char                    ext_name[LLEXT_MAX_NAME_LEN + 1];
+    mender_err_t            ret = MENDER_OK;
+    int                     result;
+
+    if (strlen(name) > LLEXT_MAX_NAME_LEN) {
+        LOG_ERR("Name of module '%s' is too long", name);
+        free(data);
+        return MENDER_FAIL;
+    }
+
+    k_mutex_lock(&llext_update_lock, K_FOREVER);
+    k_mutex_lock(&llext_modules_lock, K_FOREVER);
+
+    /* Replace the resident module with the same name, or use a free slot */
+    if (NULL == (module = llext_module_find(name))) {
+        for (size_t index = 0; (NULL == module) && (index < CONFIG_EXAMPLE_LLEXT_MAX_MODULES); index++) {
+            if (NULL == llext_modules[index].ext) {
+                module             = &llext_modules[index];
+                module->generation = 0;
+            }
+        }
+        if (NULL == module) {
+            LOG_ERR("Unable to load module '%s', %d modules are already resident", name, CONFIG_EXAMPLE_LLEXT_MAX_MODULES);
+            free(data);
+            ret = MENDER_FAIL;
+            goto END;
+        }
+    }
+
+    /* Load the new extension while the previous one is still resident, the extensions are registered with different names */
+    if (strlen(name) > LLEXT_MAX_NAME_LEN - 2) {
+        LOG_WRN("Name of module '%s' is truncated to '%.*s' to name its extension", name, LLEXT_MAX_NAME_LEN - 2, name);
+    }
+    snprintf(ext_name, sizeof(ext_name), "%.*s#%u", LLEXT_MAX_NAME_LEN - 2, name, (unsigned int)(module->generation & 1));
+    if (NULL != llext_by_name(ext_name)) {
+        LOG_ERR("Unable to load module '%s', extension '%s' is already loaded", name, ext_name);
+        free(data);
+        ret = MENDER_FAIL;
+        goto END;
+    }
+    if (0 != (result = llext_load(&buf_loader.loader, ext_name, &ext, &ldr_parm))) {
+        LOG_ERR("Unable to load module '%s' (%d)", name, result);
+        free(data);
+        ret = MENDER_FAIL;
+        goto END;
+    }
+
+    /* Index the symbols of the other modules and of the new extension, the previous index is restored if it fails */
+    if (0 != (result = llext_index_rebuild(module, ext))) {
+        LOG_ERR("Unable to index the symbols of module '%s' (%d)", name, result);
+        llext_unload(&ext);
+        free(data);
+        llext_index_rebuild(NULL, NULL);
+        ret = MENDER_FAIL;
+        goto END;
+    }
+
+    /* Release the previous extension once its references are released, and keep the new one */
+    if (NULL != module->ext) {
+        llext_module_release(module);
+    }
+    strcpy(module->name, name);
+    module->ext = ext;
+    module->generation++;
+#ifdef CONFIG_LLEXT_STORAGE_WRITABLE
+    module->data = data;
+#else
+    /* The sections are copied to the LLEXT heap, module data is no longer used */
+    free(data);
+#endif /* CONFIG_LLEXT_STORAGE_WRITABLE */
+    LOG_INF("Module '%s' loaded, %u symbols exported, %u symbols in the index", name, (uint32_t)ext->exp_tab.sym_cnt, (uint32_t)llext_index.count);
+
+END:
+
+    k_mutex_unlock(&llext_modules_lock);
+    k_mutex_unlock(&llext_update_lock);
+
+    return ret;
+}
+
+mender_err_t
+example_llext_unload(const char *name) {
+
+    example_llext_module_t *module;
+    mender_err_t            ret = MENDER_OK;
+
+    k_mutex_lock(&llext_update_lock, K_FOREVER);
+    k_mutex_lock(&llext_modules_lock, K_FOREVER);
+
+    /* Remove the symbols of the module and release it once its references are released */
+    if (NULL == (module = llext_module_find(name))) {
+        LOG_ERR("Module '%s' is not resident", name);
+        ret = MENDER_FAIL;
+    } else {
+        llext_index_rebuild(module, NULL);
+        llext_module_release(module);
+        module->name[0] = '\0';
+    }
+
+    k_mutex_unlock(&llext_modules_lock);
+    k_mutex_unlock(&llext_update_lock);
+
+    return ret;
+}
+
+const void *
+example_llext_find_sym(const char *name, void **ref) {
+
+    const example_llext_index_entry_t *entry;
+    const void                        *addr = NULL;
+
+    k_mutex_lock(&llext_modules_lock, K_FOREVER);
+    if (NULL != (entry = llext_index_lookup(&llext_index, name))) {
+        (*(uint32_t *)entry->owner)++;
+        *ref = entry->owner;
+        addr = entry->addr;
+    }
+    k_mutex_unlock(&llext_modules_lock);
+
+    return addr;
+}
+
+void
+example_llext_release(void *ref) {
+
+    k_mutex_lock(&llext_modules_lock, K_FOREVER);
+    (*(uint32_t *)ref)--;
+    k_condvar_broadcast(&llext_modules_released);
+    k_mutex_unlock(&llext_modules_lock);
+}
+
+/**
+ * @brief Check if the installation has been cancelled
+ * @return true if the installation has been cancelled, false otherwise
+ */
+static bool
+llext_install_cancelled(void) {
+
+    bool cancelled;
+
+    k_mutex_lock(&llext_lock, K_FOREVER);
+    cancelled = llext_ctx.cancelled;
+    k_mutex_unlock(&llext_lock);
+
+    return cancelled;
+}
+
+/**
+ * @brief Cancel the installation, the module data is released if it is not started, else the module is unloaded when it is done
+ * @note The installation lock must be taken by the caller
+ */
+static void
+llext_install_cancel(void) {
+
+    if (0 == k_work_cancel(&llext_install_work)) {
+        free(llext_ctx.data);
+        llext_ctx.data   = NULL;
+        llext_ctx.size   = 0;
+        llext_ctx.result = -ECANCELED;
+    } else {
+        llext_ctx.cancelled = true;
+    }
+}
+
+/**
+ * @brief Notify the mender client that the result of the installation is available, the deployment status is published at once
+ */
+static void
+llext_install_notify(void) {
+
+    if (MENDER_OK != mender_client_execute()) {
+        LOG_ERR("Unable to trigger the publication of the deployment status");
+    }
+}
+
+/**
+ * @brief Install work handler, load the module with the module manager and call its initialization function
+ * @param work Work item
+ */
+static void
+llext_install_work_handler(struct k_work *work) {
+
+    (void)work;
+    void (*init_fn)(void) = NULL;
+    int64_t     begin     = k_uptime_get();
+    int64_t     loaded    = begin;
+    int64_t     end;
+    int64_t     submitted;
+    const char *name;
+    const char *symbol;
+    void       *data;
+    void       *ref;
+    size_t      size;
+    bool        resident = false;
+    bool        notify;
+    int         result = 0;
+#ifdef CONFIG_EXAMPLE_TRACE
+    uint64_t timestamp = example_trace_timestamp();
+#endif /* CONFIG_EXAMPLE_TRACE */
+
+    /* Retrieve the installation, the module data is given to the module manager */
+    k_mutex_lock(&llext_lock, K_FOREVER);
+    name           = llext_ctx.name;
+    symbol         = llext_ctx.symbol;
+    data           = llext_ctx.data;
+    size           = llext_ctx.size;
+    submitted      = llext_ctx.submitted;
+    llext_ctx.data = NULL;
+#ifdef CONFIG_EXAMPLE_TRACE
+    example_trace_record(EXAMPLE_TRACE_PHASE_LLEXT_QUEUE, llext_ctx.timestamp);
+#endif /* CONFIG_EXAMPLE_TRACE */
+    k_mutex_unlock(&llext_lock);
+
+    /* Load module, the resident module with the same name is replaced */
+    if (MENDER_OK != example_llext_load(name, data, size)) {
+        result = -EIO;
+    } else {
+        resident = true;
+        loaded   = k_uptime_get();
+#ifdef CONFIG_EXAMPLE_TRACE
+        example_trace_record(EXAMPLE_TRACE_PHASE_LLEXT_LOAD, timestamp);
+        timestamp = example_trace_timestamp();
+#endif /* CONFIG_EXAMPLE_TRACE */
+
+        /* Call initialization function, unless the installation has been cancelled while the module was loaded */
+        if (true == llext_install_cancelled()) {
+            result = -ECANCELED;
+        } else if (NULL == (init_fn = (void (*)(void))example_llext_find_sym(symbol, &ref))) {
+            LOG_ERR("Unable to find symbol '%s' in module '%s'", symbol, name);
+            result = -ENOENT;
+        } else {
+            /* The reference is saved so that the module can be unloaded if the initialization function never returns */
+            k_mutex_lock(&llext_lock, K_FOREVER);
+            llext_ctx.ref          = ref;
+            llext_ctx.initializing = true;
+            k_mutex_unlock(&llext_lock);
+            init_fn();
+            k_mutex_lock(&llext_lock, K_FOREVER);
+            llext_ctx.initializing = false;
+            k_mutex_unlock(&llext_lock);
+            example_llext_release(ref);
+#ifdef CONFIG_EXAMPLE_TRACE
+            example_trace_record(EXAMPLE_TRACE_PHASE_LLEXT_INIT, timestamp);
+#endif /* CONFIG_EXAMPLE_TRACE */
+        }
+    }
+    end = k_uptime_get();
+
+    /* Signal completion if the module is installed and if the installation has not been cancelled meanwhile */
+    k_mutex_lock(&llext_lock, K_FOREVER);
+    if ((0 == result) && (true == llext_ctx.cancelled)) {
+        result = -ECANCELED;
+    }
+    if (0 == result) {
+        LOG_INF("Module '%s' installed, queued for %u ms, loaded in %u ms, initialized in %u ms",
+                name,
+                (uint32_t)(begin - submitted),
+                (uint32_t)(loaded - begin),
+                (uint32_t)(end - loaded));
+        llext_ctx.size   = 0;
+        llext_ctx.result = 0;
+    }
+    k_mutex_unlock(&llext_lock);
+
+    /* Else unload the module, the deployment is reported as failed */
+    if (0 != result) {
+        if (true == resident) {
+            LOG_WRN("Installation of module '%s' failed (%d), unloading it", name, result);
+            example_llext_unload(name);
+        }
+        k_mutex_lock(&llext_lock, K_FOREVER);
+        llext_ctx.size   = 0;
+        llext_ctx.result = result;
+        k_mutex_unlock(&llext_lock);
+    }
+
+    /* The deployment status is published once the result is available */
+    k_work_cancel_delayable(&llext_install_timeout_work);
+    k_mutex_lock(&llext_lock, K_FOREVER);
+    notify = llext_ctx.pending;
+    k_mutex_unlock(&llext_lock);
+    if (true == notify) {
+        llext_install_notify();
+    }
+}
+
+/**
+ * @brief Start the install work queue
+ * @note The work queue and the work item are cleared first because they remain flagged as started and running when the thread is aborted
+ */
+static void
+llext_work_queue_start(void) {
+
+    memset(&llext_work_queue, 0, sizeof(llext_work_queue));
+    k_work_queue_start(&llext_work_queue, llext_work_queue_stack, K_THREAD_STACK_SIZEOF(llext_work_queue_stack), EXAMPLE_LLEXT_WORK_QUEUE_PRIORITY, NULL);
+    k_thread_name_set(&llext_work_queue.thread, "llext_install");
+    k_work_init(&llext_install_work, llext_install_work_handler);
+}
+
+/**
+ * @brief Install timeout work handler, the installation is cancelled if the module is being loaded, or the install work queue is aborted and
+ * recreated if the initialization function of the module never returns
+ * @param work Work item
+ */
+static void
+llext_install_timeout_work_handler(struct k_work *work) {
+
+    (void)work;
+    const char *name = NULL;
+    void       *ref  = NULL;
+    bool        notify;
+
+    k_mutex_lock(&llext_lock, K_FOREVER);
+    if (-EINPROGRESS == llext_ctx.result) {
+        if (true == llext_ctx.initializing) {
+            /* The thread only holds the reference of the module while the initialization function is running */
+            LOG_ERR("Initialization of module '%s' not done after %u ms, aborting it", llext_ctx.name, (uint32_t)(k_uptime_get() - llext_ctx.submitted));
+            k_thread_abort(&llext_work_queue.thread);
+            llext_work_queue_start();
+            name                   = llext_ctx.name;
+            ref                    = llext_ctx.ref;
+            llext_ctx.initializing = false;
+            llext_ctx.size         = 0;
+            llext_ctx.result       = -ETIMEDOUT;
+        } else {
+            /* The module is unloaded by the work queue once it is loaded */
+            LOG_ERR("Installation of module '%s' not done after %u ms, cancelling it", llext_ctx.name, (uint32_t)(k_uptime_get() - llext_ctx.submitted));
+            llext_install_cancel();
+        }
+    }
+    notify = llext_ctx.pending && (-EINPROGRESS != llext_ctx.result);
+    k_mutex_unlock(&llext_lock);
+
+    /* Unload the module which initialization function has been aborted */
+    if (NULL != name) {
+        example_llext_release(ref);
+        example_llext_unload(name);
+    }
+
+    /* The deployment status is published once the result is available */
+    if (true == notify) {
+        llext_install_notify();
+    }
+}
+
+mender_err_t
+example_llext_init(void) {
+
+    /* Clear symbol index */
+    example_llext_index_clear(&llext_index);
+
+    /* Start install work queue */
+    llext_work_queue_start();
+
+    return MENDER_OK;
+}
+
+mender_err_t
+example_llext_install_start(const char *name, const char *symbol, void *data, size_t size) {
+
+    mender_err_t ret = MENDER_OK;
+
+    k_mutex_lock(&llext_lock, K_FOREVER);
+
+    /* Only one module is installed at a time, the previous installation must be done */
+    if ((NULL != llext_ctx.data) || (0 != k_work_busy_get(&llext_install_work))) {
+        LOG_ERR("Installation of module '%s' is already in progress", llext_ctx.name);
+        free(data);
+        ret = MENDER_FAIL;
+        goto END;
+    }
+
+    /* Submit installation */
+    llext_ctx.name      = name;
+    llext_ctx.symbol    = symbol;
+    llext_ctx.data      = data;
+    llext_ctx.size      = size;
+    llext_ctx.pending   = true;
+    llext_ctx.cancelled = false;
+    llext_ctx.result    = -EINPROGRESS;
+    llext_ctx.submitted = k_uptime_get();
+#ifdef CONFIG_EXAMPLE_TRACE
+    llext_ctx.timestamp = example_trace_timestamp();
+#endif /* CONFIG_EXAMPLE_TRACE */
+    if (k_work_submit_to_queue(&llext_work_queue, &llext_install_work) < 0) {
+        LOG_ERR("Unable to submit installation of module '%s'", name);
+        free(llext_ctx.data);
+        llext_ctx.data    = NULL;
+        llext_ctx.size    = 0;
+        llext_ctx.pending = false;
+        ret               = MENDER_FAIL;
+        goto END;
+    }
+    k_work_reschedule(&llext_install_timeout_work, K_MSEC(CONFIG_EXAMPLE_LLEXT_INSTALL_TIMEOUT));
+
+END:
+
+    k_mutex_unlock(&llext_lock);
+
+    return ret;
+}
+
+bool
+example_llext_install_pending(void) {
+
+    bool pending;
+
+    k_mutex_lock(&llext_lock, K_FOREVER);
+    pending = llext_ctx.pending;
+    k_mutex_unlock(&llext_lock);
+
+    return pending;
+}
+
+int
+example_llext_install_result(void) {
+
+    int result;
+
+    k_mutex_lock(&llext_lock, K_FOREVER);
+
+    /* The installation is no longer pending once its result is retrieved */
+    if (true != llext_ctx.pending) {
+        result = -ENOENT;
+    } else if (-EINPROGRESS != (result = llext_ctx.result)) {
+        LOG_INF("Result of the installation of module '%s' (%d) retrieved after %u ms",
+                llext_ctx.name,
+                result,
+                (uint32_t)(k_uptime_get() - llext_ctx.submitted));
+#ifdef CONFIG_EXAMPLE_TRACE
+        example_trace_record(EXAMPLE_TRACE_PHASE_LLEXT_WAIT, llext_ctx.timestamp);
+#endif /* CONFIG_EXAMPLE_TRACE */
+        llext_ctx.pending = false;
+    }
+
+    k_mutex_unlock(&llext_lock);
+
+    return result;
+}
+
+void
+example_llext_install_abort(void) {
+
+    k_mutex_lock(&llext_lock, K_FOREVER);
+
+    /* Cancel the installation if it is not done */
+    if (-EINPROGRESS == llext_ctx.result) {
+        llext_install_cancel();
+    }
+    llext_ctx.pending = false;
+
+    k_mutex_unlock(&llext_lock);
+}
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief List the resident modules
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_llext_mgr_list(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)argc;
+    (void)argv;
+
+    k_mutex_lock(&llext_modules_lock, K_FOREVER);
+    shell_print(sh, "%-16s %-16s %8s %10s", "module", "extension", "symbols", "generation");
+    for (size_t index = 0; index < CONFIG_EXAMPLE_LLEXT_MAX_MODULES; index++) {
+        if (NULL != llext_modules[index].ext) {
+            shell_print(sh,
+                        "%-16s %-16s %8u %10u",
+                        llext_modules[index].name,
+                        llext_modules[index].ext->name,
+                        (uint32_t)llext_modules[index].ext->exp_tab.sym_cnt,
+                        llext_modules[index].generation);
+        }
+    }
+    shell_print(sh, "%u/%u symbols in the index", (uint32_t)llext_index.count, (uint32_t)llext_index.size);
+    k_mutex_unlock(&llext_modules_lock);
+
+    return 0;
+}
+
+/**
+ * @brief Unload a resident module
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_llext_mgr_unload(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)argc;
+
+    if (MENDER_OK != example_llext_unload(argv[1])) {
+        shell_error(sh, "Unable to unload module '%s'", argv[1]);
+        return -ENOENT;
+    }
+
+    return 0;
+}
+
+#ifdef CONFIG_EXAMPLE_LLEXT_BENCH
+
+/**
+ * @brief Compare the resolution time of the symbols with the linear lookup of llext_find_sym and with the symbol index
+ * @param sh Shell instance
+ * @param count Number of exported symbols
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+llext_mgr_bench(const struct shell *sh, size_t count) {
+
+    struct llext_symbol         *syms    = NULL;
+    char                        *names   = NULL;
+    example_llext_index_entry_t *entries = NULL;
+    struct llext_symtable        table;
+    example_llext_index_t        index;
+    size_t                       size = 1;
+    size_t                       sym;
+    uint32_t                     begin, cycles_build, cycles_linear, cycles_indexed;
+    bool                         ok  = true;
+    int                          ret = 0;
+
+    /* Size of the index, load factor is at most 2/3 */
+    while (size < count + count / 2 + 1) {
+        size <<= 1;
+    }
+
+    /* Generate export table */
+    syms    = malloc(count * sizeof(struct llext_symbol));
+    names   = malloc(count * EXAMPLE_LLEXT_BENCH_NAME_SIZE);
+    entries = malloc(size * sizeof(example_llext_index_entry_t));
+    if ((NULL == syms) || (NULL == names) || (NULL == entries)) {
+        shell_error(sh, "Unable to allocate memory for %u exports", (uint32_t)count);
+        ret = -ENOMEM;
+        goto END;
+    }
+    for (sym = 0; sym < count; sym++) {
+        snprintf(&names[sym * EXAMPLE_LLEXT_BENCH_NAME_SIZE], EXAMPLE_LLEXT_BENCH_NAME_SIZE, "bench_%u", (unsigned int)sym);
+        memcpy(&syms[sym],
+               &(struct llext_symbol) { .name = &names[sym * EXAMPLE_LLEXT_BENCH_NAME_SIZE], .addr = (const void *)(uintptr_t)(sym + 1) },
+               sizeof(struct llext_symbol));
+    }
+    table.sym_cnt = count;
+    table.syms    = syms;
+    index.entries = entries;
+    index.size    = size;
+
+    /* Build the index */
+    begin = k_cycle_get_32();
+    example_llext_index_clear(&index);
+    if (0 != example_llext_index_add(&index, &table, NULL)) {
+        shell_error(sh, "Unable to build the index for %u exports", (uint32_t)count);
+        ret = -EIO;
+        goto END;
+    }
+    cycles_build = k_cycle_get_32() - begin;
+
+    /* Resolve the symbols spread over the table, with the linear lookup and with the index */
+    begin = k_cycle_get_32();
+    for (size_t lookup = 0; lookup < EXAMPLE_LLEXT_BENCH_LOOKUPS; lookup++) {
+        sym = (lookup * 7919) % count;
+        ok  = (syms[sym].addr == llext_find_sym(&table, syms[sym].name)) && ok;
+    }
+    cycles_linear = k_cycle_get_32() - begin;
+    begin         = k_cycle_get_32();
+    for (size_t lookup = 0; lookup < EXAMPLE_LLEXT_BENCH_LOOKUPS; lookup++) {
+        sym = (lookup * 7919) % count;
+        ok  = (syms[sym].addr == example_llext_index_find(&index, syms[sym].name)) && ok;
+    }
+    cycles_indexed = k_cycle_get_32() - begin;
+    if (true != ok) {
+        shell_error(sh, "Unable to resolve the symbols for %u exports", (uint32_t)count);
+        ret = -EIO;
+        goto END;
+    }
+    shell_print(sh,
+                "%8u %8u %12u %12u %12u",
+                (uint32_t)count,
+                (uint32_t)size,
+                (uint32_t)k_cyc_to_us_floor64(cycles_build),
+                (uint32_t)(k_cyc_to_ns_floor64(cycles_linear) / EXAMPLE_LLEXT_BENCH_LOOKUPS),
+                (uint32_t)(k_cyc_to_ns_floor64(cycles_indexed) / EXAMPLE_LLEXT_BENCH_LOOKUPS));
+
+END:
+
+    /* Release memory */
+    free(entries);
+    free(names);
+    free(syms);
+
+    return ret;
+}
+
+/**
+ * @brief Benchmark of the symbol resolution at 10, 100 and 1000 exports, or at the number of exports given
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_llext_mgr_bench(const struct shell *sh, size_t argc, char **argv) {
+
+    static const size_t counts[] = { 10, 100, 1000 };
+    size_t              count    = 0;
+    int                 ret      = 0;
+
+    if (argc > 1) {
+        if (0 == (count = strtoul(argv[1], NULL, 10))) {
+            shell_error(sh, "Invalid number of exports");
+            return -EINVAL;
+        }
+    }
+    shell_print(sh, "%8s %8s %12s %12s %12s", "exports", "index", "build (us)", "linear (ns)", "indexed (ns)");
+    if (0 != count) {
+        return llext_mgr_bench(sh, count);
+    }
+    for (size_t index = 0; (0 == ret) && (index < ARRAY_SIZE(counts)); index++) {
+        ret = llext_mgr_bench(sh, counts[index]);
+    }
+
+    return ret;
+}
+
+#endif /* CONFIG_EXAMPLE_LLEXT_BENCH */
+
+SHELL_STATIC_SUBCMD_SET_CREATE(llext_mgr_cmds,
+                               SHELL_CMD(list, NULL, "List the resident modules", cmd_llext_mgr_list),
+                               SHELL_CMD_ARG(unload, NULL, "Unload a resident module <name>", cmd_llext_mgr_unload, 2, 0),
+#ifdef CONFIG_EXAMPLE_LLEXT_BENCH
+                               SHELL_CMD_ARG(bench, NULL, "Benchmark of the symbol resolution with and without the index [exports]", cmd_llext_mgr_bench, 1, 1),
+#endif /* CONFIG_EXAMPLE_LLEXT_BENCH */
+                               SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(llext_mgr, &llext_mgr_cmds, "LLEXT module manager commands", NULL);
+
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,280 @@
+/**
+ * @file      example-log-ring.c
+ * @brief     Log backend saving the logs in a ring buffer that can be pulled using the shell
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log_backend.h>
+#include <zephyr/logging/log_output.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#ifdef CONFIG_LOG_DICTIONARY_SUPPORT
+#include <zephyr/logging/log_output_dict.h>
+#endif /* CONFIG_LOG_DICTIONARY_SUPPORT */
+
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif /* CONFIG_SHELL */
+
+/**
+ * @brief Log output flags
+ */
+#define EXAMPLE_LOG_RING_OUTPUT_FLAGS (LOG_OUTPUT_FLAG_LEVEL | LOG_OUTPUT_FLAG_TIMESTAMP | LOG_OUTPUT_FLAG_FORMAT_TIMESTAMP)
+
+/**
+ * @brief Log ring buffer and its lock
+ * @note The ring buffer contains records prefixed with their length, when it is full the oldest records are discarded
+ */
+RING_BUF_DECLARE(log_ring, CONFIG_EXAMPLE_LOG_RING_SIZE);
+static struct k_spinlock log_ring_lock;
+BUILD_ASSERT(CONFIG_EXAMPLE_LOG_RING_RECORD_SIZE + sizeof(uint16_t) <= CONFIG_EXAMPLE_LOG_RING_SIZE, "Log ring buffer is too small");
+
+/**
+ * @brief Log output formatting buffer
+ */
+static uint8_t log_ring_output_buffer[64];
+
+/**
+ * @brief Record being formatted, only accessed from the log processing context
+ */
+static uint8_t  log_ring_record[CONFIG_EXAMPLE_LOG_RING_RECORD_SIZE];
+static uint16_t log_ring_record_length    = 0;
+static bool     log_ring_record_truncated = false;
+
+#ifdef CONFIG_LOG_DICTIONARY_SUPPORT
+
+/**
+ * @brief Number of binary records dropped because they are larger than the record size, protected by the ring buffer lock
+ */
+static uint32_t log_ring_records_dropped = 0;
+
+#endif /* CONFIG_LOG_DICTIONARY_SUPPORT */
+
+/**
+ * @brief Log output function, append data to the record being formatted
+ * @param data Data to be saved
+ * @param length Length of the data
+ * @param ctx User context (not used)
+ * @return Number of bytes processed
+ */
+static int
+log_ring_char_out(uint8_t *data, size_t length, void *ctx) {
+
+    (void)ctx;
+
+    /* Append data to the record, the end of the message is truncated if the record is full */
+    size_t count = MIN(length, sizeof(log_ring_record) - log_ring_record_length);
+    memcpy(&log_ring_record[log_ring_record_length], data, count);
+    log_ring_record_length += count;
+    if (count < length) {
+        log_ring_record_truncated = true;
+    }
+
+    return (int)length;
+}
+
+/**
+ * @brief Save the record being formatted in the ring buffer
+ */
+static void
+log_ring_commit(void) {
+
+    uint16_t length;
+
+    /* Nothing to do if the record is empty */
+    if (0 == log_ring_record_length) {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&log_ring_lock);
+
+#ifdef CONFIG_LOG_DICTIONARY_SUPPORT
+    /* Drop truncated binary records, the host parser would lose sync with the following records */
+    if (true == log_ring_record_truncated) {
+        log_ring_records_dropped++;
+        k_spin_unlock(&log_ring_lock, key);
+        log_ring_record_length    = 0;
+        log_ring_record_truncated = false;
+        return;
+    }
+#endif /* CONFIG_LOG_DICTIONARY_SUPPORT */
+
+    /* Discard oldest records if there is not enough space */
+    while (ring_buf_space_get(&log_ring) < sizeof(log_ring_record_length) + log_ring_record_length) {
+        ring_buf_get(&log_ring, (uint8_t *)&length, sizeof(length));
+        ring_buf_get(&log_ring, NULL, length);
+    }
+
+    /* Save record prefixed with its length */
+    ring_buf_put(&log_ring, (uint8_t *)&log_ring_record_length, sizeof(log_ring_record_length));
+    ring_buf_put(&log_ring, log_ring_record, log_ring_record_length);
+
+    k_spin_unlock(&log_ring_lock, key);
+
+    log_ring_record_length    = 0;
+    log_ring_record_truncated = false;
+}
+
+LOG_OUTPUT_DEFINE(log_ring_output, log_ring_char_out, log_ring_output_buffer, sizeof(log_ring_output_buffer));
+
+/**
+ * @brief Process log message
+ * @param backend Log backend
+ * @param msg Log message
+ */
+static void
+log_ring_process(const struct log_backend *const backend, union log_msg_generic *msg) {
+
+    (void)backend;
+
+#ifdef CONFIG_LOG_DICTIONARY_SUPPORT
+    log_dict_output_msg_process(&log_ring_output, &msg->log, EXAMPLE_LOG_RING_OUTPUT_FLAGS);
+#else
+    log_output_msg_process(&log_ring_output, &msg->log, EXAMPLE_LOG_RING_OUTPUT_FLAGS);
+#endif /* CONFIG_LOG_DICTIONARY_SUPPORT */
+    log_output_flush(&log_ring_output);
+    log_ring_commit();
+}
+
+/**
+ * @brief Process dropped log messages
+ * @param backend Log backend
+ * @param cnt Number of dropped messages
+ */
+static void
+log_ring_dropped(const struct log_backend *const backend, uint32_t cnt) {
+
+    (void)backend;
+
+#ifdef CONFIG_LOG_DICTIONARY_SUPPORT
+    log_dict_output_dropped_process(&log_ring_output, cnt);
+#else
+    log_output_dropped_process(&log_ring_output, cnt);
+#endif /* CONFIG_LOG_DICTIONARY_SUPPORT */
+    log_output_flush(&log_ring_output);
+    log_ring_commit();
+}
+
+/**
+ * @brief Switch to panic mode
+ * @param backend Log backend
+ */
+static void
+log_ring_panic(const struct log_backend *const backend) {
+
+    (void)backend;
+
+    log_output_flush(&log_ring_output);
+    log_ring_commit();
+}
+
+/**
+ * @brief Log ring buffer backend
+ */
+static const struct log_backend_api log_ring_api = { .process = log_ring_process, .dropped = log_ring_dropped, .panic = log_ring_panic };
+LOG_BACKEND_DEFINE(log_backend_ring, log_ring_api, true);
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief Record being dumped, only accessed from the shell context
+ */
+static uint8_t log_ring_dump_record[CONFIG_EXAMPLE_LOG_RING_RECORD_SIZE];
+
+/**
+ * @brief Dump the content of the ring buffer, data are removed from the ring buffer
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_log_ring_dump(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)argc;
+    (void)argv;
+    uint16_t         length;
+    k_spinlock_key_t key;
+#ifdef CONFIG_LOG_DICTIONARY_SUPPORT
+    uint32_t dropped;
+#endif /* CONFIG_LOG_DICTIONARY_SUPPORT */
+
+    /* Pull whole records from the ring buffer */
+    do {
+        key = k_spin_lock(&log_ring_lock);
+        if (sizeof(length) == ring_buf_get(&log_ring, (uint8_t *)&length, sizeof(length))) {
+            ring_buf_get(&log_ring, log_ring_dump_record, length);
+        } else {
+            length = 0;
+        }
+        k_spin_unlock(&log_ring_lock, key);
+#ifdef CONFIG_LOG_DICTIONARY_SUPPORT
+        /* Binary records are printed as hexadecimal string, to be decoded using the dictionary database on the host */
+        for (uint16_t index = 0; index < length; index++) {
+            shell_fprintf(sh, SHELL_NORMAL, "%02x", log_ring_dump_record[index]);
+        }
+#else
+        shell_fprintf(sh, SHELL_NORMAL, "%.*s", length, log_ring_dump_record);
+#endif /* CONFIG_LOG_DICTIONARY_SUPPORT */
+    } while (0 != length);
+    shell_fprintf(sh, SHELL_NORMAL, "\n");
+
+#ifdef CONFIG_LOG_DICTIONARY_SUPPORT
+    /* Indicate the number of records dropped because they are larger than the record size */
+    key                      = k_spin_lock(&log_ring_lock);
+    dropped                  = log_ring_records_dropped;
+    log_ring_records_dropped = 0;
+    k_spin_unlock(&log_ring_lock, key);
+    if (0 != dropped) {
+        shell_warn(sh, "%u records larger than %u bytes dropped", dropped, CONFIG_EXAMPLE_LOG_RING_RECORD_SIZE);
+    }
+#endif /* CONFIG_LOG_DICTIONARY_SUPPORT */
+
+    return 0;
+}
+
+/**
+ * @brief Clear the content of the ring buffer
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_log_ring_clear(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)sh;
+    (void)argc;
+    (void)argv;
+    k_spinlock_key_t key = k_spin_lock(&log_ring_lock);
+
+    /* Clear ring buffer */
+    ring_buf_reset(&log_ring);
+
+    k_spin_unlock(&log_ring_lock, key);
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(log_ring_cmds,
+                               SHELL_CMD(dump, NULL, "Dump and remove the content of the log ring buffer", cmd_log_ring_dump),
+                               SHELL_CMD(clear, NULL, "Clear the content of the log ring buffer", cmd_log_ring_clear),
+                               SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(log_ring, &log_ring_cmds, "Log ring buffer commands", NULL);
+
+#endif /* CONFIG_SHELL */
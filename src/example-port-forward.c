@@ -0,0 +1,521 @@
+/**
+ * @file      example-port-forward.c
+ * @brief     Port forwarding of the troubleshoot add-on, bridge between the websocket and local sockets
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif /* CONFIG_SHELL */
+
+#include "example-port-forward.h"
+
+/**
+ * @brief Receive thread priority
+ */
+#define EXAMPLE_PORT_FORWARD_THREAD_PRIORITY (K_LOWEST_APPLICATION_THREAD_PRIO - 1)
+
+/**
+ * @brief Connection to a local service
+ */
+typedef struct {
+    mender_err_t (*forward)(void *, void *, size_t);          /**< Function used to forward the data received from the service */
+    int      sock;                                            /**< Socket, -1 if closed */
+    bool     in_use;                                          /**< Connection allocated, until it is closed by the troubleshoot add-on */
+    bool     closing;                                         /**< Socket being closed, no new reference is given */
+    uint32_t refs;                                            /**< Number of references to the socket, it is closed when there is none */
+    uint32_t generation;                                      /**< Incremented when the connection is released */
+    uint8_t  buffer[CONFIG_EXAMPLE_PORT_FORWARD_BUFFER_SIZE]; /**< Reception buffer, only used by the receive thread */
+} example_port_forward_conn_t;
+
+/**
+ * @brief Pool of connections and its lock, signaled when the references to a socket are released
+ * @note The connections and their buffers are allocated statically, the data received from the websocket are sent directly to the sockets
+ */
+static K_MUTEX_DEFINE(port_forward_lock);
+static K_CONDVAR_DEFINE(port_forward_released);
+static example_port_forward_conn_t port_forward_conns[CONFIG_EXAMPLE_PORT_FORWARD_MAX_CONNECTIONS];
+
+/**
+ * @brief Receive thread, woken up when the first connection is opened
+ */
+static K_THREAD_STACK_DEFINE(port_forward_thread_stack, CONFIG_EXAMPLE_PORT_FORWARD_STACK_SIZE);
+static struct k_thread port_forward_thread;
+static K_SEM_DEFINE(port_forward_wake, 0, 1);
+
+/**
+ * @brief Forward data received from the service to the troubleshoot add-on
+ * @param handle Connection handle
+ * @param data Data
+ * @param length Length of the data
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+port_forward_to_addon(void *handle, void *data, size_t length) {
+
+    return mender_troubleshoot_port_forwarding_forward(handle, data, length);
+}
+
+/**
+ * @brief Check if a host is in the list of the allowed hosts
+ * @param host Host of the service
+ * @return true if the host is allowed, false otherwise
+ */
+static bool
+port_forward_host_allowed(const char *host) {
+
+    const char *entry = CONFIG_EXAMPLE_PORT_FORWARD_ALLOWED_HOSTS;
+    size_t      length;
+
+    /* The entries are separated by spaces or commas */
+    while ('\0' != *(entry += strspn(entry, " ,"))) {
+        length = strcspn(entry, " ,");
+        if ((length == strlen(host)) && (0 == strncmp(entry, host, length))) {
+            return true;
+        }
+        entry += length;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Check if an address is a loopback address
+ * @param addr Address
+ * @return true if the address is a loopback address, false otherwise
+ */
+static bool
+port_forward_addr_loopback(struct sockaddr *addr) {
+
+    if (AF_INET == addr->sa_family) {
+        return net_ipv4_is_addr_loopback(&net_sin(addr)->sin_addr);
+    }
+    if (AF_INET6 == addr->sa_family) {
+        return net_ipv6_is_addr_loopback(&net_sin6(addr)->sin6_addr);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Take a reference to the socket of a connection, the socket is not closed until the reference is released
+ * @param conn Connection
+ * @return Socket, -1 if the connection is closed
+ */
+static int
+port_forward_get(example_port_forward_conn_t *conn) {
+
+    int sock = -1;
+
+    k_mutex_lock(&port_forward_lock, K_FOREVER);
+    if ((true == conn->in_use) && (true != conn->closing) && (conn->sock >= 0)) {
+        conn->refs++;
+        sock = conn->sock;
+    }
+    k_mutex_unlock(&port_forward_lock);
+
+    return sock;
+}
+
+/**
+ * @brief Release a reference to the socket of a connection
+ * @param conn Connection
+ */
+static void
+port_forward_put(example_port_forward_conn_t *conn) {
+
+    k_mutex_lock(&port_forward_lock, K_FOREVER);
+    if (0 == --conn->refs) {
+        k_condvar_broadcast(&port_forward_released);
+    }
+    k_mutex_unlock(&port_forward_lock);
+}
+
+/**
+ * @brief Close the socket of a connection, the lock must be held
+ * @note The pending I/O are interrupted and the socket is closed when the references are released, the lock is released while waiting
+ * @param conn Connection
+ */
+static void
+port_forward_close_socket_locked(example_port_forward_conn_t *conn) {
+
+    /* Wait for another thread closing the socket */
+    while (true == conn->closing) {
+        k_condvar_wait(&port_forward_released, &port_forward_lock, K_FOREVER);
+    }
+    if (conn->sock < 0) {
+        return;
+    }
+
+    /* Interrupt the pending I/O and wait for the references to be released */
+    conn->closing = true;
+    if (conn->refs > 0) {
+        zsock_shutdown(conn->sock, ZSOCK_SHUT_RDWR);
+    }
+    while (conn->refs > 0) {
+        k_condvar_wait(&port_forward_released, &port_forward_lock, K_FOREVER);
+    }
+    zsock_close(conn->sock);
+    conn->sock    = -1;
+    conn->closing = false;
+    k_condvar_broadcast(&port_forward_released);
+}
+
+/**
+ * @brief Close the socket of a connection, the connection remains allocated until it is closed by the troubleshoot add-on
+ * @param conn Connection
+ * @param generation Generation of the connection, nothing is done if the connection has been released in the meantime
+ */
+static void
+port_forward_close_socket(example_port_forward_conn_t *conn, uint32_t generation) {
+
+    k_mutex_lock(&port_forward_lock, K_FOREVER);
+    if (generation == conn->generation) {
+        port_forward_close_socket_locked(conn);
+    }
+    k_mutex_unlock(&port_forward_lock);
+}
+
+/**
+ * @brief Receive thread entry point, the data received from the services are forwarded to the troubleshoot add-on
+ * @note New connections are polled at the next poll interval at the latest, a reference to the sockets is held while they are polled
+ * @param p1 Not used
+ * @param p2 Not used
+ * @param p3 Not used
+ */
+static void
+port_forward_thread_entry(void *p1, void *p2, void *p3) {
+
+    (void)p1;
+    (void)p2;
+    (void)p3;
+    struct zsock_pollfd          fds[CONFIG_EXAMPLE_PORT_FORWARD_MAX_CONNECTIONS];
+    example_port_forward_conn_t *conns[CONFIG_EXAMPLE_PORT_FORWARD_MAX_CONNECTIONS];
+    uint32_t                     generations[CONFIG_EXAMPLE_PORT_FORWARD_MAX_CONNECTIONS];
+    mender_err_t (*forward)(void *, void *, size_t);
+    size_t  count;
+    int     ready;
+    short   events;
+    ssize_t length;
+    int     error;
+
+    while (true) {
+
+        /* List the opened connections and take a reference to their sockets, wait for a connection if there is none */
+        count = 0;
+        k_mutex_lock(&port_forward_lock, K_FOREVER);
+        for (size_t index = 0; index < CONFIG_EXAMPLE_PORT_FORWARD_MAX_CONNECTIONS; index++) {
+            if ((true != port_forward_conns[index].closing) && (port_forward_conns[index].sock >= 0)) {
+                port_forward_conns[index].refs++;
+                fds[count].fd        = port_forward_conns[index].sock;
+                fds[count].events    = ZSOCK_POLLIN;
+                fds[count].revents   = 0;
+                conns[count]         = &port_forward_conns[index];
+                generations[count++] = port_forward_conns[index].generation;
+            }
+        }
+        k_mutex_unlock(&port_forward_lock);
+        if (0 == count) {
+            k_sem_take(&port_forward_wake, K_FOREVER);
+            continue;
+        }
+
+        /* Wait for data */
+        ready = zsock_poll(fds, count, CONFIG_EXAMPLE_PORT_FORWARD_POLL_INTERVAL);
+
+        /* Forward the data received, the reference is released before forwarding, the socket is closed when the service closes the connection */
+        for (size_t index = 0; index < count; index++) {
+            events = (ready > 0) ? (fds[index].revents & (ZSOCK_POLLIN | ZSOCK_POLLHUP | ZSOCK_POLLERR)) : 0;
+            length = (0 != events) ? zsock_recv(fds[index].fd, conns[index]->buffer, sizeof(conns[index]->buffer), ZSOCK_MSG_DONTWAIT) : 0;
+            error  = errno;
+            port_forward_put(conns[index]);
+            if (0 == events) {
+                continue;
+            }
+            if (length <= 0) {
+                /* The connection remains allocated until the troubleshoot add-on closes it, the add-on can't be notified */
+                if ((0 == length) || (EAGAIN != error)) {
+                    LOG_INF("Port forwarding closed by the service (%d)", (0 == length) ? 0 : -error);
+                    port_forward_close_socket(conns[index], generations[index]);
+                }
+                continue;
+            }
+            k_mutex_lock(&port_forward_lock, K_FOREVER);
+            forward = (generations[index] == conns[index]->generation) ? conns[index]->forward : NULL;
+            k_mutex_unlock(&port_forward_lock);
+            if ((NULL != forward) && (MENDER_OK != forward(conns[index], conns[index]->buffer, length))) {
+                LOG_ERR("Unable to forward data received from the service");
+            }
+        }
+    }
+}
+
+mender_err_t
+example_port_forward_init(void) {
+
+    /* Initialize pool of connections */
+    for (size_t index = 0; index < CONFIG_EXAMPLE_PORT_FORWARD_MAX_CONNECTIONS; index++) {
+        port_forward_conns[index].sock    = -1;
+        port_forward_conns[index].in_use  = false;
+        port_forward_conns[index].closing = false;
+        port_forward_conns[index].refs    = 0;
+    }
+
+    /* Start receive thread */
+    k_thread_create(&port_forward_thread,
+                    port_forward_thread_stack,
+                    K_THREAD_STACK_SIZEOF(port_forward_thread_stack),
+                    port_forward_thread_entry,
+                    NULL,
+                    NULL,
+                    NULL,
+                    EXAMPLE_PORT_FORWARD_THREAD_PRIORITY,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&port_forward_thread, "port_forward");
+
+    return MENDER_OK;
+}
+
+mender_err_t
+example_port_forward_connect(char *host, uint16_t port, mender_troubleshoot_port_forwarding_protocol_t protocol, void **handle) {
+
+    assert(NULL != host);
+    assert(NULL != handle);
+    struct zsock_addrinfo        hints = { .ai_family = AF_UNSPEC };
+    struct zsock_addrinfo       *addr  = NULL;
+    example_port_forward_conn_t *conn  = NULL;
+    char                         service[6];
+    int                          sock = -1;
+    mender_err_t                 ret  = MENDER_FAIL;
+
+    /* Allocate a connection */
+    k_mutex_lock(&port_forward_lock, K_FOREVER);
+    for (size_t index = 0; (NULL == conn) && (index < CONFIG_EXAMPLE_PORT_FORWARD_MAX_CONNECTIONS); index++) {
+        if (true != port_forward_conns[index].in_use) {
+            conn          = &port_forward_conns[index];
+            conn->in_use  = true;
+            conn->forward = port_forward_to_addon;
+        }
+    }
+    k_mutex_unlock(&port_forward_lock);
+    if (NULL == conn) {
+        LOG_ERR("Unable to forward port %u, too many connections", port);
+        return MENDER_FAIL;
+    }
+
+    /* Resolve host */
+    hints.ai_socktype = (MENDER_TROUBLESHOOT_PORT_FORWARDING_PROTOCOL_UDP == protocol) ? SOCK_DGRAM : SOCK_STREAM;
+    snprintf(service, sizeof(service), "%u", port);
+    if (0 != zsock_getaddrinfo(host, service, &hints, &addr)) {
+        LOG_ERR("Unable to resolve '%s'", host);
+        goto END;
+    }
+
+    /* Check host, only the loopback addresses and the allowed hosts are reachable */
+    if ((true != port_forward_host_allowed(host)) && (true != port_forward_addr_loopback(addr->ai_addr))) {
+        LOG_ERR("Port forwarding to '%s:%u' not allowed", host, port);
+        goto END;
+    }
+
+    /* Connect to the service */
+    if ((sock = zsock_socket(addr->ai_family, hints.ai_socktype, 0)) < 0) {
+        LOG_ERR("Unable to create socket (%d)", -errno);
+        goto END;
+    }
+    if (zsock_connect(sock, addr->ai_addr, addr->ai_addrlen) < 0) {
+        LOG_ERR("Unable to connect to '%s:%u' (%d)", host, port, -errno);
+        zsock_close(sock);
+        goto END;
+    }
+    LOG_INF("Port forwarding to '%s:%u' opened", host, port);
+    ret = MENDER_OK;
+
+END:
+
+    /* Publish the connection to the receive thread, or release it */
+    k_mutex_lock(&port_forward_lock, K_FOREVER);
+    if (MENDER_OK == ret) {
+        conn->sock = sock;
+        *handle    = conn;
+        k_sem_give(&port_forward_wake);
+    } else {
+        conn->in_use = false;
+        conn->generation++;
+    }
+    k_mutex_unlock(&port_forward_lock);
+    if (NULL != addr) {
+        zsock_freeaddrinfo(addr);
+    }
+
+    return ret;
+}
+
+mender_err_t
+example_port_forward_send(void *handle, void *data, size_t length) {
+
+    example_port_forward_conn_t *conn = (example_port_forward_conn_t *)handle;
+    const uint8_t               *ptr  = (const uint8_t *)data;
+    int                          sock;
+    ssize_t                      sent;
+    mender_err_t                 ret = MENDER_OK;
+
+    /* Take a reference to the socket, the service may have closed it */
+    if ((NULL == conn) || ((sock = port_forward_get(conn)) < 0)) {
+        return MENDER_FAIL;
+    }
+
+    /* Send the payload of the websocket frame as is */
+    while (length > 0) {
+        if ((sent = zsock_send(sock, ptr, length, 0)) < 0) {
+            LOG_ERR("Unable to send data to the service (%d)", -errno);
+            ret = MENDER_FAIL;
+            break;
+        }
+        ptr += sent;
+        length -= sent;
+    }
+
+    /* Release the reference */
+    port_forward_put(conn);
+
+    return ret;
+}
+
+mender_err_t
+example_port_forward_close(void *handle) {
+
+    example_port_forward_conn_t *conn = (example_port_forward_conn_t *)handle;
+
+    /* Close the socket and release the connection, the pending I/O are interrupted */
+    if (NULL != conn) {
+        k_mutex_lock(&port_forward_lock, K_FOREVER);
+        port_forward_close_socket_locked(conn);
+        conn->in_use = false;
+        conn->generation++;
+        k_mutex_unlock(&port_forward_lock);
+        LOG_INF("Port forwarding closed");
+    }
+
+    return MENDER_OK;
+}
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief Benchmark, number of bytes echoed by the service
+ */
+static atomic_t port_forward_bench_received;
+static K_SEM_DEFINE(port_forward_bench_done, 0, 1);
+static size_t port_forward_bench_total;
+
+/**
+ * @brief Benchmark sink, count the data echoed by the service instead of forwarding them to the troubleshoot add-on
+ * @param handle Connection handle
+ * @param data Data
+ * @param length Length of the data
+ * @return MENDER_OK
+ */
+static mender_err_t
+port_forward_bench_sink(void *handle, void *data, size_t length) {
+
+    (void)handle;
+    (void)data;
+
+    if (atomic_add(&port_forward_bench_received, (atomic_val_t)length) + length >= port_forward_bench_total) {
+        k_sem_give(&port_forward_bench_done);
+    }
+
+    return MENDER_OK;
+}
+
+/**
+ * @brief Measure the throughput of the bridge with an echo service, the data are sent with the send callback as websocket frames would be
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_port_forward_bench(const struct shell *sh, size_t argc, char **argv) {
+
+    example_port_forward_conn_t *conn;
+    uint8_t                     *frame;
+    size_t                       size = (argc > 3) ? strtoul(argv[3], NULL, 10) * 1024 : 64 * 1024;
+    int64_t                      begin;
+    uint32_t                     duration;
+    int                          result = 0;
+
+    /* Connect to the echo service */
+    if (NULL == (frame = malloc(CONFIG_EXAMPLE_PORT_FORWARD_BUFFER_SIZE))) {
+        shell_error(sh, "Unable to allocate memory");
+        return -ENOMEM;
+    }
+    memset(frame, 0x55, CONFIG_EXAMPLE_PORT_FORWARD_BUFFER_SIZE);
+    if (MENDER_OK
+        != example_port_forward_connect(argv[1], (uint16_t)strtoul(argv[2], NULL, 10), MENDER_TROUBLESHOOT_PORT_FORWARDING_PROTOCOL_TCP, (void **)&conn)) {
+        shell_error(sh, "Unable to connect to the echo service");
+        free(frame);
+        return -ECONNREFUSED;
+    }
+    k_mutex_lock(&port_forward_lock, K_FOREVER);
+    conn->forward = port_forward_bench_sink;
+    k_mutex_unlock(&port_forward_lock);
+    atomic_set(&port_forward_bench_received, 0);
+    port_forward_bench_total = size;
+    k_sem_reset(&port_forward_bench_done);
+
+    /* Send the frames and wait for the echo */
+    begin = k_uptime_get();
+    for (size_t offset = 0; offset < size; offset += CONFIG_EXAMPLE_PORT_FORWARD_BUFFER_SIZE) {
+        if (MENDER_OK != example_port_forward_send(conn, frame, MIN(CONFIG_EXAMPLE_PORT_FORWARD_BUFFER_SIZE, size - offset))) {
+            shell_error(sh, "Unable to send data to the echo service");
+            result = -EIO;
+            goto END;
+        }
+    }
+    if (0 != k_sem_take(&port_forward_bench_done, K_SECONDS(10))) {
+        shell_error(sh, "Echo not received, %u bytes of %u", (uint32_t)atomic_get(&port_forward_bench_received), (uint32_t)size);
+        result = -ETIMEDOUT;
+        goto END;
+    }
+    duration = MAX(1, (uint32_t)(k_uptime_get() - begin));
+    shell_print(sh, "%u bytes echoed in %u ms, %u KB/s", (uint32_t)size, duration, (uint32_t)(size * 1000 / 1024 / duration));
+
+END:
+
+    /* Release connection */
+    example_port_forward_close(conn);
+    free(frame);
+
+    return result;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(port_forward_cmds,
+                               SHELL_CMD_ARG(bench, NULL, "Throughput with an echo service <host> <port> [kbytes]", cmd_port_forward_bench, 3, 1),
+                               SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(port_forward, &port_forward_cmds, "Port forwarding commands", NULL);
+
+#endif /* CONFIG_SHELL */
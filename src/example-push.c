@@ -0,0 +1,380 @@
+/**
+ * @file      example-push.c
+ * @brief     Push channel used by the server to notify the device of new deployments
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/tls_credentials.h>
+#include <zephyr/sys/util.h>
+
+#include "mender-client.h"
+
+#include "example-push.h"
+
+/**
+ * @brief Push thread priority
+ */
+#define EXAMPLE_PUSH_THREAD_PRIORITY (K_LOWEST_APPLICATION_THREAD_PRIO)
+
+/**
+ * @brief Messages of the push protocol, one message per line
+ * @note The device sends "HELLO <identity> <token>" when connected, the token is the one of the device API, and "PING" periodically, the server
+ * answers "PONG" and sends "DEPLOYMENT" when a new deployment is available. The notification carries no data, the deployment is retrieved by the
+ * mender-mcu-client with the device API.
+ */
+#define EXAMPLE_PUSH_MSG_HELLO      "HELLO"
+#define EXAMPLE_PUSH_MSG_PING       "PING"
+#define EXAMPLE_PUSH_MSG_PONG       "PONG"
+#define EXAMPLE_PUSH_MSG_DEPLOYMENT "DEPLOYMENT"
+
+/**
+ * @brief Maximum length of a message received
+ */
+#define EXAMPLE_PUSH_LINE_SIZE (64)
+
+/**
+ * @brief Delay before connecting again to the push server, doubled after each failure
+ */
+#define EXAMPLE_PUSH_RETRY_MIN (1)
+#define EXAMPLE_PUSH_RETRY_MAX (300)
+
+/**
+ * @brief Push thread
+ */
+static K_THREAD_STACK_DEFINE(push_thread_stack, CONFIG_EXAMPLE_PUSH_STACK_SIZE);
+static struct k_thread push_thread;
+
+/**
+ * @brief Deployment check triggered by the notifications, delayed to respect the minimum interval between two checks
+ */
+static void push_check_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(push_check_work, push_check_work_handler);
+
+/**
+ * @brief Timestamps of the last deployment check and of the last check scheduled when connecting, token of the device and their lock
+ */
+static K_MUTEX_DEFINE(push_lock);
+static int64_t push_check_timestamp     = 0;
+static int64_t push_reconnect_timestamp = 0;
+static char   *push_token               = NULL;
+
+/**
+ * @brief Identity of the device
+ */
+static char push_identity[32];
+
+/**
+ * @brief Deployment check work handler, the mender-mcu-client checks for a deployment at once
+ * @param work Work item
+ */
+static void
+push_check_work_handler(struct k_work *work) {
+
+    (void)work;
+
+    k_mutex_lock(&push_lock, K_FOREVER);
+    push_check_timestamp = k_uptime_get();
+    k_mutex_unlock(&push_lock);
+    if (MENDER_OK != mender_client_execute()) {
+        LOG_ERR("Unable to trigger the deployment check");
+    }
+}
+
+/**
+ * @brief Schedule a deployment check, notifications received within the minimum interval are coalesced in a single check
+ */
+static void
+push_check_schedule(void) {
+
+    int64_t delay;
+
+    k_mutex_lock(&push_lock, K_FOREVER);
+    delay = (0 == push_check_timestamp) ? 0 : MAX(0, (int64_t)CONFIG_EXAMPLE_PUSH_MIN_INTERVAL * 1000 - (k_uptime_get() - push_check_timestamp));
+    k_mutex_unlock(&push_lock);
+
+    LOG_INF("Checking for deployment in %d ms", (int)delay);
+    k_work_schedule(&push_check_work, K_MSEC(delay));
+}
+
+/**
+ * @brief Schedule a deployment check when connected, a deployment may have been published while disconnected
+ * @note The checks are limited to one per reconnect interval so that a connection lost repeatedly does not load the server, the periodic poll
+ * of the mender-mcu-client retrieves the deployments published while disconnected in the meantime
+ */
+static void
+push_check_schedule_reconnect(void) {
+
+    int64_t now = k_uptime_get();
+    bool    check;
+
+    k_mutex_lock(&push_lock, K_FOREVER);
+    if ((check = ((0 == push_reconnect_timestamp) || (now - push_reconnect_timestamp >= (int64_t)CONFIG_EXAMPLE_PUSH_RECONNECT_INTERVAL * 1000)))) {
+        push_reconnect_timestamp = now;
+    }
+    k_mutex_unlock(&push_lock);
+    if (true == check) {
+        push_check_schedule();
+    }
+}
+
+/**
+ * @brief Send a message to the push server
+ * @param sock Socket
+ * @param message Message
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+push_send(int sock, const char *message) {
+
+    size_t  length = strlen(message);
+    size_t  offset = 0;
+    ssize_t sent;
+
+    while (offset < length) {
+        if ((sent = zsock_send(sock, &message[offset], length - offset, 0)) < 0) {
+            return -errno;
+        }
+        offset += sent;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Connect to the push server
+ * @return Socket if the function succeeds, error code otherwise
+ */
+static int
+push_connect(void) {
+
+    struct zsock_addrinfo  hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct zsock_addrinfo *addr  = NULL;
+#ifdef CONFIG_EXAMPLE_PUSH_TLS
+    sec_tag_t sec_tag[] = { CONFIG_MENDER_NET_CA_CERTIFICATE_TAG };
+#endif /* CONFIG_EXAMPLE_PUSH_TLS */
+    char  port[6];
+    char *hello = NULL;
+    int   sock  = -1;
+    int   result;
+
+    /* Build the hello message, the device is authenticated with its token, available once the mender-mcu-client is authenticated */
+    k_mutex_lock(&push_lock, K_FOREVER);
+    if (NULL != push_token) {
+        if (NULL != (hello = malloc(strlen(EXAMPLE_PUSH_MSG_HELLO) + strlen(push_identity) + strlen(push_token) + 4))) {
+            sprintf(hello, "%s %s %s\n", EXAMPLE_PUSH_MSG_HELLO, push_identity, push_token);
+        }
+    }
+    k_mutex_unlock(&push_lock);
+    if (NULL == hello) {
+        return -EACCES;
+    }
+
+    /* Resolve host */
+    snprintf(port, sizeof(port), "%d", CONFIG_EXAMPLE_PUSH_PORT);
+    if (0 != zsock_getaddrinfo(CONFIG_EXAMPLE_PUSH_HOST, port, &hints, &addr)) {
+        result = -EHOSTUNREACH;
+        goto END;
+    }
+
+    /* Connect and send the identity of the device, TLS is handled by the sockets */
+#ifdef CONFIG_EXAMPLE_PUSH_TLS
+    if ((sock = zsock_socket(addr->ai_family, SOCK_STREAM, IPPROTO_TLS_1_2)) < 0) {
+        result = -errno;
+        goto END;
+    }
+    if ((zsock_setsockopt(sock, SOL_TLS, TLS_SEC_TAG_LIST, sec_tag, sizeof(sec_tag)) < 0)
+        || (zsock_setsockopt(sock, SOL_TLS, TLS_HOSTNAME, CONFIG_EXAMPLE_PUSH_HOST, strlen(CONFIG_EXAMPLE_PUSH_HOST) + 1) < 0)) {
+        result = -errno;
+        goto END;
+    }
+#else
+    if ((sock = zsock_socket(addr->ai_family, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+        result = -errno;
+        goto END;
+    }
+#endif /* CONFIG_EXAMPLE_PUSH_TLS */
+    if (zsock_connect(sock, addr->ai_addr, addr->ai_addrlen) < 0) {
+        result = -errno;
+        goto END;
+    }
+    if (0 != (result = push_send(sock, hello))) {
+        goto END;
+    }
+    result = sock;
+
+END:
+
+    /* Release memory */
+    if ((result < 0) && (sock >= 0)) {
+        zsock_close(sock);
+    }
+    if (NULL != addr) {
+        zsock_freeaddrinfo(addr);
+    }
+    free(hello);
+
+    return result;
+}
+
+/**
+ * @brief Receive the messages of the push server until the connection is lost
+ * @param sock Socket
+ */
+static void
+push_receive(int sock) {
+
+    struct zsock_pollfd fds = { .fd = sock, .events = ZSOCK_POLLIN };
+    char                line[EXAMPLE_PUSH_LINE_SIZE];
+    size_t              length    = 0;
+    int64_t             last_recv = k_uptime_get();
+    int64_t             last_ping = last_recv;
+    int64_t             now;
+    char               *end;
+    ssize_t             received;
+    int                 result;
+
+    while (true) {
+
+        /* Wait for data, ping the server periodically and close the connection if it does not answer */
+        if ((result = zsock_poll(&fds, 1, CONFIG_EXAMPLE_PUSH_KEEPALIVE * 1000)) < 0) {
+            LOG_ERR("Unable to poll the push channel (%d)", -errno);
+            return;
+        }
+        now = k_uptime_get();
+        if (now - last_recv >= 2 * CONFIG_EXAMPLE_PUSH_KEEPALIVE * 1000) {
+            LOG_WRN("Push server not answering, closing the connection");
+            return;
+        }
+        if (now - last_ping >= CONFIG_EXAMPLE_PUSH_KEEPALIVE * 1000) {
+            if (0 != push_send(sock, EXAMPLE_PUSH_MSG_PING "\n")) {
+                return;
+            }
+            last_ping = now;
+        }
+        if (0 == result) {
+            continue;
+        }
+
+        /* Read the messages, the lines too long are truncated */
+        if ((received = zsock_recv(sock, &line[length], sizeof(line) - 1 - length, 0)) <= 0) {
+            LOG_WRN("Push channel closed");
+            return;
+        }
+        last_recv = k_uptime_get();
+        length += received;
+        line[length] = '\0';
+        while (NULL != (end = strchr(line, '\n'))) {
+            *end = '\0';
+            if (0 == strncmp(line, EXAMPLE_PUSH_MSG_DEPLOYMENT, strlen(EXAMPLE_PUSH_MSG_DEPLOYMENT))) {
+                LOG_INF("Deployment notification received");
+                push_check_schedule();
+            } else if (0 != strncmp(line, EXAMPLE_PUSH_MSG_PONG, strlen(EXAMPLE_PUSH_MSG_PONG))) {
+                LOG_WRN("Unexpected message on the push channel");
+            }
+            length -= end + 1 - line;
+            memmove(line, end + 1, length + 1);
+        }
+        if (length == sizeof(line) - 1) {
+            length = 0;
+        }
+    }
+}
+
+/**
+ * @brief Push thread entry point, the connection is opened again when it is lost
+ * @param p1 Not used
+ * @param p2 Not used
+ * @param p3 Not used
+ */
+static void
+push_thread_entry(void *p1, void *p2, void *p3) {
+
+    (void)p1;
+    (void)p2;
+    (void)p3;
+    int retry = EXAMPLE_PUSH_RETRY_MIN;
+    int sock;
+
+    while (true) {
+
+        /* Connect to the push server */
+        if ((sock = push_connect()) < 0) {
+            LOG_DBG("Unable to connect to the push server (%d), retrying in %d s", sock, retry);
+            k_sleep(K_SECONDS(retry));
+            retry = MIN(2 * retry, EXAMPLE_PUSH_RETRY_MAX);
+            continue;
+        }
+        LOG_INF("Connected to the push server");
+        retry = EXAMPLE_PUSH_RETRY_MIN;
+
+        /* A deployment may have been published while disconnected */
+        push_check_schedule_reconnect();
+
+        /* Receive the notifications */
+        push_receive(sock);
+        zsock_close(sock);
+        k_sleep(K_SECONDS(retry));
+    }
+}
+
+void
+example_push_set_token(char *token) {
+
+    char *tmp;
+
+    /* Save the token if it has changed */
+    k_mutex_lock(&push_lock, K_FOREVER);
+    if ((NULL == push_token) || (0 != strcmp(push_token, token))) {
+        if (NULL != (tmp = strdup(token))) {
+            free(push_token);
+            push_token = tmp;
+        } else {
+            LOG_ERR("Unable to allocate memory");
+        }
+    }
+    k_mutex_unlock(&push_lock);
+}
+
+mender_err_t
+example_push_init(char *identity) {
+
+    /* Save identity */
+    strncpy(push_identity, identity, sizeof(push_identity) - 1);
+
+    /* Start push thread */
+    k_thread_create(&push_thread,
+                    push_thread_stack,
+                    K_THREAD_STACK_SIZEOF(push_thread_stack),
+                    push_thread_entry,
+                    NULL,
+                    NULL,
+                    NULL,
+                    EXAMPLE_PUSH_THREAD_PRIORITY,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&push_thread, "push");
+
+    return MENDER_OK;
+}
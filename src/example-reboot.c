@@ -0,0 +1,135 @@
+/**
+ * @file      example-reboot.c
+ * @brief     Measurement of the reboot window when applying an update
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/bbram.h>
+#include <zephyr/drivers/counter.h>
+
+#include "example-reboot.h"
+
+/**
+ * @brief RTC counter and backup registers devices
+ * @note The RTC keeps running during the reset and the MCUboot swap, the backup registers retain the timestamp taken before the reset.
+ * The backup domain must not be reset at startup, see CONFIG_COUNTER_RTC_STM32_BACKUP_DOMAIN_RESET.
+ */
+static const struct device *reboot_counter = DEVICE_DT_GET(DT_NODELABEL(rtc));
+static const struct device *reboot_bbram   = DEVICE_DT_GET(DT_CHILD(DT_NODELABEL(rtc), backup_regs));
+
+/**
+ * @brief Reboot window record saved in the backup registers
+ */
+#define EXAMPLE_REBOOT_WINDOW_MAGIC  (0x52425754)
+#define EXAMPLE_REBOOT_WINDOW_OFFSET (0)
+typedef struct {
+    uint32_t magic; /**< Magic value, the record is valid only if equal to EXAMPLE_REBOOT_WINDOW_MAGIC */
+    uint32_t ticks; /**< RTC counter value when the reboot has been requested */
+} example_reboot_window_record_t;
+
+/**
+ * @brief Reboot window measured at startup, reported in the inventory
+ */
+static char reboot_window_str[11] = "0";
+
+mender_err_t
+example_reboot_window_start(void) {
+
+    example_reboot_window_record_t record = { .magic = EXAMPLE_REBOOT_WINDOW_MAGIC };
+    int                            err;
+
+    /* Check devices */
+    if ((!device_is_ready(reboot_counter)) || (!device_is_ready(reboot_bbram))) {
+        LOG_ERR("Unable to measure the reboot window, RTC is not available");
+        return MENDER_FAIL;
+    }
+
+    /* Read current RTC counter value */
+    counter_start(reboot_counter);
+    if (0 != (err = counter_get_value(reboot_counter, &record.ticks))) {
+        LOG_ERR("Unable to read RTC counter (err=%d)", err);
+        return MENDER_FAIL;
+    }
+
+    /* Save record in the backup registers */
+    if (0 != (err = bbram_write(reboot_bbram, EXAMPLE_REBOOT_WINDOW_OFFSET, sizeof(record), (uint8_t *)&record))) {
+        LOG_ERR("Unable to save reboot window record (err=%d)", err);
+        return MENDER_FAIL;
+    }
+
+    return MENDER_OK;
+}
+
+mender_err_t
+example_reboot_window_stop(uint32_t *window, bool *measured) {
+
+    assert(NULL != window);
+    assert(NULL != measured);
+    example_reboot_window_record_t record;
+    uint32_t                       ticks;
+    int                            err;
+
+    /* No measurement by default */
+    *window   = 0;
+    *measured = false;
+
+    /* Check devices */
+    if ((!device_is_ready(reboot_counter)) || (!device_is_ready(reboot_bbram))) {
+        LOG_ERR("Unable to measure the reboot window, RTC is not available");
+        return MENDER_FAIL;
+    }
+
+    /* Read record from the backup registers */
+    if (0 != (err = bbram_read(reboot_bbram, EXAMPLE_REBOOT_WINDOW_OFFSET, sizeof(record), (uint8_t *)&record))) {
+        LOG_ERR("Unable to read reboot window record (err=%d)", err);
+        return MENDER_FAIL;
+    }
+    if (EXAMPLE_REBOOT_WINDOW_MAGIC != record.magic) {
+        return MENDER_OK;
+    }
+
+    /* Read current RTC counter value */
+    counter_start(reboot_counter);
+    if (0 != (err = counter_get_value(reboot_counter, &ticks))) {
+        LOG_ERR("Unable to read RTC counter (err=%d)", err);
+        return MENDER_FAIL;
+    }
+    *window   = (uint32_t)(counter_ticks_to_us(reboot_counter, ticks - record.ticks) / USEC_PER_SEC);
+    *measured = true;
+    snprintf(reboot_window_str, sizeof(reboot_window_str), "%u", *window);
+
+    /* Clear record, the measurement is done only once */
+    memset(&record, 0, sizeof(record));
+    if (0 != (err = bbram_write(reboot_bbram, EXAMPLE_REBOOT_WINDOW_OFFSET, sizeof(record), (uint8_t *)&record))) {
+        LOG_ERR("Unable to clear reboot window record (err=%d)", err);
+        return MENDER_FAIL;
+    }
+
+    return MENDER_OK;
+}
+
+char *
+example_reboot_window_str(void) {
+
+    return reboot_window_str;
+}
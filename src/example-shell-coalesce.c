@@ -0,0 +1,383 @@
+/**
+ * @file      example-shell-coalesce.c
+ * @brief     Coalescing of the output of the troubleshoot shell
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mbedtls/ssl.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/websocket.h>
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif /* CONFIG_SHELL */
+
+#include "example-shell-coalesce.h"
+
+/**
+ * @brief Flush work queue priority, the output is sent with the priority of the shell
+ */
+#define EXAMPLE_SHELL_COALESCE_WORK_QUEUE_PRIORITY (CONFIG_SHELL_THREAD_PRIORITY)
+
+/**
+ * @brief Output of the troubleshoot shell waiting to be sent, and its lock
+ * @note The first write after an idle period of at least the flush delay is sent immediately so that the echo of the interactive commands is not
+ * delayed, the following writes are coalesced until the buffer is full or the flush delay is elapsed. Nothing is logged while the lock is held
+ * because the logs may be output on the troubleshoot shell.
+ */
+static K_MUTEX_DEFINE(shell_coalesce_lock);
+static uint8_t                        shell_coalesce_buffer[CONFIG_EXAMPLE_SHELL_COALESCE_SIZE];
+static size_t                         shell_coalesce_length = 0;
+static int64_t                        shell_coalesce_last_flush;
+static bool                           shell_coalesce_enabled = true;
+static example_shell_coalesce_stats_t shell_coalesce_stats;
+static struct k_spinlock              shell_coalesce_stats_lock;
+
+/**
+ * @brief Flush work queue, used to send the pending output when the flush delay is elapsed
+ */
+static K_THREAD_STACK_DEFINE(shell_coalesce_work_queue_stack, CONFIG_EXAMPLE_SHELL_COALESCE_STACK_SIZE);
+static struct k_work_q         shell_coalesce_work_queue;
+static struct k_work_delayable shell_coalesce_work;
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief Measure work queue, the measured command is executed by the work queue because a command can't be executed from the context of
+ * another command, and the command being measured with the shell instance where it is executed
+ */
+static K_THREAD_STACK_DEFINE(shell_coalesce_measure_work_queue_stack, CONFIG_EXAMPLE_SHELL_COALESCE_MEASURE_STACK_SIZE);
+static struct k_work_q     shell_coalesce_measure_work_queue;
+static struct k_work       shell_coalesce_measure_work;
+static const struct shell *shell_coalesce_measure_shell;
+static char               *shell_coalesce_measure_command;
+
+#endif /* CONFIG_SHELL */
+
+/**
+ * @brief Functions wrapped at link time
+ */
+mender_err_t __real_mender_troubleshoot_shell_print(void *data, size_t length);
+int __real_websocket_send_msg(int ws_sock, const uint8_t *payload, size_t payload_len, enum websocket_opcode opcode, bool mask, bool final, int32_t timeout);
+int __real_mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len);
+
+/**
+ * @brief Send data to the troubleshoot add-on, the lock must be held
+ * @param data Data
+ * @param length Length of the data
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+shell_coalesce_send(void *data, size_t length) {
+
+    mender_err_t ret;
+
+    shell_coalesce_last_flush = k_uptime_get();
+    shell_coalesce_stats.flushes++;
+    if (MENDER_OK != (ret = __real_mender_troubleshoot_shell_print(data, length))) {
+        shell_coalesce_stats.errors++;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Send the pending output, the lock must be held
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+shell_coalesce_flush(void) {
+
+    mender_err_t ret = MENDER_OK;
+
+    if (0 != shell_coalesce_length) {
+        ret                   = shell_coalesce_send(shell_coalesce_buffer, shell_coalesce_length);
+        shell_coalesce_length = 0;
+    }
+    k_work_cancel_delayable(&shell_coalesce_work);
+
+    return ret;
+}
+
+/**
+ * @brief Flush work handler, send the pending output when the flush delay is elapsed
+ * @param work Work item
+ */
+static void
+shell_coalesce_work_handler(struct k_work *work) {
+
+    (void)work;
+
+    k_mutex_lock(&shell_coalesce_lock, K_FOREVER);
+    shell_coalesce_flush();
+    k_mutex_unlock(&shell_coalesce_lock);
+}
+
+mender_err_t
+__wrap_mender_troubleshoot_shell_print(void *data, size_t length) {
+
+    mender_err_t ret = MENDER_OK;
+
+    k_mutex_lock(&shell_coalesce_lock, K_FOREVER);
+    shell_coalesce_stats.writes++;
+    shell_coalesce_stats.write_bytes += length;
+
+    /* Interactive output is sent immediately */
+    if ((true != shell_coalesce_enabled)
+        || ((0 == shell_coalesce_length) && (k_uptime_get() - shell_coalesce_last_flush >= CONFIG_EXAMPLE_SHELL_COALESCE_DELAY))) {
+        ret = shell_coalesce_send(data, length);
+        goto END;
+    }
+
+    /* Bulk output is coalesced, the data larger than the buffer are sent after the pending output */
+    if (shell_coalesce_length + length > sizeof(shell_coalesce_buffer)) {
+        ret = shell_coalesce_flush();
+    }
+    if (length >= sizeof(shell_coalesce_buffer)) {
+        ret = shell_coalesce_send(data, length);
+        goto END;
+    }
+    memcpy(&shell_coalesce_buffer[shell_coalesce_length], data, length);
+    shell_coalesce_length += length;
+    if (shell_coalesce_length == sizeof(shell_coalesce_buffer)) {
+        ret = shell_coalesce_flush();
+    } else {
+        /* The delay is counted from the oldest pending data */
+        k_work_schedule_for_queue(&shell_coalesce_work_queue, &shell_coalesce_work, K_MSEC(CONFIG_EXAMPLE_SHELL_COALESCE_DELAY));
+    }
+
+END:
+
+    k_mutex_unlock(&shell_coalesce_lock);
+
+    return ret;
+}
+
+int
+__wrap_websocket_send_msg(int ws_sock, const uint8_t *payload, size_t payload_len, enum websocket_opcode opcode, bool mask, bool final, int32_t timeout) {
+
+    int    ret    = __real_websocket_send_msg(ws_sock, payload, payload_len, opcode, mask, final, timeout);
+    size_t header = 2 + ((payload_len > 0xFFFF) ? 8 : (payload_len > 125) ? 2 : 0) + ((true == mask) ? 4 : 0);
+
+    /* Count the frames sent, all the troubleshoot messages are sent with this function, not only the output of the shell */
+    if (ret >= 0) {
+        k_spinlock_key_t key = k_spin_lock(&shell_coalesce_stats_lock);
+        shell_coalesce_stats.frames++;
+        shell_coalesce_stats.frame_bytes += header + payload_len;
+        k_spin_unlock(&shell_coalesce_stats_lock, key);
+    }
+
+    return ret;
+}
+
+int
+__wrap_mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len) {
+
+    int ret = __real_mbedtls_ssl_write(ssl, buf, len);
+    int expansion;
+
+    /* Count the TLS records sent, each successful call sends one record, all the TLS connections are counted */
+    if (ret > 0) {
+        expansion            = mbedtls_ssl_get_record_expansion(ssl);
+        k_spinlock_key_t key = k_spin_lock(&shell_coalesce_stats_lock);
+        shell_coalesce_stats.records++;
+        shell_coalesce_stats.record_bytes += ret + MAX(0, expansion);
+        k_spin_unlock(&shell_coalesce_stats_lock, key);
+    }
+
+    return ret;
+}
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief Measure work handler, execute the command and print the number of messages, frames and TLS records used to send its output
+ * @param work Work item
+ */
+static void
+shell_coalesce_measure_work_handler(struct k_work *work) {
+
+    (void)work;
+    const struct shell            *sh = shell_coalesce_measure_shell;
+    example_shell_coalesce_stats_t stats;
+    int64_t                        begin;
+    int                            result;
+
+    /* Execute the command, the pending output is sent before and after so that only the output of the command is measured */
+    example_shell_coalesce_flush();
+    example_shell_coalesce_stats_reset();
+    begin  = k_uptime_get();
+    result = shell_execute_cmd(sh, shell_coalesce_measure_command);
+    example_shell_coalesce_flush();
+    example_shell_coalesce_stats(&stats);
+    free(shell_coalesce_measure_command);
+    shell_coalesce_measure_command = NULL;
+
+    /* Print the measurement */
+    shell_print(sh, "Command returned %d in %u ms", result, (uint32_t)(k_uptime_get() - begin));
+    shell_print(
+        sh, "%10s %12s %10s %10s %12s %10s %12s %10s", "writes", "write bytes", "messages", "frames", "frame bytes", "records", "record bytes", "errors");
+    shell_print(sh,
+                "%10u %12u %10u %10u %12u %10u %12u %10u",
+                stats.writes,
+                stats.write_bytes,
+                stats.flushes,
+                stats.frames,
+                stats.frame_bytes,
+                stats.records,
+                stats.record_bytes,
+                stats.errors);
+}
+
+#endif /* CONFIG_SHELL */
+
+mender_err_t
+example_shell_coalesce_init(void) {
+
+    /* Start flush work queue */
+    k_work_queue_start(&shell_coalesce_work_queue,
+                       shell_coalesce_work_queue_stack,
+                       K_THREAD_STACK_SIZEOF(shell_coalesce_work_queue_stack),
+                       EXAMPLE_SHELL_COALESCE_WORK_QUEUE_PRIORITY,
+                       NULL);
+    k_thread_name_set(&shell_coalesce_work_queue.thread, "shell_coalesce");
+    k_work_init_delayable(&shell_coalesce_work, shell_coalesce_work_handler);
+
+#ifdef CONFIG_SHELL
+    /* Start measure work queue */
+    k_work_queue_start(&shell_coalesce_measure_work_queue,
+                       shell_coalesce_measure_work_queue_stack,
+                       K_THREAD_STACK_SIZEOF(shell_coalesce_measure_work_queue_stack),
+                       EXAMPLE_SHELL_COALESCE_WORK_QUEUE_PRIORITY,
+                       NULL);
+    k_thread_name_set(&shell_coalesce_measure_work_queue.thread, "shell_measure");
+    k_work_init(&shell_coalesce_measure_work, shell_coalesce_measure_work_handler);
+#endif /* CONFIG_SHELL */
+
+    return MENDER_OK;
+}
+
+void
+example_shell_coalesce_flush(void) {
+
+    k_mutex_lock(&shell_coalesce_lock, K_FOREVER);
+    shell_coalesce_flush();
+    k_mutex_unlock(&shell_coalesce_lock);
+}
+
+void
+example_shell_coalesce_stats(example_shell_coalesce_stats_t *stats) {
+
+    k_mutex_lock(&shell_coalesce_lock, K_FOREVER);
+    k_spinlock_key_t key = k_spin_lock(&shell_coalesce_stats_lock);
+    memcpy(stats, &shell_coalesce_stats, sizeof(example_shell_coalesce_stats_t));
+    k_spin_unlock(&shell_coalesce_stats_lock, key);
+    k_mutex_unlock(&shell_coalesce_lock);
+}
+
+void
+example_shell_coalesce_stats_reset(void) {
+
+    k_mutex_lock(&shell_coalesce_lock, K_FOREVER);
+    k_spinlock_key_t key = k_spin_lock(&shell_coalesce_stats_lock);
+    memset(&shell_coalesce_stats, 0, sizeof(example_shell_coalesce_stats_t));
+    k_spin_unlock(&shell_coalesce_stats_lock, key);
+    k_mutex_unlock(&shell_coalesce_lock);
+}
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief Enable or disable the coalescing of the output
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_shell_coalesce_enable(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)argc;
+    bool enabled = (0 == strcmp(argv[0], "enable"));
+
+    k_mutex_lock(&shell_coalesce_lock, K_FOREVER);
+    shell_coalesce_flush();
+    shell_coalesce_enabled = enabled;
+    k_mutex_unlock(&shell_coalesce_lock);
+    shell_print(sh, "Coalescing of the output %s", (true == enabled) ? "enabled" : "disabled");
+
+    return 0;
+}
+
+/**
+ * @brief Execute a command and measure the number of messages, frames and TLS records used to send its output, the command is executed by the
+ * measure work queue and the measurement is printed when it is done
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments, the command to be measured
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_shell_coalesce_measure(const struct shell *sh, size_t argc, char **argv) {
+
+    char  *command;
+    size_t length = 0;
+
+    /* Only one command is measured at a time */
+    if (0 != k_work_busy_get(&shell_coalesce_measure_work)) {
+        shell_error(sh, "Measurement already in progress");
+        return -EBUSY;
+    }
+
+    /* Copy the command, the arguments are released when it is executed */
+    for (size_t index = 1; index < argc; index++) {
+        length += strlen(argv[index]) + 1;
+    }
+    if (NULL == (command = malloc(length))) {
+        shell_error(sh, "Unable to allocate memory");
+        return -ENOMEM;
+    }
+    command[0] = '\0';
+    for (size_t index = 1; index < argc; index++) {
+        strcat(command, argv[index]);
+        strcat(command, (index + 1 < argc) ? " " : "");
+    }
+
+    /* Submit the measurement */
+    shell_coalesce_measure_shell   = sh;
+    shell_coalesce_measure_command = command;
+    if (k_work_submit_to_queue(&shell_coalesce_measure_work_queue, &shell_coalesce_measure_work) < 0) {
+        shell_error(sh, "Unable to submit the measurement");
+        free(command);
+        return -EIO;
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(shell_coalesce_cmds,
+                               SHELL_CMD(enable, NULL, "Enable the coalescing of the output", cmd_shell_coalesce_enable),
+                               SHELL_CMD(disable, NULL, "Disable the coalescing of the output", cmd_shell_coalesce_enable),
+                               SHELL_CMD_ARG(measure, NULL, "Measure a command <command>", cmd_shell_coalesce_measure, 2, SHELL_OPT_ARG_CHECK_SKIP),
+                               SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(shell_coalesce, &shell_coalesce_cmds, "Coalescing of the output of the troubleshoot shell", NULL);
+
+#endif /* CONFIG_SHELL */
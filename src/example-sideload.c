@@ -0,0 +1,374 @@
+/**
+ * @file      example-sideload.c
+ * @brief     Installation of artifacts saved in the file system of the device
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/kernel.h>
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif /* CONFIG_SHELL */
+
+#include "mender-artifact.h"
+#include "mender-flash.h"
+
+#include "example-sideload.h"
+
+/**
+ * @brief Sideload thread priority
+ */
+#define EXAMPLE_SIDELOAD_THREAD_PRIORITY (K_LOWEST_APPLICATION_THREAD_PRIO)
+
+/**
+ * @brief Artifact type of the firmware image, handled by the mender-mcu-client itself
+ */
+#define EXAMPLE_SIDELOAD_ROOTFS_IMAGE "rootfs-image"
+
+/**
+ * @brief Artifact type registered by the application
+ */
+typedef struct {
+    mender_err_t (*callback)(char *, char *, char *, cJSON *, char *, size_t, void *, size_t, size_t); /**< Callback of the artifact type */
+    char *type;                                                                                        /**< Artifact type */
+    bool  needs_restart;                                                                               /**< Restart required after installation */
+} example_sideload_artifact_type_t;
+
+/**
+ * @brief Artifact types registered by the application, recorded when they are registered to the mender-mcu-client
+ */
+static example_sideload_artifact_type_t sideload_artifact_types[CONFIG_EXAMPLE_SIDELOAD_MAX_ARTIFACT_TYPES];
+static size_t                           sideload_artifact_types_count = 0;
+
+/**
+ * @brief Installation context
+ */
+typedef struct {
+    char  path[CONFIG_EXAMPLE_SIDELOAD_PATH_SIZE]; /**< Path of the artifact */
+    void *flash_handle;                            /**< Flash handle of the firmware image */
+    bool  needs_restart;                           /**< Restart required after installation */
+} example_sideload_ctx_t;
+static example_sideload_ctx_t sideload_ctx;
+
+/**
+ * @brief Callbacks of the mender-mcu-client
+ */
+static mender_client_callbacks_t sideload_callbacks;
+
+/**
+ * @brief Sideload thread, only one installation at a time
+ */
+static K_THREAD_STACK_DEFINE(sideload_thread_stack, CONFIG_EXAMPLE_SIDELOAD_STACK_SIZE);
+static struct k_thread sideload_thread;
+static atomic_t        sideload_busy = ATOMIC_INIT(0);
+
+/**
+ * @brief Read buffer
+ */
+static uint8_t sideload_buffer[CONFIG_EXAMPLE_SIDELOAD_CHUNK_SIZE];
+
+/**
+ * @brief Function wrapped at link time
+ */
+mender_err_t __real_mender_client_register_artifact_type(char *type,
+                                                         mender_err_t (*callback)(char *, char *, char *, cJSON *, char *, size_t, void *, size_t, size_t),
+                                                         bool  needs_restart,
+                                                         char *artifact_name);
+
+/**
+ * @brief Report deployment status to the application, as the mender-mcu-client does for network deployments
+ * @param status Deployment status
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+sideload_deployment_status(mender_deployment_status_t status) {
+
+    char *desc;
+
+    /* Deployment status description */
+    switch (status) {
+        case MENDER_DEPLOYMENT_STATUS_DOWNLOADING:
+            desc = "downloading";
+            break;
+        case MENDER_DEPLOYMENT_STATUS_INSTALLING:
+            desc = "installing";
+            break;
+        case MENDER_DEPLOYMENT_STATUS_REBOOTING:
+            desc = "rebooting";
+            break;
+        case MENDER_DEPLOYMENT_STATUS_SUCCESS:
+            desc = "success";
+            break;
+        default:
+            desc = "failure";
+            break;
+    }
+
+    /* Invoke deployment status callback */
+    if (NULL == sideload_callbacks.deployment_status) {
+        return MENDER_OK;
+    }
+
+    return sideload_callbacks.deployment_status(status, desc);
+}
+
+/**
+ * @brief Artifact parser callback, the firmware image is written to the update slot and the other payloads are given to their artifact type
+ * @param type Artifact type of the payload
+ * @param meta_data Meta-data of the payload
+ * @param filename Name of the file of the payload
+ * @param size Size of the file
+ * @param data Data of the file
+ * @param index Offset of the data in the file
+ * @param length Length of the data
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+sideload_artifact_cb(char *type, cJSON *meta_data, char *filename, size_t size, void *data, size_t index, size_t length) {
+
+    mender_err_t ret;
+
+    /* Firmware image */
+    if (0 == strcmp(type, EXAMPLE_SIDELOAD_ROOTFS_IMAGE)) {
+        if ((NULL == sideload_ctx.flash_handle) && (MENDER_OK != (ret = mender_flash_open(filename, size, &sideload_ctx.flash_handle)))) {
+            LOG_ERR("Unable to open flash handle");
+            return ret;
+        }
+        if ((NULL != data) && (0 != length) && (MENDER_OK != (ret = mender_flash_write(sideload_ctx.flash_handle, data, index, length)))) {
+            LOG_ERR("Unable to write data to flash");
+            return ret;
+        }
+        sideload_ctx.needs_restart = true;
+        return MENDER_OK;
+    }
+
+    /* Other artifact types, the artifact name is the path of the artifact */
+    for (size_t i = 0; i < sideload_artifact_types_count; i++) {
+        if (0 == strcmp(type, sideload_artifact_types[i].type)) {
+            sideload_ctx.needs_restart |= sideload_artifact_types[i].needs_restart;
+            return sideload_artifact_types[i].callback("sideload", sideload_ctx.path, type, meta_data, filename, size, data, index, length);
+        }
+    }
+    LOG_ERR("Artifact type '%s' is not supported", type);
+
+    return MENDER_FAIL;
+}
+
+/**
+ * @brief Install the artifact, the file is given to the artifact parser of the mender-mcu-client by chunks
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+sideload_install(void) {
+
+    struct fs_file_t       file;
+    mender_artifact_ctx_t *artifact_ctx = NULL;
+    int64_t                begin        = k_uptime_get();
+    size_t                 total        = 0;
+    mender_err_t           ret          = MENDER_FAIL;
+    ssize_t                length;
+    int                    result;
+
+    /* Open the artifact */
+    fs_file_t_init(&file);
+    if ((result = fs_open(&file, sideload_ctx.path, FS_O_READ)) < 0) {
+        LOG_ERR("Unable to open '%s' (%d)", sideload_ctx.path, result);
+        return MENDER_FAIL;
+    }
+    if (NULL == (artifact_ctx = mender_artifact_create_ctx())) {
+        LOG_ERR("Unable to create artifact context");
+        goto END;
+    }
+
+    /* Parse the artifact, the payloads are verified by the parser as for network deployments */
+    if (MENDER_OK != (ret = sideload_deployment_status(MENDER_DEPLOYMENT_STATUS_DOWNLOADING))) {
+        goto END;
+    }
+    while ((length = fs_read(&file, sideload_buffer, sizeof(sideload_buffer))) > 0) {
+        if (MENDER_OK != (ret = mender_artifact_process_data(artifact_ctx, sideload_buffer, length, sideload_artifact_cb))) {
+            LOG_ERR("Unable to process artifact after %u bytes", (uint32_t)total);
+            goto END;
+        }
+        total += length;
+    }
+    if (length < 0) {
+        LOG_ERR("Unable to read '%s' (%d)", sideload_ctx.path, (int)length);
+        ret = MENDER_FAIL;
+        goto END;
+    }
+    LOG_INF("Artifact '%s' processed, %u bytes in %u ms", sideload_ctx.path, (uint32_t)total, (uint32_t)(k_uptime_get() - begin));
+
+    /* Install the artifact */
+    if (MENDER_OK != (ret = sideload_deployment_status(MENDER_DEPLOYMENT_STATUS_INSTALLING))) {
+        goto END;
+    }
+    if (NULL != sideload_ctx.flash_handle) {
+        if ((MENDER_OK != (ret = mender_flash_close(sideload_ctx.flash_handle)))
+            || (MENDER_OK != (ret = mender_flash_set_pending_image(sideload_ctx.flash_handle)))) {
+            LOG_ERR("Unable to set pending image");
+            goto END;
+        }
+        sideload_ctx.flash_handle = NULL;
+    }
+
+END:
+
+    /* Release memory */
+    if (NULL != artifact_ctx) {
+        mender_artifact_release_ctx(artifact_ctx);
+    }
+    fs_close(&file);
+
+    return ret;
+}
+
+/**
+ * @brief Sideload thread entry point
+ * @param p1 Not used
+ * @param p2 Not used
+ * @param p3 Not used
+ */
+static void
+sideload_thread_entry(void *p1, void *p2, void *p3) {
+
+    (void)p1;
+    (void)p2;
+    (void)p3;
+
+    /* The mender-mcu-client is deactivated so that a network deployment does not write the update slot at the same time */
+    mender_client_deactivate();
+    sideload_ctx.flash_handle  = NULL;
+    sideload_ctx.needs_restart = false;
+
+    /* Install the artifact and report the result as the mender-mcu-client does */
+    if (MENDER_OK != sideload_install()) {
+        if (NULL != sideload_ctx.flash_handle) {
+            mender_flash_abort_deployment(sideload_ctx.flash_handle);
+            sideload_ctx.flash_handle = NULL;
+        }
+        sideload_deployment_status(MENDER_DEPLOYMENT_STATUS_FAILURE);
+    } else if (true == sideload_ctx.needs_restart) {
+        sideload_deployment_status(MENDER_DEPLOYMENT_STATUS_REBOOTING);
+        if (NULL != sideload_callbacks.restart) {
+            sideload_callbacks.restart();
+        }
+        return;
+    } else {
+        sideload_deployment_status(MENDER_DEPLOYMENT_STATUS_SUCCESS);
+    }
+
+    /* Resume the mender-mcu-client */
+    if (MENDER_OK != mender_client_activate()) {
+        LOG_ERR("Unable to activate mender-client");
+    }
+    atomic_clear(&sideload_busy);
+}
+
+mender_err_t
+__wrap_mender_client_register_artifact_type(char *type,
+                                            mender_err_t (*callback)(char *, char *, char *, cJSON *, char *, size_t, void *, size_t, size_t),
+                                            bool  needs_restart,
+                                            char *artifact_name) {
+
+    mender_err_t ret;
+
+    /* Register the artifact type to the mender-mcu-client and record it for the installation of artifacts from the file system */
+    if ((MENDER_OK == (ret = __real_mender_client_register_artifact_type(type, callback, needs_restart, artifact_name)))
+        && (sideload_artifact_types_count < CONFIG_EXAMPLE_SIDELOAD_MAX_ARTIFACT_TYPES)) {
+        sideload_artifact_types[sideload_artifact_types_count].type          = type;
+        sideload_artifact_types[sideload_artifact_types_count].callback      = callback;
+        sideload_artifact_types[sideload_artifact_types_count].needs_restart = needs_restart;
+        sideload_artifact_types_count++;
+    }
+
+    return ret;
+}
+
+mender_err_t
+example_sideload_init(mender_client_callbacks_t *callbacks) {
+
+    /* Save callbacks */
+    if (NULL != callbacks) {
+        memcpy(&sideload_callbacks, callbacks, sizeof(mender_client_callbacks_t));
+    }
+
+    return MENDER_OK;
+}
+
+mender_err_t
+example_sideload_start(char *path) {
+
+    /* Only one installation at a time */
+    if (strlen(path) >= CONFIG_EXAMPLE_SIDELOAD_PATH_SIZE) {
+        LOG_ERR("Path of the artifact is too long");
+        return MENDER_FAIL;
+    }
+    if (true != atomic_cas(&sideload_busy, 0, 1)) {
+        LOG_ERR("Installation already in progress");
+        return MENDER_FAIL;
+    }
+    strcpy(sideload_ctx.path, path);
+
+    /* Start sideload thread */
+    k_thread_create(&sideload_thread,
+                    sideload_thread_stack,
+                    K_THREAD_STACK_SIZEOF(sideload_thread_stack),
+                    sideload_thread_entry,
+                    NULL,
+                    NULL,
+                    NULL,
+                    EXAMPLE_SIDELOAD_THREAD_PRIORITY,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&sideload_thread, "sideload");
+
+    return MENDER_OK;
+}
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief Install an artifact saved in the file system
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_sideload_install(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)argc;
+
+    if (MENDER_OK != example_sideload_start(argv[1])) {
+        shell_error(sh, "Unable to start the installation of '%s'", argv[1]);
+        return -EINVAL;
+    }
+    shell_print(sh, "Installing '%s' in the background", argv[1]);
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sideload_cmds,
+                               SHELL_CMD_ARG(install, NULL, "Install an artifact saved in the file system <path>", cmd_sideload_install, 2, 0),
+                               SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(sideload, &sideload_cmds, "Installation of artifacts from the file system", NULL);
+
+#endif /* CONFIG_SHELL */
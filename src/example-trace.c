@@ -0,0 +1,425 @@
+/**
+ * @file      example-trace.c
+ * @brief     Timing instrumentation of the deployment lifecycle
+ *
+ * Copyright joelguittet and mender-mcu-client contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/net_context.h>
+#include <zephyr/net/http/client.h>
+#include <zephyr/sys/util.h>
+#include <mbedtls/ssl.h>
+
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif /* CONFIG_SHELL */
+
+#include "example-trace.h"
+
+/**
+ * @brief Number of buckets of the histograms, bucket N counts durations in the range [2^(N-1), 2^N[ microseconds
+ */
+#define EXAMPLE_TRACE_HISTOGRAM_BUCKETS (32)
+
+/**
+ * @brief Statistics of a phase
+ */
+typedef struct {
+    uint32_t count;                                      /**< Number of records */
+    uint64_t total;                                      /**< Total duration in microseconds */
+    uint32_t min;                                        /**< Minimum duration in microseconds */
+    uint32_t max;                                        /**< Maximum duration in microseconds */
+    uint32_t histogram[EXAMPLE_TRACE_HISTOGRAM_BUCKETS]; /**< Histogram of the durations */
+} example_trace_stats_t;
+
+/**
+ * @brief Names of the phases
+ */
+static const char *trace_phase_names[EXAMPLE_TRACE_PHASE_COUNT] = {
+    [EXAMPLE_TRACE_PHASE_DNS]               = "dns",
+    [EXAMPLE_TRACE_PHASE_TCP_CONNECT]       = "tcp-connect",
+    [EXAMPLE_TRACE_PHASE_TLS_HANDSHAKE]     = "tls-handshake",
+    [EXAMPLE_TRACE_PHASE_HTTP_HEADERS]      = "http-headers",
+    [EXAMPLE_TRACE_PHASE_HTTP_FIRST_BYTE]   = "http-first-byte",
+    [EXAMPLE_TRACE_PHASE_AUTHENTICATION]    = "authentication",
+    [EXAMPLE_TRACE_PHASE_DEPLOYMENT_CHECK]  = "deployment-check",
+    [EXAMPLE_TRACE_PHASE_ARTIFACT_DOWNLOAD] = "artifact-download",
+    [EXAMPLE_TRACE_PHASE_STATUS_REPORT]     = "status-report",
+    [EXAMPLE_TRACE_PHASE_HTTP_REQUEST]      = "http-request",
+    [EXAMPLE_TRACE_PHASE_FLASH_WRITE]       = "flash-write",
+    [EXAMPLE_TRACE_PHASE_FLASH_ERASE]       = "flash-erase",
+    [EXAMPLE_TRACE_PHASE_FLASH_VERIFY]      = "flash-verify",
+    [EXAMPLE_TRACE_PHASE_DOWNLOADING]       = "downloading",
+    [EXAMPLE_TRACE_PHASE_INSTALLING]        = "installing",
+    [EXAMPLE_TRACE_PHASE_LLEXT_QUEUE]       = "llext-queue",
+    [EXAMPLE_TRACE_PHASE_LLEXT_LOAD]        = "llext-load",
+    [EXAMPLE_TRACE_PHASE_LLEXT_INIT]        = "llext-init",
+    [EXAMPLE_TRACE_PHASE_LLEXT_WAIT]        = "llext-wait",
+};
+
+/**
+ * @brief Statistics of the phases and their lock
+ */
+static example_trace_stats_t trace_stats[EXAMPLE_TRACE_PHASE_COUNT];
+static struct k_spinlock     trace_lock;
+
+#ifndef CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+
+/**
+ * @brief Extension of the 32-bit cycle counter to 64 bits and its lock, the timer reads the counter at least twice per wrap around
+ */
+static uint32_t          trace_cycles_last = 0;
+static uint64_t          trace_cycles_high = 0;
+static struct k_spinlock trace_cycles_lock;
+static void              trace_cycles_timer_handler(struct k_timer *timer);
+static K_TIMER_DEFINE(trace_cycles_timer, trace_cycles_timer_handler, NULL);
+
+#endif /* CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER */
+
+/**
+ * @brief Current deployment status and its timestamp
+ */
+static mender_deployment_status_t trace_deployment_status;
+static uint64_t                   trace_deployment_status_begin = 0;
+
+/**
+ * @brief Pending TLS handshakes, the handshake is performed using several calls to mbedtls_ssl_handshake
+ */
+static struct {
+    mbedtls_ssl_context *ssl;
+    uint64_t             begin;
+} trace_tls_handshakes[CONFIG_NET_SOCKETS_TLS_MAX_CONTEXTS];
+
+/**
+ * @brief Context of the traced HTTP requests
+ */
+typedef struct {
+    http_response_cb_t response;   /**< Response callback of the original request */
+    void              *user_data;  /**< User data of the original request */
+    uint64_t           begin;      /**< Timestamp of the beginning of the request */
+    bool               headers;    /**< Response headers received */
+    bool               first_byte; /**< First byte of the response body received */
+} example_trace_http_ctx_t;
+
+/**
+ * @brief Real functions wrapped at link time
+ */
+int __real_zsock_getaddrinfo(const char *host, const char *service, const struct zsock_addrinfo *hints, struct zsock_addrinfo **res);
+int __real_net_context_connect(
+    struct net_context *context, const struct sockaddr *addr, socklen_t addrlen, net_context_connect_cb_t cb, k_timeout_t timeout, void *user_data);
+int __real_mbedtls_ssl_handshake(mbedtls_ssl_context *ssl);
+int __real_http_client_req(int sock, struct http_request *req, int32_t timeout, void *user_data);
+
+#ifndef CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+
+/**
+ * @brief Timer handler, read the cycle counter so that its wrap around is not missed when there is no trace for a long time
+ * @param timer Timer
+ */
+static void
+trace_cycles_timer_handler(struct k_timer *timer) {
+
+    (void)timer;
+
+    example_trace_timestamp();
+}
+
+#endif /* CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER */
+
+mender_err_t
+example_trace_init(void) {
+
+#ifndef CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+    /* Start the timer reading the 32-bit cycle counter, the period is half of its wrap around period */
+    k_timeout_t period = K_MSEC((uint64_t)UINT32_MAX * MSEC_PER_SEC / sys_clock_hw_cycles_per_sec() / 2);
+    example_trace_timestamp();
+    k_timer_start(&trace_cycles_timer, period, period);
+#endif /* CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER */
+
+    return MENDER_OK;
+}
+
+uint64_t
+example_trace_timestamp(void) {
+
+#ifdef CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+    return k_cycle_get_64();
+#else
+    /* The 32-bit cycle counter runs at the hardware clock (SysTick at the CPU clock on Cortex-M), its wrap around is counted */
+    k_spinlock_key_t key    = k_spin_lock(&trace_cycles_lock);
+    uint32_t         cycles = k_cycle_get_32();
+    if (cycles < trace_cycles_last) {
+        trace_cycles_high += (uint64_t)1 << 32;
+    }
+    trace_cycles_last  = cycles;
+    uint64_t timestamp = trace_cycles_high | cycles;
+    k_spin_unlock(&trace_cycles_lock, key);
+    return timestamp;
+#endif /* CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER */
+}
+
+void
+example_trace_record(example_trace_phase_t phase, uint64_t begin) {
+
+    assert(phase < EXAMPLE_TRACE_PHASE_COUNT);
+    uint32_t duration = (uint32_t)MIN(k_cyc_to_us_floor64(example_trace_timestamp() - begin), UINT32_MAX);
+    size_t   bucket   = (0 == duration) ? 0 : MIN((size_t)(32 - __builtin_clz(duration)), EXAMPLE_TRACE_HISTOGRAM_BUCKETS - 1);
+
+    /* Update statistics of the phase */
+    k_spinlock_key_t       key   = k_spin_lock(&trace_lock);
+    example_trace_stats_t *stats = &trace_stats[phase];
+    stats->min                   = ((0 == stats->count) || (duration < stats->min)) ? duration : stats->min;
+    stats->max                   = MAX(duration, stats->max);
+    stats->total += duration;
+    stats->count++;
+    stats->histogram[bucket]++;
+    k_spin_unlock(&trace_lock, key);
+}
+
+void
+example_trace_deployment_status(mender_deployment_status_t status) {
+
+    /* Record duration of the previous status */
+    if (0 != trace_deployment_status_begin) {
+        if (MENDER_DEPLOYMENT_STATUS_DOWNLOADING == trace_deployment_status) {
+            example_trace_record(EXAMPLE_TRACE_PHASE_DOWNLOADING, trace_deployment_status_begin);
+        } else if (MENDER_DEPLOYMENT_STATUS_INSTALLING == trace_deployment_status) {
+            example_trace_record(EXAMPLE_TRACE_PHASE_INSTALLING, trace_deployment_status_begin);
+        }
+    }
+
+    /* Save new status */
+    trace_deployment_status       = status;
+    trace_deployment_status_begin = example_trace_timestamp();
+}
+
+void
+example_trace_reset(void) {
+
+    k_spinlock_key_t key = k_spin_lock(&trace_lock);
+    memset(trace_stats, 0, sizeof(trace_stats));
+    k_spin_unlock(&trace_lock, key);
+}
+
+size_t
+example_trace_inventory(mender_keystore_t *inventory, size_t size) {
+
+    assert(NULL != inventory);
+    static char           names[EXAMPLE_TRACE_PHASE_COUNT][32];
+    static char           values[EXAMPLE_TRACE_PHASE_COUNT][48];
+    example_trace_stats_t stats;
+    size_t                count = 0;
+
+    /* Format summary of each phase */
+    for (size_t phase = 0; (phase < EXAMPLE_TRACE_PHASE_COUNT) && (count < size); phase++) {
+        k_spinlock_key_t key = k_spin_lock(&trace_lock);
+        memcpy(&stats, &trace_stats[phase], sizeof(example_trace_stats_t));
+        k_spin_unlock(&trace_lock, key);
+        if (0 != stats.count) {
+            snprintf(names[phase], sizeof(names[phase]), "trace-%s", trace_phase_names[phase]);
+            snprintf(values[phase],
+                     sizeof(values[phase]),
+                     "count=%u avg=%ums max=%ums",
+                     stats.count,
+                     (uint32_t)(stats.total / stats.count / 1000),
+                     stats.max / 1000);
+            inventory[count].name  = names[phase];
+            inventory[count].value = values[phase];
+            count++;
+        }
+    }
+
+    return count;
+}
+
+int
+__wrap_zsock_getaddrinfo(const char *host, const char *service, const struct zsock_addrinfo *hints, struct zsock_addrinfo **res) {
+
+    uint64_t begin = example_trace_timestamp();
+    int      ret   = __real_zsock_getaddrinfo(host, service, hints, res);
+
+    example_trace_record(EXAMPLE_TRACE_PHASE_DNS, begin);
+
+    return ret;
+}
+
+int
+__wrap_net_context_connect(
+    struct net_context *context, const struct sockaddr *addr, socklen_t addrlen, net_context_connect_cb_t cb, k_timeout_t timeout, void *user_data) {
+
+    uint64_t begin = example_trace_timestamp();
+    int      ret   = __real_net_context_connect(context, addr, addrlen, cb, timeout, user_data);
+
+    /* Only TCP connections are traced */
+    if (SOCK_STREAM == net_context_get_type(context)) {
+        example_trace_record(EXAMPLE_TRACE_PHASE_TCP_CONNECT, begin);
+    }
+
+    return ret;
+}
+
+int
+__wrap_mbedtls_ssl_handshake(mbedtls_ssl_context *ssl) {
+
+    size_t           index = ARRAY_SIZE(trace_tls_handshakes);
+    k_spinlock_key_t key;
+
+    /* Retrieve pending handshake, or start a new one in a free slot */
+    key = k_spin_lock(&trace_lock);
+    for (size_t slot = 0; slot < ARRAY_SIZE(trace_tls_handshakes); slot++) {
+        if (ssl == trace_tls_handshakes[slot].ssl) {
+            index = slot;
+            break;
+        } else if ((NULL == trace_tls_handshakes[slot].ssl) && (index >= ARRAY_SIZE(trace_tls_handshakes))) {
+            index = slot;
+        }
+    }
+    if ((index < ARRAY_SIZE(trace_tls_handshakes)) && (ssl != trace_tls_handshakes[index].ssl)) {
+        trace_tls_handshakes[index].ssl   = ssl;
+        trace_tls_handshakes[index].begin = example_trace_timestamp();
+    }
+    k_spin_unlock(&trace_lock, key);
+
+    /* Perform handshake */
+    int ret = __real_mbedtls_ssl_handshake(ssl);
+
+    /* Record duration when the handshake is done */
+    if ((MBEDTLS_ERR_SSL_WANT_READ != ret) && (MBEDTLS_ERR_SSL_WANT_WRITE != ret) && (index < ARRAY_SIZE(trace_tls_handshakes))) {
+        example_trace_record(EXAMPLE_TRACE_PHASE_TLS_HANDSHAKE, trace_tls_handshakes[index].begin);
+        trace_tls_handshakes[index].ssl = NULL;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief HTTP response callback used to trace the requests
+ * @param rsp HTTP response
+ * @param final_data Indicates if the response is complete
+ * @param user_data Context of the traced request
+ */
+static void
+trace_http_response_cb(struct http_response *rsp, enum http_final_call final_data, void *user_data) {
+
+    example_trace_http_ctx_t *ctx = (example_trace_http_ctx_t *)user_data;
+
+    /* Record response headers and first byte of the body */
+    if ((true != ctx->headers) && ((1 == rsp->body_found) || (1 == rsp->message_complete))) {
+        example_trace_record(EXAMPLE_TRACE_PHASE_HTTP_HEADERS, ctx->begin);
+        ctx->headers = true;
+    }
+    if ((true != ctx->first_byte) && (NULL != rsp->body_frag_start) && (0 != rsp->body_frag_len)) {
+        example_trace_record(EXAMPLE_TRACE_PHASE_HTTP_FIRST_BYTE, ctx->begin);
+        ctx->first_byte = true;
+    }
+
+    /* Invoke original response callback */
+    if (NULL != ctx->response) {
+        ctx->response(rsp, final_data, ctx->user_data);
+    }
+}
+
+int
+__wrap_http_client_req(int sock, struct http_request *req, int32_t timeout, void *user_data) {
+
+    example_trace_http_ctx_t ctx
+        = { .response = req->response, .user_data = user_data, .begin = example_trace_timestamp(), .headers = false, .first_byte = false };
+    example_trace_phase_t phase;
+
+    /* Perform request using the tracing response callback */
+    req->response = trace_http_response_cb;
+    int ret       = __real_http_client_req(sock, req, timeout, &ctx);
+    req->response = ctx.response;
+
+    /* Record duration of the request depending of the API */
+    if (NULL != strstr(req->url, "/authentication/auth_requests")) {
+        phase = EXAMPLE_TRACE_PHASE_AUTHENTICATION;
+    } else if (NULL != strstr(req->url, "/deployments/next")) {
+        phase = EXAMPLE_TRACE_PHASE_DEPLOYMENT_CHECK;
+    } else if ((HTTP_PUT == req->method) && (NULL != strstr(req->url, "/status"))) {
+        phase = EXAMPLE_TRACE_PHASE_STATUS_REPORT;
+    } else if ((HTTP_GET == req->method) && (NULL == strstr(req->url, "/api/devices/"))) {
+        phase = EXAMPLE_TRACE_PHASE_ARTIFACT_DOWNLOAD;
+    } else {
+        phase = EXAMPLE_TRACE_PHASE_HTTP_REQUEST;
+    }
+    example_trace_record(phase, ctx.begin);
+
+    return ret;
+}
+
+#ifdef CONFIG_SHELL
+
+/**
+ * @brief Display statistics and histograms of the phases
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_trace_show(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)argc;
+    (void)argv;
+    example_trace_stats_t stats;
+
+    shell_print(sh, "%-18s %8s %12s %12s %12s", "phase", "count", "min (us)", "avg (us)", "max (us)");
+    for (size_t phase = 0; phase < EXAMPLE_TRACE_PHASE_COUNT; phase++) {
+        k_spinlock_key_t key = k_spin_lock(&trace_lock);
+        memcpy(&stats, &trace_stats[phase], sizeof(example_trace_stats_t));
+        k_spin_unlock(&trace_lock, key);
+        if (0 == stats.count) {
+            continue;
+        }
+        shell_print(sh, "%-18s %8u %12u %12u %12u", trace_phase_names[phase], stats.count, stats.min, (uint32_t)(stats.total / stats.count), stats.max);
+        for (size_t bucket = 0; bucket < EXAMPLE_TRACE_HISTOGRAM_BUCKETS; bucket++) {
+            if (0 != stats.histogram[bucket]) {
+                shell_print(sh, "%18s < %10u us: %u", "", (uint32_t)BIT64_MASK(bucket) + 1, stats.histogram[bucket]);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Reset statistics and histograms of the phases
+ * @param sh Shell instance
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return 0 if the function succeeds, error code otherwise
+ */
+static int
+cmd_trace_reset(const struct shell *sh, size_t argc, char **argv) {
+
+    (void)sh;
+    (void)argc;
+    (void)argv;
+
+    example_trace_reset();
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(trace_cmds,
+                               SHELL_CMD(show, NULL, "Display statistics and histograms of the deployment lifecycle phases", cmd_trace_show),
+                               SHELL_CMD(reset, NULL, "Reset statistics and histograms", cmd_trace_reset),
+                               SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(trace, &trace_cmds, "Deployment lifecycle timing commands", NULL);
+
+#endif /* CONFIG_SHELL */
@@ -28,16 +28,26 @@ LOG_MODULE_REGISTER(mender_stm32l4a6_zephyr_example, LOG_LEVEL_INF);
 #include <zephyr/net/net_mgmt.h>
 #include <zephyr/sys/reboot.h>
 
+#ifdef CONFIG_EXAMPLE_HEALTH_CHECK
+#include <zephyr/storage/flash_map.h>
+#endif /* CONFIG_EXAMPLE_HEALTH_CHECK */
+
+#ifdef CONFIG_SYS_HEAP_RUNTIME_STATS
+#include <zephyr/sys/libc-hooks.h>
+#endif /* CONFIG_SYS_HEAP_RUNTIME_STATS */
+
 #ifdef CONFIG_MENDER_CLIENT_ADD_ON_TROUBLESHOOT
 #ifdef CONFIG_MENDER_CLIENT_TROUBLESHOOT_FILE_TRANSFER
 #include <zephyr/fs/fs.h>
 #include <zephyr/fs/littlefs.h>
 #endif /* CONFIG_MENDER_CLIENT_TROUBLESHOOT_FILE_TRANSFER */
+#ifdef CONFIG_MENDER_CLIENT_TROUBLESHOOT_PORT_FORWARDING
+#include "example-port-forward.h"
+#endif /* CONFIG_MENDER_CLIENT_TROUBLESHOOT_PORT_FORWARDING */
 #endif /* CONFIG_MENDER_CLIENT_ADD_ON_TROUBLESHOOT */
 
 #ifdef CONFIG_LLEXT
-#include <zephyr/llext/llext.h>
-#include <zephyr/llext/buf_loader.h>
+#include "example-llext.h"
 #endif /* CONFIG_LLEXT */
 
 /*
@@ -62,18 +72,68 @@ static const unsigned char ca_certificate[] = {
 #include "mender-shell.h"
 #include "mender-troubleshoot.h"
 
+#include "example-crypto.h"
+
+#ifdef CONFIG_EXAMPLE_AUTH_CACHE
+#include "example-auth-cache.h"
+#endif /* CONFIG_EXAMPLE_AUTH_CACHE */
+#ifdef CONFIG_EXAMPLE_DOWNLOAD_LIMIT
+#include "example-download-limit.h"
+#endif /* CONFIG_EXAMPLE_DOWNLOAD_LIMIT */
+#ifdef CONFIG_EXAMPLE_FLASH_PRE_ERASE
+#include "example-flash.h"
+#endif /* CONFIG_EXAMPLE_FLASH_PRE_ERASE */
+#ifdef CONFIG_EXAMPLE_HEALTH_CHECK
+#include "example-health-check.h"
+#endif /* CONFIG_EXAMPLE_HEALTH_CHECK */
+#ifdef CONFIG_EXAMPLE_PUSH
+#include "example-push.h"
+#endif /* CONFIG_EXAMPLE_PUSH */
+#ifdef CONFIG_EXAMPLE_REBOOT_WINDOW
+#include "example-reboot.h"
+#endif /* CONFIG_EXAMPLE_REBOOT_WINDOW */
+#ifdef CONFIG_EXAMPLE_SHELL_COALESCE
+#include "example-shell-coalesce.h"
+#endif /* CONFIG_EXAMPLE_SHELL_COALESCE */
+#ifdef CONFIG_EXAMPLE_SIDELOAD
+#include "example-sideload.h"
+#endif /* CONFIG_EXAMPLE_SIDELOAD */
+#ifdef CONFIG_EXAMPLE_TRACE
+#include "example-trace.h"
+#endif /* CONFIG_EXAMPLE_TRACE */
+
 /**
  * @brief Mender client events
  */
 static K_EVENT_DEFINE(mender_client_events);
-#define MENDER_CLIENT_EVENT_NETWORK_UP (1 << 0)
-#define MENDER_CLIENT_EVENT_RESTART    (1 << 1)
+#define MENDER_CLIENT_EVENT_NETWORK_UP    (1 << 0)
+#define MENDER_CLIENT_EVENT_RESTART       (1 << 1)
+#define MENDER_CLIENT_EVENT_AUTHENTICATED (1 << 2)
 
 /**
  * @brief Network management callback
  */
 static struct net_mgmt_event_callback mgmt_cb;
 
+/**
+ * @brief Uptime when the network interface is operational and when the mender client is activated, used to log the time to the first request
+ */
+static uint32_t network_up_time   = 0;
+static uint32_t client_ready_time = 0;
+
+#ifdef CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY
+
+/**
+ * @brief Maximum number of inventory entries
+ */
+#ifdef CONFIG_EXAMPLE_TRACE_INVENTORY
+#define INVENTORY_MAX_ENTRIES (8 + EXAMPLE_TRACE_PHASE_COUNT)
+#else
+#define INVENTORY_MAX_ENTRIES (8)
+#endif /* CONFIG_EXAMPLE_TRACE_INVENTORY */
+
+#endif /* CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY */
+
 #ifdef CONFIG_LLEXT
 
 /**
@@ -125,6 +185,11 @@ net_event_handler(struct net_mgmt_event_callback *cb, uint32_t mgmt_event, struc
     /* Print interface information */
     net_if_ipv4_addr_foreach(iface, print_dhcpv4_addr, NULL);
 
+    /* Save the time the network is available the first time */
+    if (0 == network_up_time) {
+        network_up_time = k_uptime_get_32();
+    }
+
     /* Indicate the network is available */
     k_event_post(&mender_client_events, MENDER_CLIENT_EVENT_NETWORK_UP);
 }
@@ -136,12 +201,33 @@ net_event_handler(struct net_mgmt_event_callback *cb, uint32_t mgmt_event, struc
 static mender_err_t
 network_connect_cb(void) {
 
+    static bool first_request = true;
+
     LOG_INF("Mender client connect network");
 
     /* This callback can be used to configure network connection */
     /* Note that the application can connect the network before if required */
     /* This callback only indicates the mender-client requests network access now */
-    /* Nothing to do in this example application just return network is available */
+    /* The mender-client is activated while the DHCP lease is acquired, only the network requests wait until the network interface is operational */
+    if (MENDER_CLIENT_EVENT_NETWORK_UP
+        != (MENDER_CLIENT_EVENT_NETWORK_UP
+            & k_event_wait(&mender_client_events,
+                           MENDER_CLIENT_EVENT_NETWORK_UP | MENDER_CLIENT_EVENT_RESTART,
+                           false,
+                           K_MSEC(CONFIG_EXAMPLE_NETWORK_UP_TIMEOUT)))) {
+        LOG_ERR("Network is not available");
+        return MENDER_FAIL;
+    }
+
+    /* Log time to first request, storage, keys and add-ons are loaded while the lease is acquired */
+    if (true == first_request) {
+        first_request = false;
+        LOG_INF("Time to first request: %u ms (network up after %u ms, mender client activated after %u ms)",
+                k_uptime_get_32(),
+                network_up_time,
+                client_ready_time);
+    }
+
     return MENDER_OK;
 }
 
@@ -180,6 +266,15 @@ authentication_success_cb(void) {
     }
 #endif /* CONFIG_MENDER_CLIENT_ADD_ON_TROUBLESHOOT */
 
+#ifdef CONFIG_EXAMPLE_HEALTH_CHECK
+    /* Wait for the health check pipeline if the image is still pending, the authentication check of the pipeline is released first */
+    /* The image is validated by the pipeline, or the rollback is done if one of the checks fails */
+    k_event_post(&mender_client_events, MENDER_CLIENT_EVENT_AUTHENTICATED);
+    if (MENDER_OK != (ret = example_health_check_wait())) {
+        LOG_ERR("Health check of the image failed");
+        return ret;
+    }
+#else
     /* Validate the image if it is still pending */
     /* Note it is possible to do multiple diagnosic tests before validating the image */
     /* In this example, authentication success with the mender-server is enough */
@@ -187,6 +282,7 @@ authentication_success_cb(void) {
         LOG_ERR("Unable to validate the image");
         return ret;
     }
+#endif /* CONFIG_EXAMPLE_HEALTH_CHECK */
 
     return ret;
 }
@@ -212,10 +308,60 @@ authentication_failure_cb(void) {
 
     /* Restart the application after several authentication failures with the mender-server */
     /* The image has not been confirmed and the bootloader will now rollback to the previous working image */
+    /* This is also done when the health check pipeline is enabled, the authentication with the mender-server is the last of the checks */
     /* Note it is possible to customize this depending of the wanted behavior */
     return (tries >= CONFIG_EXAMPLE_AUTHENTICATION_FAILS_MAX_TRIES) ? MENDER_FAIL : MENDER_OK;
 }
 
+#ifdef CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY
+
+/**
+ * @brief Set mender inventory (this is just an example to illustrate the API)
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+inventory_update(void) {
+
+    mender_keystore_t inventory[INVENTORY_MAX_ENTRIES] = { { .name = "zephyr-rtos", .value = KERNEL_VERSION_STRING },
+                                                           { .name = "mender-mcu-client", .value = mender_client_version() },
+                                                           { .name = "latitude", .value = "45.8325" },
+                                                           { .name = "longitude", .value = "6.864722" },
+#ifdef CONFIG_EXAMPLE_REBOOT_WINDOW
+                                                           { .name = "reboot-window-s", .value = example_reboot_window_str() },
+#endif /* CONFIG_EXAMPLE_REBOOT_WINDOW */
+                                                           { .name = NULL, .value = NULL } };
+    size_t            count                            = 0;
+
+    /* Count static entries */
+    while (NULL != inventory[count].name) {
+        count++;
+    }
+
+#ifdef CONFIG_SYS_HEAP_RUNTIME_STATS
+    /* Append peak usage of the heap */
+    static char             heap_peak_str[11];
+    struct sys_memory_stats heap_stats;
+    if (0 == malloc_runtime_stats_get(&heap_stats)) {
+        snprintf(heap_peak_str, sizeof(heap_peak_str), "%u", (uint32_t)heap_stats.max_allocated_bytes);
+        inventory[count].name    = "heap-peak-bytes";
+        inventory[count++].value = heap_peak_str;
+        inventory[count].name    = NULL;
+        inventory[count].value   = NULL;
+    }
+#endif /* CONFIG_SYS_HEAP_RUNTIME_STATS */
+
+#ifdef CONFIG_EXAMPLE_TRACE_INVENTORY
+    /* Append summary of the deployment lifecycle timings */
+    count += example_trace_inventory(&inventory[count], ARRAY_SIZE(inventory) - count - 1);
+    inventory[count].name  = NULL;
+    inventory[count].value = NULL;
+#endif /* CONFIG_EXAMPLE_TRACE_INVENTORY */
+
+    return mender_inventory_set(inventory);
+}
+
+#endif /* CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY */
+
 /**
  * @brief Deployment status callback
  * @param status Deployment status value
@@ -230,52 +376,55 @@ deployment_status_cb(mender_deployment_status_t status, char *desc) {
     /* We can do something else if required */
     LOG_INF("Deployment status is '%s'", desc);
 
-#ifdef CONFIG_LLEXT
-
-    /* Management of hello-world module */
-    if ((NULL != hello_world_module_data) && (0 != hello_world_module_size)) {
-
-        /* Treatment depending ofthe status */
-        if (MENDER_DEPLOYMENT_STATUS_INSTALLING == status) {
-
-            /* Load hello-world module */
-            struct llext_buf_loader buf_loader = LLEXT_BUF_LOADER(hello_world_module_data, hello_world_module_size);
-            struct llext_loader    *ldr        = &buf_loader.loader;
-            struct llext_load_param ldr_parm   = LLEXT_LOAD_PARAM_DEFAULT;
-            struct llext           *ext;
-            if (0 != llext_load(ldr, "hello-world", &ext, &ldr_parm)) {
-                LOG_ERR("Unable to load module");
-                ret = MENDER_FAIL;
-            } else {
-
-                /* Call hello_world function */
-                void (*hello_world_fn)() = llext_find_sym(&ext->exp_tab, "hello_world");
-                if (NULL != hello_world_fn) {
-                    hello_world_fn();
-                }
-
-                /* Unload module */
-                llext_unload(&ext);
-            }
+#ifdef CONFIG_EXAMPLE_TRACE
+    /* Trace deployment lifecycle */
+    example_trace_deployment_status(status);
+#endif /* CONFIG_EXAMPLE_TRACE */
 
-            /* Release memory */
-            if (NULL != hello_world_module_data) {
-                free(hello_world_module_data);
-                hello_world_module_data = NULL;
-            }
-            hello_world_module_size = 0;
+#ifdef CONFIG_EXAMPLE_FLASH_PRE_ERASE
+    /* Erase the update slot in the background while the download of the artifact is starting */
+    if (MENDER_DEPLOYMENT_STATUS_DOWNLOADING == status) {
+        if (MENDER_OK != example_flash_pre_erase_start()) {
+            LOG_ERR("Unable to start pre-erase of the update slot");
+        }
+    }
+#endif /* CONFIG_EXAMPLE_FLASH_PRE_ERASE */
 
-        } else if (MENDER_DEPLOYMENT_STATUS_FAILURE == status) {
+#ifdef CONFIG_EXAMPLE_DOWNLOAD_LIMIT
+    /* Limit the bandwidth and the CPU used while the artifact is downloaded and written */
+    if (MENDER_DEPLOYMENT_STATUS_DOWNLOADING == status) {
+        example_download_limit_begin();
+    } else {
+        example_download_limit_end();
+    }
+#endif /* CONFIG_EXAMPLE_DOWNLOAD_LIMIT */
 
-            /* Release memory */
-            if (NULL != hello_world_module_data) {
-                free(hello_world_module_data);
-                hello_world_module_data = NULL;
-            }
-            hello_world_module_size = 0;
+#ifdef CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY
+    /* Refresh inventory when the deployment is done */
+    if ((MENDER_DEPLOYMENT_STATUS_REBOOTING == status) || (MENDER_DEPLOYMENT_STATUS_SUCCESS == status) || (MENDER_DEPLOYMENT_STATUS_FAILURE == status)) {
+        if (MENDER_OK != inventory_update()) {
+            LOG_ERR("Unable to set mender inventory");
         }
     }
+#endif /* CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY */
+
+#ifdef CONFIG_EXAMPLE_REBOOT_WINDOW
+    /* Start measurement of the reboot window, it is reported by the new image at startup */
+    if (MENDER_DEPLOYMENT_STATUS_REBOOTING == status) {
+        example_reboot_window_start();
+    }
+#endif /* CONFIG_EXAMPLE_REBOOT_WINDOW */
 
+#ifdef CONFIG_LLEXT
+    /* Release the hello-world module data and abort its installation if the deployment failed */
+    if (MENDER_DEPLOYMENT_STATUS_FAILURE == status) {
+        if (NULL != hello_world_module_data) {
+            free(hello_world_module_data);
+            hello_world_module_data = NULL;
+        }
+        hello_world_module_size = 0;
+        example_llext_install_abort();
+    }
 #endif /* CONFIG_LLEXT */
 
     return ret;
@@ -294,6 +443,113 @@ restart_cb(void) {
     return MENDER_OK;
 }
 
+#ifdef CONFIG_EXAMPLE_HEALTH_CHECK
+
+#ifdef CONFIG_EXAMPLE_HEALTH_CHECK_NETWORK
+
+/**
+ * @brief Network health check
+ * @return MENDER_OK if the network interface is operational, error code otherwise
+ */
+static mender_err_t
+health_check_network_cb(void) {
+
+    /* Wait until the network interface is operational, the wait is bounded so that the health check work queue is released on timeout */
+    if (0 == k_event_wait(&mender_client_events, MENDER_CLIENT_EVENT_NETWORK_UP, false, K_MSEC(CONFIG_EXAMPLE_HEALTH_CHECK_NETWORK_TIMEOUT))) {
+        LOG_ERR("Network interface is not operational");
+        return MENDER_FAIL;
+    }
+
+    return MENDER_OK;
+}
+
+#endif /* CONFIG_EXAMPLE_HEALTH_CHECK_NETWORK */
+
+#ifdef CONFIG_EXAMPLE_HEALTH_CHECK_AUTHENTICATION
+
+/**
+ * @brief Authentication health check
+ * @return MENDER_OK if the mender client is authenticated with the mender-server, error code otherwise
+ */
+static mender_err_t
+health_check_authentication_cb(void) {
+
+    /* Wait until the mender client is authenticated, the image must be able to receive the next deployments before it is validated */
+    if (0 == k_event_wait(&mender_client_events, MENDER_CLIENT_EVENT_AUTHENTICATED, false, K_MSEC(CONFIG_EXAMPLE_HEALTH_CHECK_AUTHENTICATION_TIMEOUT))) {
+        LOG_ERR("Mender client is not authenticated");
+        return MENDER_FAIL;
+    }
+
+    return MENDER_OK;
+}
+
+#endif /* CONFIG_EXAMPLE_HEALTH_CHECK_AUTHENTICATION */
+
+/**
+ * @brief Storage health check
+ * @return MENDER_OK if the storage partition is readable, error code otherwise
+ */
+static mender_err_t
+health_check_storage_cb(void) {
+
+    const struct flash_area *fa;
+    uint8_t                  data[16];
+    int                      err;
+
+    /* Read the beginning of the storage partition */
+    if (0 != (err = flash_area_open(FIXED_PARTITION_ID(storage_partition), &fa))) {
+        LOG_ERR("Unable to open storage partition (err=%d)", err);
+        return MENDER_FAIL;
+    }
+    if (0 != (err = flash_area_read(fa, 0, data, sizeof(data)))) {
+        LOG_ERR("Unable to read storage partition (err=%d)", err);
+    }
+    flash_area_close(fa);
+
+    return (0 == err) ? MENDER_OK : MENDER_FAIL;
+}
+
+/**
+ * @brief Application health check
+ * @return MENDER_OK if the application is working properly, error code otherwise
+ */
+static mender_err_t
+health_check_application_cb(void) {
+
+    /* This callback can be used to perform application specific checks */
+    /* Nothing to do in this example application just return the application is working properly */
+    return MENDER_OK;
+}
+
+/**
+ * @brief Health check done callback
+ * @param status MENDER_OK if all the checks passed, error code otherwise
+ * @return MENDER_OK if the function succeeds, error code otherwise
+ */
+static mender_err_t
+health_check_done_cb(mender_err_t status) {
+
+    mender_err_t ret;
+
+    /* Check result of the pipeline */
+    if (MENDER_OK != status) {
+        /* Restart the application, the image has not been confirmed and the bootloader will now rollback to the previous working image */
+        LOG_ERR("Health check failed, restarting to rollback the image");
+        k_event_post(&mender_client_events, MENDER_CLIENT_EVENT_RESTART);
+        return MENDER_OK;
+    }
+
+    /* Validate the image */
+    if (MENDER_OK != (ret = mender_flash_confirm_image())) {
+        LOG_ERR("Unable to validate the image");
+        return ret;
+    }
+
+    return MENDER_OK;
+}
+
+#endif /* CONFIG_EXAMPLE_HEALTH_CHECK */
+
 #ifdef CONFIG_MENDER_CLIENT_ADD_ON_CONFIGURE
 #ifndef CONFIG_MENDER_CLIENT_CONFIGURE_STORAGE
 
@@ -316,6 +572,11 @@ config_updated_cb(mender_keystore_t *configuration) {
         }
     }
 
+#ifdef CONFIG_EXAMPLE_DOWNLOAD_LIMIT
+    /* Apply the download limits */
+    example_download_limit_configure(configuration);
+#endif /* CONFIG_EXAMPLE_DOWNLOAD_LIMIT */
+
     return MENDER_OK;
 }
 
@@ -462,7 +723,6 @@ hello_world_module_cb(char *id, char *artifact_name, char *type, cJSON *meta_dat
     (void)type;
     (void)meta_data;
     (void)filename;
-    (void)size;
     (void)index;
     void *tmp;
 
@@ -480,6 +740,21 @@ hello_world_module_cb(char *id, char *artifact_name, char *type, cJSON *meta_dat
         hello_world_module_data = tmp;
         memcpy((void *)(((uint8_t *)hello_world_module_data) + hello_world_module_size), data, length);
         hello_world_module_size += length;
+#ifdef CONFIG_EXAMPLE_DOWNLOAD_LIMIT
+        example_download_limit_chunk(length);
+#endif /* CONFIG_EXAMPLE_DOWNLOAD_LIMIT */
+    }
+
+    /* Install hello-world module once it is received, the module data is given to the install work queue and the module remains resident */
+    if ((NULL != hello_world_module_data) && (hello_world_module_size == size)) {
+        tmp                     = hello_world_module_data;
+        hello_world_module_data = NULL;
+        hello_world_module_size = 0;
+        /* The callback returns at once, the success deployment status is deferred until the installation is done and the result is published then */
+        if (MENDER_OK != example_llext_install_start("hello-world", "hello_world", tmp, size)) {
+            LOG_ERR("Unable to install module");
+            return MENDER_FAIL;
+        }
     }
 
     return MENDER_OK;
@@ -494,34 +769,91 @@ hello_world_module_cb(char *id, char *artifact_name, char *type, cJSON *meta_dat
 int
 main(void) {
 
+#ifdef CONFIG_EXAMPLE_TRACE
+    /* Initialize timing instrumentation of the deployment lifecycle */
+    assert(MENDER_OK == example_trace_init());
+#endif /* CONFIG_EXAMPLE_TRACE */
+
+    /* Initialize the crypto backends, the hardware is used only if the known answer tests passed */
+    assert(MENDER_OK == example_crypto_init());
+
+#ifdef CONFIG_EXAMPLE_REBOOT_WINDOW
+    /* Report the reboot window if the device has been restarted to apply an update */
+    uint32_t reboot_window = 0;
+    bool     reboot_window_measured;
+    if ((MENDER_OK == example_reboot_window_stop(&reboot_window, &reboot_window_measured)) && (true == reboot_window_measured)) {
+        LOG_INF("Reboot window: %u s", reboot_window);
+    }
+#endif /* CONFIG_EXAMPLE_REBOOT_WINDOW */
+
+#ifdef CONFIG_EXAMPLE_AUTH_CACHE
+    /* Load the authentication token saved before the reboot, the authentication request is sent to the server if it is not available */
+    if (MENDER_OK != example_auth_cache_init()) {
+        LOG_ERR("Unable to initialize the authentication token cache");
+    }
+#endif /* CONFIG_EXAMPLE_AUTH_CACHE */
+
+#ifdef CONFIG_EXAMPLE_FLASH_PRE_ERASE
+    /* Initialize pre-erase of the update slot, it is started when the image is confirmed */
+    assert(MENDER_OK == example_flash_init());
+#endif /* CONFIG_EXAMPLE_FLASH_PRE_ERASE */
+
+#ifdef CONFIG_LLEXT
+    /* Initialize the work queue installing the LLEXT modules */
+    assert(MENDER_OK == example_llext_init());
+#endif /* CONFIG_LLEXT */
+
+#ifdef CONFIG_EXAMPLE_HEALTH_CHECK
+    /* Start the health check pipeline if the image is still pending */
+    /* The image is validated or the rollback is done within a bounded time, the authentication with the mender-server is checked last */
+    static example_health_check_step_t health_check_steps[]
+        = {
+#ifdef CONFIG_EXAMPLE_HEALTH_CHECK_NETWORK
+              { .name = "network", .run = health_check_network_cb, .timeout = CONFIG_EXAMPLE_HEALTH_CHECK_NETWORK_TIMEOUT },
+#endif /* CONFIG_EXAMPLE_HEALTH_CHECK_NETWORK */
+              { .name = "storage", .run = health_check_storage_cb, .timeout = CONFIG_EXAMPLE_HEALTH_CHECK_STORAGE_TIMEOUT },
+              { .name = "application", .run = health_check_application_cb, .timeout = CONFIG_EXAMPLE_HEALTH_CHECK_APPLICATION_TIMEOUT },
+#ifdef CONFIG_EXAMPLE_HEALTH_CHECK_AUTHENTICATION
+              { .name = "authentication", .run = health_check_authentication_cb, .timeout = CONFIG_EXAMPLE_HEALTH_CHECK_AUTHENTICATION_TIMEOUT },
+#endif /* CONFIG_EXAMPLE_HEALTH_CHECK_AUTHENTICATION */
+          };
+    if (true != mender_flash_is_image_confirmed()) {
+        example_health_check_callbacks_t health_check_callbacks = { .done = health_check_done_cb };
+        assert(MENDER_OK == example_health_check_init(&health_check_callbacks));
+        for (size_t index = 0; index < ARRAY_SIZE(health_check_steps); index++) {
+            assert(MENDER_OK == example_health_check_register(&health_check_steps[index]));
+        }
+        assert(MENDER_OK == example_health_check_run());
+        LOG_INF("Health check pipeline started");
+    }
+#endif /* CONFIG_EXAMPLE_HEALTH_CHECK */
+
     /* Initialize network */
     struct net_if *iface = net_if_get_default();
     assert(NULL != iface);
     net_mgmt_init_event_callback(&mgmt_cb, net_event_handler, NET_EVENT_IPV4_ADDR_ADD);
     net_mgmt_add_event_callback(&mgmt_cb);
+#ifdef CONFIG_NET_DHCPV4
     net_dhcpv4_start(iface);
-
-    /* Wait until the network interface is operational */
-    k_event_wait_all(&mender_client_events, MENDER_CLIENT_EVENT_NETWORK_UP, false, K_FOREVER);
+#else
+    /* Network interface is considered operational immediately without DHCP (static address on native_sim for example) */
+    k_event_post(&mender_client_events, MENDER_CLIENT_EVENT_NETWORK_UP);
+#endif /* CONFIG_NET_DHCPV4 */
 
 #if defined(CONFIG_NET_SOCKETS_SOCKOPT_TLS)
     /* Initialize certificate */
     tls_credential_add(CONFIG_MENDER_NET_CA_CERTIFICATE_TAG, TLS_CREDENTIAL_CA_CERTIFICATE, ca_certificate, sizeof(ca_certificate));
 #endif
 
-    /* Read base MAC address of the device */
+    /* Read base MAC address of the device, it is not available with offloaded sockets */
     char                 mac_address[18];
+    uint8_t              mac[6]   = { 0 };
     struct net_linkaddr *linkaddr = net_if_get_link_addr(iface);
     assert(NULL != linkaddr);
-    snprintf(mac_address,
-             sizeof(mac_address),
-             "%02x:%02x:%02x:%02x:%02x:%02x",
-             linkaddr->addr[0],
-             linkaddr->addr[1],
-             linkaddr->addr[2],
-             linkaddr->addr[3],
-             linkaddr->addr[4],
-             linkaddr->addr[5]);
+    if ((NULL != linkaddr->addr) && (linkaddr->len >= sizeof(mac))) {
+        memcpy(mac, linkaddr->addr, sizeof(mac));
+    }
+    snprintf(mac_address, sizeof(mac_address), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     LOG_INF("MAC address of the device '%s'", mac_address);
 
     /* Retrieve running version of the device */
@@ -553,6 +885,11 @@ main(void) {
     assert(MENDER_OK == mender_client_init(&mender_client_config, &mender_client_callbacks));
     LOG_INF("Mender client initialized");
 
+#ifdef CONFIG_EXAMPLE_SIDELOAD
+    /* Initialize the installation of artifacts from the file system, the deployment statuses are reported to the same callbacks */
+    assert(MENDER_OK == example_sideload_init(&mender_client_callbacks));
+#endif /* CONFIG_EXAMPLE_SIDELOAD */
+
 #ifdef CONFIG_LLEXT
     /* Register LLEXT hello-world module, no reboot after installing the module, no verification of artifact name to check the version of the module */
     assert(MENDER_OK == mender_client_register_artifact_type("hello-world", &hello_world_module_cb, false, NULL));
@@ -586,10 +923,10 @@ main(void) {
                            .read  = file_transfer_read_cb,
                            .write = file_transfer_write_cb,
                            .close = file_transfer_close_cb },
+#endif /* CONFIG_MENDER_CLIENT_TROUBLESHOOT_FILE_TRANSFER */
 #ifdef CONFIG_MENDER_CLIENT_TROUBLESHOOT_PORT_FORWARDING
-        .port_forwarding = { .connect = NULL, .send = NULL, .close = NULL },
+        .port_forwarding = { .connect = example_port_forward_connect, .send = example_port_forward_send, .close = example_port_forward_close },
 #endif /* CONFIG_MENDER_CLIENT_TROUBLESHOOT_PORT_FORWARDING */
-#endif /* CONFIG_MENDER_CLIENT_TROUBLESHOOT_FILE_TRANSFER */
 #ifdef CONFIG_MENDER_CLIENT_TROUBLESHOOT_SHELL
         .shell = { .open = mender_shell_open, .resize = mender_shell_resize, .write = mender_shell_write, .close = mender_shell_close }
 #endif /* CONFIG_MENDER_CLIENT_TROUBLESHOOT_SHELL */
@@ -598,6 +935,14 @@ main(void) {
            == mender_client_register_addon(
                (mender_addon_instance_t *)&mender_troubleshoot_addon_instance, (void *)&mender_troubleshoot_config, (void *)&mender_troubleshoot_callbacks));
     LOG_INF("Mender troubleshoot add-on registered");
+#ifdef CONFIG_MENDER_CLIENT_TROUBLESHOOT_PORT_FORWARDING
+    /* Bridge port forwarding connections to local sockets */
+    assert(MENDER_OK == example_port_forward_init());
+#endif /* CONFIG_MENDER_CLIENT_TROUBLESHOOT_PORT_FORWARDING */
+#ifdef CONFIG_EXAMPLE_SHELL_COALESCE
+    /* Coalesce the output of the troubleshoot shell */
+    assert(MENDER_OK == example_shell_coalesce_init());
+#endif /* CONFIG_EXAMPLE_SHELL_COALESCE */
 #endif /* CONFIG_MENDER_CLIENT_ADD_ON_TROUBLESHOOT */
 
 #ifdef CONFIG_MENDER_CLIENT_ADD_ON_CONFIGURE
@@ -612,28 +957,36 @@ main(void) {
             LOG_INF("Key=%s, value=%s", configuration[index].name, configuration[index].value);
             index++;
         }
+#ifdef CONFIG_EXAMPLE_DOWNLOAD_LIMIT
+        /* Apply the download limits saved in the device configuration */
+        example_download_limit_configure(configuration);
+#endif /* CONFIG_EXAMPLE_DOWNLOAD_LIMIT */
         mender_utils_keystore_delete(configuration);
     }
 #endif /* CONFIG_MENDER_CLIENT_ADD_ON_CONFIGURE */
 
 #ifdef CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY
-    /* Set mender inventory (this is just an example to illustrate the API) */
-    mender_keystore_t inventory[] = { { .name = "zephyr-rtos", .value = KERNEL_VERSION_STRING },
-                                      { .name = "mender-mcu-client", .value = mender_client_version() },
-                                      { .name = "latitude", .value = "45.8325" },
-                                      { .name = "longitude", .value = "6.864722" },
-                                      { .name = NULL, .value = NULL } };
-    if (MENDER_OK != mender_inventory_set(inventory)) {
+    /* Set mender inventory */
+    if (MENDER_OK != inventory_update()) {
         LOG_ERR("Unable to set mender inventory");
     }
 #endif /* CONFIG_MENDER_CLIENT_ADD_ON_INVENTORY */
 
-    /* Finally activate mender client */
+    /* Finally activate mender client, the network requests wait until the network interface is operational */
+    /* The time is saved before the activation because the first request may be done before mender_client_activate returns */
+    client_ready_time = k_uptime_get_32();
     if (MENDER_OK != mender_client_activate()) {
         LOG_ERR("Unable to activate mender-client");
         goto RELEASE;
     }
 
+#ifdef CONFIG_EXAMPLE_PUSH
+    /* Start the push channel, deployments are checked at once when notified by the server */
+    if (MENDER_OK != example_push_init(mac_address)) {
+        LOG_ERR("Unable to start the push channel");
+    }
+#endif /* CONFIG_EXAMPLE_PUSH */
+
     /* Wait for mender-mcu-client events */
     k_event_wait_all(&mender_client_events, MENDER_CLIENT_EVENT_RESTART, false, K_FOREVER);
 
@@ -643,8 +996,9 @@ RELEASE:
     mender_client_deactivate();
     mender_client_exit();
 
-    /* Restart */
+    /* Restart, pending logs are flushed before */
     LOG_INF("Restarting system");
+    LOG_PANIC();
     sys_reboot(SYS_REBOOT_WARM);
 
     return 0;
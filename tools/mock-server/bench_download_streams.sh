@@ -0,0 +1,53 @@
+#!/bin/bash
+# @file      bench_download_streams.sh
+# @brief     Measure the download throughput and the RAM used by the download streams for several numbers of parallel streams
+#
+# Copyright joelguittet and mender-mcu-client contributors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Usage: bench_download_streams.sh <application directory> [output directory]
+# The application is built for native_sim without streams and with 1, 2 and 4 streams, and a full deployment cycle is run with run_e2e.sh, the same
+# requirements apply. The round trip time of the link is simulated by the mock server, E2E_LATENCY_MS defaults to 50 ms.
+# The RAM used by the download streams is the size of the stacks, threads, slots and reception buffers in the ELF file, the TLS contexts are
+# allocated in the mbedTLS heap when the artifact is downloaded using HTTPS and are not included.
+
+set -e
+
+APP_DIR=${1:?"Usage: $0 <application directory> [output directory]"}
+OUTPUT_DIR=${2:-"build-download-streams"}
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+STREAMS="0 1 2 4"
+export E2E_LATENCY_MS=${E2E_LATENCY_MS:-50}
+
+mkdir -p "${OUTPUT_DIR}"
+for COUNT in ${STREAMS}; do
+    BUILD_DIR="${OUTPUT_DIR}/streams-${COUNT}"
+    if [ "${COUNT}" -eq 0 ]; then
+        OPTIONS="-DCONFIG_EXAMPLE_DOWNLOAD_STREAMS=n"
+    else
+        OPTIONS="-DCONFIG_EXAMPLE_DOWNLOAD_STREAMS=y -DCONFIG_EXAMPLE_DOWNLOAD_STREAMS_COUNT=${COUNT}"
+    fi
+    west build -p -b native_sim -d "${BUILD_DIR}" "${APP_DIR}" -- ${OPTIONS} > "${BUILD_DIR}.log" 2>&1
+    nm -S -t d "${BUILD_DIR}/zephyr/zephyr.elf" | awk '$4 ~ /^download_streams/ { sum += $2 } END { print sum + 0 }' > "${BUILD_DIR}/streams-ram.txt"
+    "${SCRIPT_DIR}/run_e2e.sh" "${BUILD_DIR}" "${BUILD_DIR}/e2e-results.json" > /dev/null
+done
+
+# Summary, the throughput of the range requests is used when the artifact is downloaded with streams
+printf "%-10s %14s %12s\n" "streams" "RAM (B)" "KB/s"
+for COUNT in ${STREAMS}; do
+    BUILD_DIR="${OUTPUT_DIR}/streams-${COUNT}"
+    KBPS=$(python3 -c "import json, sys; r = json.load(open(sys.argv[1])); print((r['range_download'] or r['downloads'][-1])['kbps'])" \
+        "${BUILD_DIR}/e2e-results.json")
+    printf "%-10s %14s %12s\n" "${COUNT}" "$(cat "${BUILD_DIR}/streams-ram.txt")" "${KBPS}"
+done
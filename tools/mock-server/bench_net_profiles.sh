@@ -0,0 +1,46 @@
+#!/bin/bash
+# @file      bench_net_profiles.sh
+# @brief     Measure the download throughput and the RAM used by the network buffers for each network memory profile
+#
+# Copyright joelguittet and mender-mcu-client contributors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Usage: bench_net_profiles.sh <application directory> [output directory]
+# The application is built for native_sim with each profile and a full deployment cycle is run with run_e2e.sh, the same requirements apply.
+# The RAM used by the network buffers is the size of the packet slabs and buffer pools in the ELF file.
+# The throughput is measured on native_sim over TAP only, it is not representative of the W5500 and of the STM32L4A6.
+
+set -e
+
+APP_DIR=${1:?"Usage: $0 <application directory> [output directory]"}
+OUTPUT_DIR=${2:-"build-net-profiles"}
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+PROFILES="DEFAULT LOW_RAM DOWNLOAD"
+
+mkdir -p "${OUTPUT_DIR}"
+for PROFILE in ${PROFILES}; do
+    BUILD_DIR="${OUTPUT_DIR}/${PROFILE,,}"
+    west build -p -b native_sim -d "${BUILD_DIR}" "${APP_DIR}" -- -DCONFIG_EXAMPLE_NET_PROFILE_${PROFILE}=y > "${BUILD_DIR}.log" 2>&1
+    nm -S -t d "${BUILD_DIR}/zephyr/zephyr.elf" | awk '$4 ~ /(^|_)(rx|tx)_(pkts|bufs)$/ { sum += $2 } END { print sum }' > "${BUILD_DIR}/net-ram.txt"
+    "${SCRIPT_DIR}/run_e2e.sh" "${BUILD_DIR}" "${BUILD_DIR}/e2e-results.json" > /dev/null
+done
+
+# Summary
+printf "%-10s %14s %12s\n" "profile" "buffers (B)" "KB/s"
+for PROFILE in ${PROFILES}; do
+    BUILD_DIR="${OUTPUT_DIR}/${PROFILE,,}"
+    KBPS=$(python3 -c "import json, sys; print(json.load(open(sys.argv[1]))['downloads'][-1]['kbps'])" "${BUILD_DIR}/e2e-results.json")
+    printf "%-10s %14s %12s\n" "${PROFILE,,}" "$(cat "${BUILD_DIR}/net-ram.txt")" "${KBPS}"
+done
+echo "Measured on native_sim over TAP, not representative of the W5500 and of the STM32L4A6"
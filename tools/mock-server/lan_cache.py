@@ -0,0 +1,142 @@
+# @file      lan_cache.py
+# @brief     Minimal cache of the artifacts for the local network, each artifact is downloaded once from the server
+#
+# Copyright joelguittet and mender-mcu-client contributors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+
+import argparse
+import hashlib
+import json
+import os
+import threading
+import time
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse, urlunparse
+
+
+class LanCache(ThreadingHTTPServer):
+    """Cache state, shared by the request handlers."""
+
+    def __init__(self, address, directory):
+        super().__init__(address, LanCacheHandler)
+        self.directory = directory
+        self.lock = threading.Lock()
+        self.key_locks = {}
+        self.stats = {"probes": 0, "origin_downloads": 0, "origin_bytes": 0, "served": 0, "served_bytes": 0}
+
+    def key(self, url):
+        """Cache key of an artifact, the query is ignored because the URLs of the artifacts are signed for each device."""
+        return hashlib.sha256(urlunparse(urlparse(url)._replace(query="", fragment="")).encode()).hexdigest()
+
+    def path(self, url):
+        return os.path.join(self.directory, self.key(url))
+
+    def fetch(self, url):
+        """Download the artifact from the server if it is not already in the cache, concurrent probes of the same artifact wait for the download."""
+        with self.lock:
+            key_lock = self.key_locks.setdefault(self.key(url), threading.Lock())
+        with key_lock:
+            path = self.path(url)
+            if os.path.exists(path):
+                return True
+            try:
+                with urllib.request.urlopen(url, timeout=60) as response, open(path + ".part", "wb") as f:
+                    while chunk := response.read(65536):
+                        f.write(chunk)
+            except OSError as e:
+                print("Unable to download %s: %s" % (url, e), flush=True)
+                return False
+            os.replace(path + ".part", path)
+            with self.lock:
+                self.stats["origin_downloads"] += 1
+                self.stats["origin_bytes"] += os.path.getsize(path)
+            return True
+
+
+class LanCacheHandler(BaseHTTPRequestHandler):
+    """Handle the probe and download requests of the devices."""
+
+    protocol_version = "HTTP/1.1"
+
+    def send(self, code, body=b"", content_type="application/json"):
+        # Errors have a body, the device must not take it for the artifact
+        if code >= 400 and not body:
+            body = json.dumps({"error": self.responses[code][0]}).encode()
+        self.send_response(code)
+        if body:
+            self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if body:
+            self.wfile.write(body)
+
+    def do_GET(self):
+        request = urlparse(self.path)
+        url = parse_qs(request.query).get("url", [None])[0]
+        if request.path == "/stats":
+            with self.server.lock:
+                self.send(200, json.dumps(self.server.stats).encode())
+        elif url is None or not url.startswith("http"):
+            self.send(400)
+        elif request.path == "/probe":
+            with self.server.lock:
+                self.server.stats["probes"] += 1
+            self.send(200 if self.server.fetch(url) else 502)
+        elif request.path == "/artifact":
+            self.send_artifact(url)
+        else:
+            self.send(404)
+
+    def send_artifact(self, url):
+        path = self.server.path(url)
+        if not os.path.exists(path):
+            self.send(404)
+            return
+        size = os.path.getsize(path)
+        self.send_response(200)
+        self.send_header("Content-Type", "application/vnd.mender-artifact")
+        self.send_header("Content-Length", str(size))
+        self.end_headers()
+        with open(path, "rb") as f:
+            while chunk := f.read(4096):
+                self.wfile.write(chunk)
+        with self.server.lock:
+            self.server.stats["served"] += 1
+            self.server.stats["served_bytes"] += size
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Minimal cache of the artifacts for the local network")
+    parser.add_argument("--address", default="0.0.0.0", help="listening address")
+    parser.add_argument("--port", type=int, default=8081, help="listening port")
+    parser.add_argument("--directory", default="lan-cache", help="directory where the artifacts are saved")
+    args = parser.parse_args()
+
+    os.makedirs(args.directory, exist_ok=True)
+    cache = LanCache((args.address, args.port), args.directory)
+    print("LAN cache listening on %s:%d" % (args.address, args.port), flush=True)
+    start = time.monotonic()
+    try:
+        cache.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+    # The artifacts downloaded from the server versus the artifacts served to the devices
+    print("Statistics after %d s: %s" % (time.monotonic() - start, json.dumps(cache.stats)), flush=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,336 @@
+# @file      mock_mender_server.py
+# @brief     Minimal mock of the Mender server used for end-to-end performance tests
+#
+# Copyright joelguittet and mender-mcu-client contributors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import argparse
+import json
+import os
+import re
+import socket
+import threading
+import time
+import uuid
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import urlparse
+
+# Token given to the device, also used to authenticate to the push server
+MOCK_JWT = b"mock.jwt.token"
+
+
+class MockMenderServer(ThreadingHTTPServer):
+    """Mock server state, shared by the request handlers."""
+
+    def __init__(self, address, artifact, artifact_name, device_type):
+        super().__init__(address, MockMenderHandler)
+        self.artifact = artifact
+        self.artifact_name = artifact_name
+        self.device_type = device_type
+        self.deployment_id = str(uuid.uuid4())
+        self.deployment_served = False
+        self.deployment_available = threading.Event()
+        self.push_clients = []
+        self.start = time.monotonic()
+        self.lock = threading.Lock()
+        self.done = threading.Event()
+        self.exit_on_status = None
+        self.exit_status_received = False
+        self.wait_heap_peak = False
+        self.heap_peak = None
+        self.latency_ms = 0
+        self.results = {
+            "time_to_auth_ms": None,
+            "auth_requests": 0,
+            "downloads": [],
+            "statuses": [],
+            "inventory": {},
+            "configuration": {},
+            "range_download": None,
+            "deployment_published_ms": None,
+            "download_start_ms": None,
+        }
+
+    def elapsed_ms(self):
+        return int((time.monotonic() - self.start) * 1000)
+
+    def check_done(self):
+        """The test is done when the expected status is received, and the peak heap usage of the deployment if it is waited for."""
+        with self.lock:
+            if self.exit_status_received and (not self.wait_heap_peak or self.heap_peak is not None):
+                self.done.set()
+
+    def publish_deployment(self):
+        """Make the deployment available and notify the devices connected to the push server."""
+        with self.lock:
+            self.results["deployment_published_ms"] = self.elapsed_ms()
+            self.deployment_available.set()
+            for client in self.push_clients:
+                try:
+                    client.sendall(b"DEPLOYMENT\n")
+                except OSError:
+                    pass
+
+    def serve_push(self, address):
+        """Accept the connections of the devices to the push server."""
+        listener = socket.create_server(address)
+        while True:
+            client, _ = listener.accept()
+            threading.Thread(target=self.handle_push, args=(client,), daemon=True).start()
+
+    def handle_push(self, client):
+        """Answer the ping messages of a device authenticated with its token, the deployment is notified immediately if it is already available."""
+        with client, client.makefile("rb") as lines:
+            try:
+                hello = lines.readline().split()
+            except OSError:
+                return
+            if len(hello) != 3 or hello[0] != b"HELLO" or hello[2] != MOCK_JWT:
+                print("[%8d ms] push: invalid hello, closing the connection" % self.elapsed_ms(), flush=True)
+                return
+            print("[%8d ms] push: HELLO %s" % (self.elapsed_ms(), hello[1].decode(errors="replace")), flush=True)
+            with self.lock:
+                self.push_clients.append(client)
+                if self.deployment_available.is_set():
+                    client.sendall(b"DEPLOYMENT\n")
+            try:
+                for line in lines:
+                    print("[%8d ms] push: %s" % (self.elapsed_ms(), line.decode(errors="replace").strip()), flush=True)
+                    if line.startswith(b"PING"):
+                        client.sendall(b"PONG\n")
+            except OSError:
+                pass
+            with self.lock:
+                self.push_clients.remove(client)
+
+
+class MockMenderHandler(BaseHTTPRequestHandler):
+    """Handle the device API requests of the Mender MCU client."""
+
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, format, *args):
+        print("[%8d ms] %s" % (self.server.elapsed_ms(), format % args), flush=True)
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length", 0))
+        return self.rfile.read(length) if length > 0 else b""
+
+    def send_response(self, code, message=None):
+        # Simulate the round trip time of the link before each response
+        if self.server.latency_ms > 0:
+            time.sleep(self.server.latency_ms / 1000)
+        super().send_response(code, message)
+
+    def send(self, code, body=b"", content_type="application/json"):
+        self.send_response(code)
+        if body:
+            self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if body:
+            self.wfile.write(body)
+
+    def deployment(self):
+        """Return the pending deployment, only if it has not been served yet."""
+        if self.server.artifact is None or self.server.deployment_served or not self.server.deployment_available.is_set():
+            return None
+        self.server.deployment_served = True
+        host = self.headers.get("Host")
+        return {
+            "id": self.server.deployment_id,
+            "artifact": {
+                "artifact_name": self.server.artifact_name,
+                "source": {"uri": "http://%s/artifacts/%s" % (host, self.server.deployment_id), "expire": "2099-01-01T00:00:00Z"},
+                "device_types_compatible": [self.server.device_type],
+            },
+        }
+
+    def do_GET(self):
+        path = urlparse(self.path).path
+        if path.endswith("/deployments/device/deployments/next"):
+            self.read_body()
+            deployment = self.deployment()
+            if deployment is None:
+                self.send(204)
+            else:
+                self.send(200, json.dumps(deployment).encode())
+        elif path.startswith("/artifacts/"):
+            self.send_artifact()
+        elif path.endswith("/deviceconfig/configuration"):
+            self.send(200, json.dumps(self.server.results["configuration"]).encode())
+        else:
+            self.send(404)
+
+    def do_POST(self):
+        path = urlparse(self.path).path
+        body = self.read_body()
+        if path.endswith("/authentication/auth_requests"):
+            with self.server.lock:
+                self.server.results["auth_requests"] += 1
+                if self.server.results["time_to_auth_ms"] is None:
+                    self.server.results["time_to_auth_ms"] = self.server.elapsed_ms()
+            self.send(200, MOCK_JWT, "application/jwt")
+        elif path.endswith("/deployments/device/deployments/next"):
+            deployment = self.deployment()
+            if deployment is None:
+                self.send(204)
+            else:
+                self.send(200, json.dumps(deployment).encode())
+        else:
+            self.send(404)
+
+    def do_PUT(self):
+        path = urlparse(self.path).path
+        body = self.read_body()
+        match = re.search(r"/deployments/device/deployments/([^/]+)/status$", path)
+        if match is not None:
+            status = json.loads(body or b"{}").get("status")
+            with self.server.lock:
+                self.server.results["statuses"].append({"status": status, "time_ms": self.server.elapsed_ms()})
+            self.send(204)
+            if status is not None and status == self.server.exit_on_status:
+                with self.server.lock:
+                    self.server.exit_status_received = True
+                self.server.check_done()
+        elif path.endswith("/inventory/device/attributes"):
+            self.update_inventory(body)
+        elif path.endswith("/deviceconfig/configuration"):
+            with self.server.lock:
+                self.server.results["configuration"] = json.loads(body or b"{}")
+            self.send(204)
+        else:
+            self.send(404)
+
+    def do_PATCH(self):
+        path = urlparse(self.path).path
+        body = self.read_body()
+        if path.endswith("/inventory/device/attributes"):
+            self.update_inventory(body)
+        else:
+            self.send(404)
+
+    def update_inventory(self, body):
+        with self.server.lock:
+            for attribute in json.loads(body or b"[]"):
+                self.server.results["inventory"][attribute["name"]] = attribute["value"]
+                # Peak heap usage of the deployment, sent by the device once the artifact is downloaded and before it reboots
+                if attribute["name"] == "heap-peak-bytes" and self.server.results["download_start_ms"] is not None:
+                    self.server.heap_peak = attribute["value"]
+        self.send(200)
+        self.server.check_done()
+
+    def send_artifact(self):
+        artifact = self.server.artifact
+        with self.server.lock:
+            if self.server.results["download_start_ms"] is None:
+                self.server.results["download_start_ms"] = self.server.elapsed_ms()
+        match = re.fullmatch(r"bytes=(\d+)-(\d*)", self.headers.get("Range", ""))
+        if match is not None:
+            self.send_artifact_range(int(match.group(1)), int(match.group(2)) if match.group(2) else len(artifact) - 1)
+            return
+        self.send_response(200)
+        self.send_header("Content-Type", "application/vnd.mender-artifact")
+        self.send_header("Content-Length", str(len(artifact)))
+        self.end_headers()
+        start = time.monotonic()
+        for offset in range(0, len(artifact), 4096):
+            self.wfile.write(artifact[offset : offset + 4096])
+        duration = time.monotonic() - start
+        with self.server.lock:
+            self.server.results["downloads"].append(
+                {"bytes": len(artifact), "duration_ms": int(duration * 1000), "kbps": round(len(artifact) / 1024 / max(duration, 1e-6), 1)}
+            )
+
+    def send_artifact_range(self, first, last):
+        """Send a range of the artifact, the ranges requested by all the connections are aggregated in a single download."""
+        artifact = self.server.artifact
+        start = time.monotonic()
+        if first >= len(artifact):
+            self.send_response(416)
+            self.send_header("Content-Range", "bytes */%d" % len(artifact))
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+            return
+        last = min(last, len(artifact) - 1)
+        self.send_response(206)
+        self.send_header("Content-Type", "application/vnd.mender-artifact")
+        self.send_header("Content-Range", "bytes %d-%d/%d" % (first, last, len(artifact)))
+        self.send_header("Content-Length", str(last - first + 1))
+        self.end_headers()
+        self.wfile.write(artifact[first : last + 1])
+        end = time.monotonic()
+        with self.server.lock:
+            download = self.server.results["range_download"]
+            if download is None:
+                download = self.server.results["range_download"] = {"requests": 0, "bytes": 0, "start": start}
+            download["requests"] += 1
+            download["bytes"] += last - first + 1
+            duration = end - download["start"]
+            download["duration_ms"] = int(duration * 1000)
+            download["kbps"] = round(download["bytes"] / 1024 / max(duration, 1e-6), 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mock of the Mender server for end-to-end performance tests")
+    parser.add_argument("--address", default="0.0.0.0", help="listening address")
+    parser.add_argument("--port", type=int, default=8080, help="listening port")
+    parser.add_argument("--artifact", help="artifact to be deployed, no deployment is served if not provided")
+    parser.add_argument("--artifact-name", default="mock-artifact", help="name of the artifact to be deployed")
+    parser.add_argument("--device-type", default="mender-stm32l4a6-zephyr-example", help="device type of the artifact to be deployed")
+    parser.add_argument("--exit-on-status", help="exit when the device reports this deployment status, 'success' for example")
+    parser.add_argument("--wait-heap-peak", action="store_true", help="also wait for the peak heap usage of the deployment before exiting")
+    parser.add_argument("--timeout", type=int, default=600, help="maximum duration of the test in seconds")
+    parser.add_argument("--results", default="results.json", help="file where the results are saved")
+    parser.add_argument("--push-port", type=int, default=0, help="port of the push server notifying the devices of new deployments, 0 to disable")
+    parser.add_argument("--deployment-delay", type=int, default=0, help="delay in seconds before the deployment is available")
+    parser.add_argument("--latency-ms", type=int, default=0, help="delay before each response, simulating the round trip time of the link")
+    args = parser.parse_args()
+
+    artifact = None
+    if args.artifact is not None:
+        with open(args.artifact, "rb") as f:
+            artifact = f.read()
+
+    server = MockMenderServer((args.address, args.port), artifact, args.artifact_name, args.device_type)
+    server.exit_on_status = args.exit_on_status
+    server.wait_heap_peak = args.wait_heap_peak
+    server.latency_ms = args.latency_ms
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    if args.push_port != 0:
+        threading.Thread(target=server.serve_push, args=((args.address, args.push_port),), daemon=True).start()
+    threading.Timer(args.deployment_delay, server.publish_deployment).start()
+    print("Mock Mender server listening on %s:%d" % (args.address, args.port), flush=True)
+
+    # Wait for the expected status or for the timeout
+    completed = server.done.wait(args.timeout)
+    server.shutdown()
+
+    # Save results, peak heap usage is reported by the device in the inventory
+    results = server.results
+    results["completed"] = completed
+    results["heap_peak_bytes"] = server.heap_peak
+    if results["deployment_published_ms"] is not None and results["download_start_ms"] is not None:
+        results["time_to_download_ms"] = results["download_start_ms"] - results["deployment_published_ms"]
+    if results["range_download"] is not None:
+        del results["range_download"]["start"]
+    with open(args.results, "w") as f:
+        json.dump(results, f, indent=2)
+    print(json.dumps(results, indent=2), flush=True)
+
+    os._exit(0 if completed or args.exit_on_status is None else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,52 @@
+#!/bin/bash
+# @file      run_e2e.sh
+# @brief     Run a full deployment cycle of the native_sim application against the mock Mender server
+#
+# Copyright joelguittet and mender-mcu-client contributors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Usage: run_e2e.sh <build directory> [results file]
+# The application must have been built for native_sim, the zeth interface must have been created using the net-setup.sh script of Zephyr net-tools,
+# and mender-artifact must be available in the PATH. The deployment is done when the device reports the 'rebooting' status, because there is no
+# bootloader to apply the update on native_sim, and the peak heap usage of the deployment has been sent by the device in the inventory.
+
+set -e
+
+BUILD_DIR=${1:?"Usage: $0 <build directory> [results file]"}
+RESULTS=${2:-"${BUILD_DIR}/e2e-results.json"}
+TIMEOUT=${E2E_TIMEOUT:-600}
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+
+# Create artifact from the application binary
+mender-artifact write rootfs-image --compression none --device-type mender-stm32l4a6-zephyr-example --artifact-name mender-stm32l4a6-zephyr-example-e2e \
+    --output-path "${BUILD_DIR}/e2e.mender" --file "${BUILD_DIR}/zephyr/zephyr.bin"
+
+# Start the mock server on the host side of the zeth interface
+python3 "${SCRIPT_DIR}/mock_mender_server.py" --address 192.0.2.2 --port 8080 --artifact "${BUILD_DIR}/e2e.mender" \
+    --artifact-name mender-stm32l4a6-zephyr-example-e2e --exit-on-status rebooting --wait-heap-peak --timeout "${TIMEOUT}" --results "${RESULTS}" \
+    --latency-ms "${E2E_LATENCY_MS:-0}" --push-port 8082 --deployment-delay "${E2E_DEPLOYMENT_DELAY:-0}" &
+SERVER_PID=$!
+sleep 1
+
+# Start the application, it is stopped when the mock server exits
+"${BUILD_DIR}/zephyr/zephyr.exe" --stop_at="${TIMEOUT}" > "${BUILD_DIR}/e2e-device.log" 2>&1 &
+DEVICE_PID=$!
+
+# Wait for the end of the deployment
+STATUS=0
+wait ${SERVER_PID} || STATUS=$?
+kill ${DEVICE_PID} 2> /dev/null || true
+wait ${DEVICE_PID} 2> /dev/null || true
+
+exit ${STATUS}
@@ -0,0 +1,125 @@
+# @file      bench_deflate.py
+# @brief     Estimate the gain and the cost of permessage-deflate on recorded troubleshoot sessions
+#
+# Copyright joelguittet and mender-mcu-client contributors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+
+# Usage: bench_deflate.py [options] <recorded session> [recorded session ...]
+# A recorded session is the raw output of a troubleshoot shell session, or a file transferred from the device, the content of the log ring for
+# example. The session is split in messages of --message-size bytes, which is the size of the output coalescing buffer for the shell or the
+# size of the chunks for the file transfer, and each message is packed as a troubleshoot msgpack message. The messages are compressed as
+# permessage-deflate would do (RFC 7692), with and without context takeover, for each window size. The memory of the compressor is given by the
+# zlib formula, the CPU time is measured on the host and must be scaled to the device.
+
+import argparse
+import os
+import struct
+import time
+import zlib
+
+# Trailer removed from each compressed message by permessage-deflate
+DEFLATE_TRAILER = b"\x00\x00\xff\xff"
+
+
+def msgpack_length(length, fix, fix_max, codes):
+    """Header of a msgpack map, array, string or binary, with the smallest length encoding as msgpack-c does."""
+    if fix is not None and length <= fix_max:
+        return struct.pack(">B", fix | length)
+    for code, fmt, limit in codes:
+        if length <= limit:
+            return struct.pack(">B" + fmt, code, length)
+    raise ValueError("length %d too large for msgpack" % length)
+
+
+def msgpack(value):
+    """Minimal msgpack encoder, enough for the troubleshoot protocol messages, with the compact encodings of msgpack-c."""
+    if isinstance(value, dict):
+        header = msgpack_length(len(value), 0x80, 0x0F, ((0xDE, "H", 0xFFFF), (0xDF, "I", 0xFFFFFFFF)))
+        return header + b"".join(msgpack(k) + msgpack(v) for k, v in value.items())
+    if isinstance(value, (list, tuple)):
+        header = msgpack_length(len(value), 0x90, 0x0F, ((0xDC, "H", 0xFFFF), (0xDD, "I", 0xFFFFFFFF)))
+        return header + b"".join(msgpack(v) for v in value)
+    if isinstance(value, bool):
+        return b"\xc3" if value else b"\xc2"
+    if isinstance(value, int):
+        if 0 <= value <= 0x7F:
+            return struct.pack(">B", value)
+        if -32 <= value < 0:
+            return struct.pack(">b", value)
+        if value >= 0:
+            for code, fmt, limit in ((0xCC, "B", 0xFF), (0xCD, "H", 0xFFFF), (0xCE, "I", 0xFFFFFFFF), (0xCF, "Q", 0xFFFFFFFFFFFFFFFF)):
+                if value <= limit:
+                    return struct.pack(">B" + fmt, code, value)
+        for code, fmt, limit in ((0xD0, "b", 0x80), (0xD1, "h", 0x8000), (0xD2, "i", 0x80000000), (0xD3, "q", 0x8000000000000000)):
+            if -limit <= value:
+                return struct.pack(">B" + fmt, code, value)
+        raise ValueError("integer %d too large for msgpack" % value)
+    if isinstance(value, str):
+        data = value.encode()
+        return msgpack_length(len(data), 0xA0, 0x1F, ((0xD9, "B", 0xFF), (0xDA, "H", 0xFFFF), (0xDB, "I", 0xFFFFFFFF))) + data
+    return msgpack_length(len(value), None, 0, ((0xC4, "B", 0xFF), (0xC5, "H", 0xFFFF), (0xC6, "I", 0xFFFFFFFF))) + bytes(value)
+
+
+def messages(data, size, proto, typ):
+    """Split a session in messages packed as troubleshoot messages, the header is repeated in each message."""
+    sid = "2b1b37a6-8d1c-4c39-8b7e-2f6e2e1a7c4d"
+    for offset in range(0, len(data), size):
+        yield msgpack({"hdr": {"proto": proto, "typ": typ, "sid": sid, "props": {"offset": offset}}, "body": data[offset : offset + size]})
+
+
+def compress(frames, wbits, mem_level, takeover):
+    """Compress the messages as permessage-deflate, return the number of bytes and the CPU time in seconds."""
+    total = 0
+    start = time.process_time()
+    compressor = None
+    for frame in frames:
+        if compressor is None or not takeover:
+            compressor = zlib.compressobj(zlib.Z_DEFAULT_COMPRESSION, zlib.DEFLATED, -wbits, mem_level)
+        out = compressor.compress(frame) + compressor.flush(zlib.Z_SYNC_FLUSH)
+        total += len(out) - len(DEFLATE_TRAILER) if out.endswith(DEFLATE_TRAILER) else len(out)
+    return total, time.process_time() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Estimate the gain and the cost of permessage-deflate on recorded troubleshoot sessions")
+    parser.add_argument("sessions", nargs="+", help="recorded sessions, raw shell output or transferred files")
+    parser.add_argument("--message-size", type=int, default=1024, help="size of the messages in bytes")
+    parser.add_argument("--type", choices=["shell", "file"], default="shell", help="type of the troubleshoot messages")
+    parser.add_argument("--window-bits", default="9,10,11,12,15", help="window sizes to evaluate, as log2 of the window in bytes")
+    parser.add_argument("--mem-level", type=int, default=1, help="zlib memory level of the compressor, from 1 to 9")
+    args = parser.parse_args()
+
+    proto, typ = (1, "shell") if args.type == "shell" else (4, "put_file")
+    print("%-24s %-10s %5s %10s %10s %7s %12s %10s" % ("session", "context", "wbits", "raw (B)", "wire (B)", "ratio", "memory (B)", "us/KB"))
+    for session in args.sessions:
+        with open(session, "rb") as f:
+            frames = list(messages(f.read(), args.message_size, proto, typ))
+        raw = sum(len(frame) for frame in frames)
+        name = os.path.basename(session)[:24]
+        print("%-24s %-10s %5s %10d %10d %7.2f %12d %10s" % (name, "none", "-", raw, raw, 1.0, 0, "-"))
+        for wbits in [int(w) for w in args.window_bits.split(",")]:
+            # Memory of the deflate compressor, the decompressor of the server is not on the device
+            memory = (1 << (wbits + 2)) + (1 << (args.mem_level + 9))
+            for takeover in (True, False):
+                wire, cpu = compress(frames, wbits, args.mem_level, takeover)
+                context = "takeover" if takeover else "reset"
+                print(
+                    "%-24s %-10s %5d %10d %10d %7.2f %12d %10.1f"
+                    % (name, context, wbits, raw, wire, raw / max(wire, 1), memory, cpu * 1e6 / max(raw / 1024, 1e-6))
+                )
+
+
+if __name__ == "__main__":
+    main()